@@ -0,0 +1,299 @@
+#include "http_parser.h"
+#include "http_scan.h"
+
+using namespace std;
+
+static inline bool is_ows(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static inline string_view trim_ows(string_view s)
+{
+    while (!s.empty() && is_ows(s.front())) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && is_ows(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+void HttpParser::reset()
+{
+    hp_state = State::RequestLine;
+    hp_pos = 0;
+    hp_scan = 0;
+    hp_error_status = 0;
+    hp_method_off = hp_method_len = 0;
+    hp_target_off = hp_target_len = 0;
+    hp_minor_version = 1;
+    hp_headers.clear();
+    hp_chunked = false;
+    hp_has_length = false;
+    hp_conn_close = false;
+    hp_conn_keep_alive = false;
+    hp_content_length = 0;
+    hp_body_off = 0;
+    hp_chunk_remain = 0;
+    hp_body.clear();
+}
+
+HttpParser::Result HttpParser::fail(int status)
+{
+    hp_state = State::Failed;
+    hp_error_status = status;
+    return Error;
+}
+
+HttpParser::Result HttpParser::parse(const char *data, size_t len)
+{
+    const HttpScanner& scanner = http_scanner();
+    while (true) {
+        switch (hp_state) {
+        case State::RequestLine:
+        case State::Headers:
+        case State::ChunkSize:
+        case State::Trailers: {
+            bool in_head = hp_state == State::RequestLine || hp_state == State::Headers;
+            size_t lf = scanner.hs_find_lf(data, hp_scan, len);
+            if (lf == len) {
+                //没有完整的行，记住已经扫描过的位置，下一次只扫描新到达的数据
+                hp_scan = len;
+                if (in_head && len > HTTP_MAX_HEADER_SIZE) {
+                    return fail(431);
+                }
+                if (!in_head && len - hp_pos > HTTP_MAX_HEADER_SIZE) {
+                    return fail(400);
+                }
+                return Incomplete;
+            }
+            size_t begin = hp_pos;
+            size_t end = (lf > begin && data[lf - 1] == '\r') ? lf - 1 : lf;  //也接受只有LF的换行
+            hp_pos = hp_scan = lf + 1;
+            if (in_head && hp_pos > HTTP_MAX_HEADER_SIZE) {
+                return fail(431);
+            }
+
+            int status = 0;
+            if (hp_state == State::RequestLine) {
+                if (begin != end) {  //忽略请求行之前的空行
+                    status = parse_request_line(scanner, data, begin, end);
+                }
+            }
+            else if (hp_state == State::Headers) {
+                status = begin == end ? finish_headers() : parse_header_line(scanner, data, begin, end);
+            }
+            else if (hp_state == State::ChunkSize) {
+                status = parse_chunk_size(data, begin, end);
+            }
+            else if (begin == end) {
+                hp_state = State::Done;  //尾部头部不提供给请求回调，只检查总长度
+            }
+            if (status != 0) {
+                return fail(status);
+            }
+            break;
+        }
+        case State::Body:
+            if (len - hp_pos < hp_content_length) {
+                return Incomplete;
+            }
+            hp_body_off = hp_pos;
+            hp_pos += hp_content_length;
+            hp_state = State::Done;
+            break;
+        case State::ChunkData:
+            if (len - hp_pos < hp_chunk_remain) {
+                return Incomplete;
+            }
+            hp_body.append(data + hp_pos, hp_chunk_remain);
+            hp_pos += hp_chunk_remain;
+            hp_scan = hp_pos;
+            hp_state = State::ChunkDataEnd;
+            break;
+        case State::ChunkDataEnd:
+            if (hp_pos < len && data[hp_pos] == '\n') {
+                hp_pos += 1;
+            }
+            else if (hp_pos + 1 < len && data[hp_pos] == '\r' && data[hp_pos + 1] == '\n') {
+                hp_pos += 2;
+            }
+            else if (hp_pos >= len || (hp_pos + 1 == len && data[hp_pos] == '\r')) {
+                return Incomplete;
+            }
+            else {
+                return fail(400);
+            }
+            hp_scan = hp_pos;
+            hp_state = State::ChunkSize;
+            break;
+        case State::Done:
+            build_request(data);
+            return Complete;
+        case State::Failed:
+            return Error;
+        }
+    }
+}
+
+// method SP request-target SP HTTP-version
+int HttpParser::parse_request_line(const HttpScanner& scanner, const char *data, size_t begin, size_t end)
+{
+    string_view line(data + begin, end - begin);
+    size_t sp1 = scanner.hs_token_len(line.data(), line.size());  //方法是token，后面必须是空格
+    if (sp1 == 0 || sp1 == line.size() || line[sp1] != ' ') {
+        return 400;
+    }
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == string_view::npos || sp2 == sp1 + 1) {
+        return 400;
+    }
+    if (scanner.hs_find_ctl(line.data() + sp1 + 1, sp2 - sp1 - 1) != sp2 - sp1 - 1) {
+        return 400;
+    }
+    string_view version = line.substr(sp2 + 1);
+    if (version.size() != 8 || version.substr(0, 5) != "HTTP/") {
+        return 400;
+    }
+    if (version[5] != '1' || version[6] != '.' || (version[7] != '0' && version[7] != '1')) {
+        return 505;
+    }
+
+    hp_method_off = begin;
+    hp_method_len = sp1;
+    hp_target_off = begin + sp1 + 1;
+    hp_target_len = sp2 - sp1 - 1;
+    hp_minor_version = version[7] - '0';
+    hp_state = State::Headers;
+    return 0;
+}
+
+// field-name ":" OWS field-value OWS，Content-Length、Transfer-Encoding、Connection决定请求体格式和连接是否保持
+int HttpParser::parse_header_line(const HttpScanner& scanner, const char *data, size_t begin, size_t end)
+{
+    if (is_ows(data[begin])) {
+        return 400;  //不支持已经废弃的多行头部
+    }
+    if (hp_headers.size() >= HTTP_MAX_HEADERS) {
+        return 431;
+    }
+    string_view line(data + begin, end - begin);
+    size_t colon = scanner.hs_token_len(line.data(), line.size());  //名称是token，后面必须紧跟':'
+    if (colon == 0 || colon == line.size() || line[colon] != ':') {
+        return 400;
+    }
+    string_view name = line.substr(0, colon);
+    string_view value = trim_ows(line.substr(colon + 1));
+    if (scanner.hs_find_ctl(value.data(), value.size()) != value.size()) {
+        return 400;  //值中不能有HTAB以外的控制字符（包括单独的CR）
+    }
+    hp_headers.push_back(HeaderSpan{ static_cast<uint32_t>(begin), static_cast<uint32_t>(colon),
+                                     static_cast<uint32_t>(value.data() - data), static_cast<uint32_t>(value.size()) });
+
+    if (http_iequals(name, "content-length")) {
+        if (value.empty()) {
+            return 400;
+        }
+        size_t length = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') {
+                return 400;
+            }
+            length = length * 10 + (c - '0');
+            if (length > HTTP_MAX_BODY_SIZE) {
+                return 413;
+            }
+        }
+        if (hp_has_length && length != hp_content_length) {
+            return 400;  //多个不一致的Content-Length
+        }
+        hp_has_length = true;
+        hp_content_length = length;
+    }
+    else if (http_iequals(name, "transfer-encoding")) {
+        if (!http_iequals(value, "chunked")) {
+            return 501;  //只支持chunked
+        }
+        hp_chunked = true;
+    }
+    else if (http_iequals(name, "connection")) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            string_view token = trim_ows(value.substr(0, comma));
+            if (http_iequals(token, "close")) {
+                hp_conn_close = true;
+            }
+            else if (http_iequals(token, "keep-alive")) {
+                hp_conn_keep_alive = true;
+            }
+            value = comma == string_view::npos ? string_view() : value.substr(comma + 1);
+        }
+    }
+    return 0;
+}
+
+int HttpParser::finish_headers()
+{
+    if (hp_chunked && hp_has_length) {
+        return 400;  //同时有两种长度时可能被用来走私请求，直接拒绝
+    }
+    if (hp_chunked) {
+        hp_state = State::ChunkSize;
+    }
+    else if (hp_content_length > 0) {
+        hp_state = State::Body;
+    }
+    else {
+        hp_state = State::Done;
+    }
+    return 0;
+}
+
+// chunk-size [ chunk-ext ]，大小为0时进入尾部头部
+int HttpParser::parse_chunk_size(const char *data, size_t begin, size_t end)
+{
+    size_t size = 0;
+    size_t i = begin;
+    for (; i < end; i++) {
+        char c = data[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else break;
+        size = size * 16 + digit;
+        if (size > HTTP_MAX_BODY_SIZE) {
+            return 413;
+        }
+    }
+    if (i == begin || (i < end && data[i] != ';' && !is_ows(data[i]))) {
+        return 400;
+    }
+    if (hp_body.size() + size > HTTP_MAX_BODY_SIZE) {
+        return 413;
+    }
+    hp_chunk_remain = size;
+    hp_state = size == 0 ? State::Trailers : State::ChunkData;
+    return 0;
+}
+
+void HttpParser::build_request(const char *data)
+{
+    HttpRequest& req = hp_request;
+    req.rq_method = string_view(data + hp_method_off, hp_method_len);
+    req.rq_target = string_view(data + hp_target_off, hp_target_len);
+    size_t question = req.rq_target.find('?');
+    req.rq_path = req.rq_target.substr(0, question);
+    req.rq_query = question == string_view::npos ? string_view() : req.rq_target.substr(question + 1);
+    req.rq_minor_version = hp_minor_version;
+
+    req.rq_headers.clear();
+    for (const HeaderSpan& h : hp_headers) {
+        req.rq_headers.push_back(HttpHeader{ string_view(data + h.hs_name_off, h.hs_name_len),
+                                             string_view(data + h.hs_value_off, h.hs_value_len) });
+    }
+    req.rq_body = hp_chunked ? string_view(hp_body) : string_view(data + hp_body_off, hp_content_length);
+    //HTTP/1.1默认保持连接，HTTP/1.0只有Connection: keep-alive时保持连接
+    req.rq_keep_alive = hp_minor_version == 1 ? !hp_conn_close : (hp_conn_keep_alive && !hp_conn_close);
+}
@@ -0,0 +1,104 @@
+#ifndef __HTTP_PARSER_H__
+#define __HTTP_PARSER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "http_request.h"
+#include "http_scan.h"
+
+using namespace std;
+
+#define HTTP_MAX_HEADER_SIZE (8 * 1024)  // 请求行和头部的最大字节数
+#define HTTP_MAX_HEADERS (64)  // 最多的头部个数
+#define HTTP_MAX_BODY_SIZE (1024 * 1024)  // 请求体的最大字节数，整个请求需要能合并到内存池的一个chunk中
+
+/*
+   增量的HTTP/1.1请求解析器，每个连接一个：
+   * 每次调用parse传入从当前请求开头开始的全部未处理数据，数据不完整时返回Incomplete，
+     下一次调用从上一次停下的位置继续，已经解析过的行不会重新扫描；数据的地址可以变化（输入缓冲区合并chunk），
+     解析过程中只保存相对请求开头的偏移量，请求完整时才生成指向数据的string_view
+   * 支持Content-Length和chunked请求体，chunked请求体解码到解析器自己的缓冲区中
+   * 返回Complete后consumed()为该请求的字节数，调用者处理完请求、弹出这些字节后调用reset()解析下一个请求，
+     同一批数据中的多个流水线请求依次解析
+   * 查找换行符、token和控制字符使用http_scanner()选择的向量化实现
+   * 请求格式错误或者超过限制时返回Error，error_status()给出应该回复的状态码，之后应该关闭连接
+*/
+class HttpParser
+{
+public:
+    enum Result {
+        Incomplete,  // 数据还不完整
+        Complete,  // 解析出一个完整的请求
+        Error,  // 请求格式错误或者超过限制
+    };
+
+    HttpParser() { reset(); }
+
+    // 解析从当前请求开头开始的数据，len为数据的总长度（包括之前已经解析过的部分）
+    Result parse(const char *data, size_t len);
+
+    const HttpRequest& request() const { return hp_request; }  // 解析出的请求，只在返回Complete后有效
+
+    size_t consumed() const { return hp_pos; }  // 返回Complete后为该请求的字节数
+
+    int error_status() const { return hp_error_status; }  // 返回Error后应该回复的状态码
+
+    void reset();  // 准备解析下一个请求，保留已经分配的内存
+
+private:
+    enum class State {
+        RequestLine,  // 请求行
+        Headers,  // 头部行
+        Body,  // Content-Length请求体
+        ChunkSize,  // chunk大小行
+        ChunkData,  // chunk数据
+        ChunkDataEnd,  // chunk数据后的换行
+        Trailers,  // chunked请求体后的尾部头部
+        Done,  // 请求完整
+        Failed,  // 请求错误
+    };
+
+    // 头部在数据中的位置
+    struct HeaderSpan {
+        uint32_t hs_name_off;
+        uint32_t hs_name_len;
+        uint32_t hs_value_off;
+        uint32_t hs_value_len;
+    };
+
+    // 以下解析函数解析数据中的一行[begin, end)，不包括换行符，返回0表示成功，否则为应该回复的错误状态码
+    int parse_request_line(const HttpScanner& scanner, const char *data, size_t begin, size_t end);
+    int parse_header_line(const HttpScanner& scanner, const char *data, size_t begin, size_t end);
+    int parse_chunk_size(const char *data, size_t begin, size_t end);
+    int finish_headers();  // 头部结束，根据请求体的格式决定下一个状态
+    Result fail(int status);  // 记录错误状态码并返回Error
+    void build_request(const char *data);  // 请求完整时生成指向数据的请求
+
+    State hp_state;  // 当前状态
+    size_t hp_pos;  // 下一个要解析的字节相对请求开头的偏移量
+    size_t hp_scan;  // 行解析状态下已经确认没有换行符的位置，下一次从这里继续查找
+    int hp_error_status;  // 错误时应该回复的状态码
+
+    uint32_t hp_method_off;  // 请求行中各部分的位置
+    uint32_t hp_method_len;
+    uint32_t hp_target_off;
+    uint32_t hp_target_len;
+    int hp_minor_version;
+    vector<HeaderSpan> hp_headers;  // 所有头部的位置
+
+    bool hp_chunked;  // 请求体是否为chunked格式
+    bool hp_has_length;  // 是否有Content-Length头部
+    bool hp_conn_close;  // Connection头部中是否有close
+    bool hp_conn_keep_alive;  // Connection头部中是否有keep-alive
+    size_t hp_content_length;  // Content-Length的值
+    size_t hp_body_off;  // Content-Length请求体的偏移量
+    size_t hp_chunk_remain;  // 当前chunk的字节数
+    string hp_body;  // chunked请求体解码后的数据
+
+    HttpRequest hp_request;  // 解析出的请求
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __HTTP_REQUEST_H__
+#define __HTTP_REQUEST_H__
+
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// 不区分大小写比较，HTTP的方法以外的标记（头部名称、Connection的值等）都不区分大小写
+inline bool http_iequals(string_view a, string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i];
+        char y = b[i];
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct HttpHeader {
+    string_view hh_name;  // 头部名称，保持请求中的大小写
+    string_view hh_value;  // 去掉首尾空白的值
+};
+
+// 解析完成的HTTP请求
+// 所有string_view都指向连接输入缓冲区中的数据（chunked请求体指向解析器中解码后的数据），
+// 只在请求回调中有效，回调返回后请求数据就会从输入缓冲区中弹出
+struct HttpRequest {
+    string_view rq_method;  // 请求方法，区分大小写
+    string_view rq_target;  // 请求目标，包括查询字符串
+    string_view rq_path;  // 请求目标中'?'之前的部分
+    string_view rq_query;  // 请求目标中'?'之后的部分，没有时为空
+    int rq_minor_version{ 1 };  // HTTP/1.x中的x
+    vector<HttpHeader> rq_headers;  // 所有头部，按请求中的顺序
+    string_view rq_body;  // 请求体，Content-Length或者chunked解码后的数据
+    bool rq_keep_alive{ true };  // 响应后是否保持连接，由版本和Connection头部决定
+
+    // 查找头部，名称不区分大小写，有多个同名头部时返回第一个，没有时返回空
+    string_view header(string_view name) const
+    {
+        for (const HttpHeader& h : rq_headers) {
+            if (http_iequals(h.hh_name, name)) {
+                return h.hh_value;
+            }
+        }
+        return string_view();
+    }
+};
+
+#endif
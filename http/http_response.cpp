@@ -0,0 +1,60 @@
+#include <stdio.h>
+
+#include "http_response.h"
+
+using namespace std;
+
+const char* http_status_reason(int status)
+{
+    switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 411: return "Length Required";
+    case 413: return "Content Too Large";
+    case 414: return "URI Too Long";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Unknown";
+    }
+}
+
+void HttpResponse::append_to(string& out, bool with_body, bool keep_alive_header) const
+{
+    char num[32];
+    out.append("HTTP/1.1 ");
+    out.append(num, snprintf(num, sizeof(num), "%d", rs_status));
+    out.push_back(' ');
+    out.append(rs_reason.empty() ? string_view(http_status_reason(rs_status)) : rs_reason);
+    out.append("\r\n");
+    out.append(rs_headers);
+
+    size_t body_len = has_file() ? rs_file_len : rs_body.size();
+    out.append("Content-Length: ");
+    out.append(num, snprintf(num, sizeof(num), "%zu", body_len));
+    out.append("\r\n");
+    if (rs_close) {
+        out.append("Connection: close\r\n");
+    }
+    else if (keep_alive_header) {
+        out.append("Connection: keep-alive\r\n");
+    }
+    out.append("\r\n");
+
+    if (with_body && !has_file()) {
+        out.append(rs_body);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef __HTTP_RESPONSE_H__
+#define __HTTP_RESPONSE_H__
+
+#include <sys/types.h>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// 常用状态码的原因短语
+const char* http_status_reason(int status);
+
+// HTTP响应，由请求回调填写，服务器序列化后追加到本批响应中一起发送
+// * Content-Length和Connection头部由序列化时自动生成，回调不需要设置
+// * 响应体可以是内存中的数据，也可以是文件区域，文件区域使用sendfile发送，不经过用户态
+class HttpResponse
+{
+public:
+    HttpResponse() { reset(); }
+
+    void set_status(int status, string_view reason = string_view())  // 设置状态码，原因短语为空时使用常用的短语
+    {
+        rs_status = status;
+        rs_reason = reason;
+    }
+
+    int get_status() const { return rs_status; }
+
+    void add_header(string_view name, string_view value)  // 添加一个头部
+    {
+        rs_headers.append(name);
+        rs_headers.append(": ");
+        rs_headers.append(value);
+        rs_headers.append("\r\n");
+    }
+
+    void set_body(string_view body) { rs_body.assign(body); }  // 设置响应体
+
+    void append_body(string_view data) { rs_body.append(data); }  // 在响应体后追加数据
+
+    // 响应体为文件fd中从offset开始的len字节，由连接的send_file发送
+    void set_file(int fd, off_t offset, size_t len)
+    {
+        rs_file_fd = fd;
+        rs_file_offset = offset;
+        rs_file_len = len;
+    }
+
+    bool has_file() const { return rs_file_fd >= 0; }
+    int get_file_fd() const { return rs_file_fd; }
+    off_t get_file_offset() const { return rs_file_offset; }
+    size_t get_file_len() const { return rs_file_len; }
+
+    void set_close(bool close) { rs_close = close; }  // 设置发送该响应后是否关闭连接
+    bool is_close() const { return rs_close; }
+
+    // 把状态行、头部和内存中的响应体追加到out中，with_body为false时（HEAD请求）只追加状态行和头部
+    // keep_alive_header为true时添加Connection: keep-alive（HTTP/1.0请求保持连接时需要）
+    void append_to(string& out, bool with_body, bool keep_alive_header) const;
+
+    void reset()  // 清空响应，保留已经分配的内存
+    {
+        rs_status = 200;
+        rs_reason = string_view();
+        rs_headers.clear();
+        rs_body.clear();
+        rs_file_fd = -1;
+        rs_file_offset = 0;
+        rs_file_len = 0;
+        rs_close = false;
+    }
+
+private:
+    int rs_status;  // 状态码
+    string_view rs_reason;  // 原因短语，为空时使用常用的短语
+    string rs_headers;  // 已经序列化的头部行
+    string rs_body;  // 响应体
+    int rs_file_fd;  // 文件响应体的fd，-1表示没有
+    off_t rs_file_offset;
+    size_t rs_file_len;
+    bool rs_close;  // 发送后是否关闭连接
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_X86 1
+#endif
+
+#include "http_scan.h"
+
+using namespace std;
+
+// token字符表，下标为字节值
+struct TcharTable {
+    bool tt_is_tchar[256];
+
+    TcharTable()
+    {
+        const char *special = "!#$%&'*+-.^_`|~";
+        for (int c = 0; c < 256; c++) {
+            tt_is_tchar[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                             || (c != 0 && strchr(special, c) != nullptr);
+        }
+    }
+};
+
+static const TcharTable s_tchar;
+
+static inline bool is_ctl(unsigned char c)
+{
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+/* ---------------- 逐字节实现 ---------------- */
+
+static size_t scalar_find_lf(const char *data, size_t from, size_t len)
+{
+    for (size_t i = from; i < len; i++) {
+        if (data[i] == '\n') {
+            return i;
+        }
+    }
+    return len;
+}
+
+static size_t scalar_token_len(const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (!s_tchar.tt_is_tchar[static_cast<unsigned char>(data[i])]) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static size_t scalar_find_ctl(const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (is_ctl(static_cast<unsigned char>(data[i]))) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static const HttpScanner s_scalar = { "scalar", scalar_find_lf, scalar_token_len, scalar_find_ctl };
+
+#ifdef HTTP_SCAN_X86
+
+/*
+   token字符的判断使用按半字节查表：字节b是token字符当且仅当 TCHAR_LO[b & 0xf] & TCHAR_HI[b >> 4] 不为0，
+   TCHAR_LO的第h位表示高半字节为h、低半字节为该下标的字符是token字符；高半字节不小于8（非ASCII）时TCHAR_HI为0
+   两次pshufb加一次and即可判断16/32个字节
+*/
+#define TCHAR_LO 0xe8, 0xfc, 0xf8, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xf8, 0xf8, 0xf4, 0x54, 0xd0, 0x54, 0xf4, 0x70
+#define TCHAR_HI 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0
+
+/*
+   向量化扫描的公共结构：按整块比较得到位掩码，找到第一个置位的字节；
+   最后不足一块时，如果总长度不小于一块，再比较以len结尾的一整块（与前一块重叠），去掉已经比较过的字节，
+   避免对每行几十字节的头部逐字节处理尾部；总长度不足一块时交给short_scan
+*/
+#define SCAN_BLOCKS(WIDTH, MASK, data, from, len, short_scan)                  \
+    do {                                                                       \
+        size_t i = (from);                                                     \
+        for (; i + (WIDTH) <= (len); i += (WIDTH)) {                           \
+            uint32_t m = MASK((data) + i);                                     \
+            if (m != 0) {                                                      \
+                return i + __builtin_ctz(m);                                   \
+            }                                                                  \
+        }                                                                      \
+        if (i == (len)) {                                                      \
+            return (len);                                                      \
+        }                                                                      \
+        if ((len) - (from) >= (WIDTH)) {                                       \
+            size_t last = (len) - (WIDTH);                                     \
+            uint32_t m = MASK((data) + last) >> (i - last);                    \
+            return m != 0 ? i + __builtin_ctz(m) : (len);                      \
+        }                                                                      \
+        return short_scan;                                                     \
+    } while (0)
+
+/* ---------------- SSE4.2实现 ---------------- */
+
+__attribute__((target("sse4.2")))
+static inline uint32_t sse42_lf_mask(const char *p)
+{
+    const __m128i needle = _mm_setr_epi8('\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i m = _mm_cmpestrm(needle, 1, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(m));
+}
+
+__attribute__((target("sse4.2")))
+static inline uint32_t sse42_non_token_mask(const char *p)
+{
+    const __m128i lo_table = _mm_setr_epi8(TCHAR_LO);
+    const __m128i hi_table = _mm_setr_epi8(TCHAR_HI);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(v, nibble));
+    __m128i hi = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())));
+}
+
+__attribute__((target("sse4.2")))
+static inline uint32_t sse42_ctl_mask(const char *p)
+{
+    //pcmpestrm范围匹配：[0x00, 0x08] [0x0a, 0x1f] [0x7f, 0x7f]
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i m = _mm_cmpestrm(ranges, 6, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(m));
+}
+
+__attribute__((target("sse4.2"), always_inline))
+static inline size_t sse42_find_lf(const char *data, size_t from, size_t len)
+{
+    SCAN_BLOCKS(16, sse42_lf_mask, data, from, len, scalar_find_lf(data, i, len));
+}
+
+__attribute__((target("sse4.2"), always_inline))
+static inline size_t sse42_token_len(const char *data, size_t len)
+{
+    SCAN_BLOCKS(16, sse42_non_token_mask, data, 0, len, i + scalar_token_len(data + i, len - i));
+}
+
+__attribute__((target("sse4.2"), always_inline))
+static inline size_t sse42_find_ctl(const char *data, size_t len)
+{
+    SCAN_BLOCKS(16, sse42_ctl_mask, data, 0, len, i + scalar_find_ctl(data + i, len - i));
+}
+
+static const HttpScanner s_sse42 = { "sse4.2", sse42_find_lf, sse42_token_len, sse42_find_ctl };
+
+/* ---------------- AVX2实现 ---------------- */
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_lf_mask(const char *p)
+{
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_non_token_mask(const char *p)
+{
+    //pshufb在每个128位通道内查表，表在两个通道中各放一份
+    const __m256i lo_table = _mm256_setr_epi8(TCHAR_LO, TCHAR_LO);
+    const __m256i hi_table = _mm256_setr_epi8(TCHAR_HI, TCHAR_HI);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(v, nibble));
+    __m256i hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_ctl_mask(const char *p)
+{
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);  //v <= 0x1f（无符号）
+    ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), ctl);
+    ctl = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(ctl));
+}
+
+/*
+   不足32字节时使用SSE4.2实现（支持AVX2的CPU都支持SSE4.2），SSE4.2实现强制内联，
+   在AVX2函数中编译为VEX编码，避免调用传统SSE编码的函数时ymm高位未清零带来的切换开销
+*/
+__attribute__((target("avx2")))
+static size_t avx2_find_lf(const char *data, size_t from, size_t len)
+{
+    SCAN_BLOCKS(32, avx2_lf_mask, data, from, len, sse42_find_lf(data, i, len));
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_token_len(const char *data, size_t len)
+{
+    SCAN_BLOCKS(32, avx2_non_token_mask, data, 0, len, i + sse42_token_len(data + i, len - i));
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_find_ctl(const char *data, size_t len)
+{
+    SCAN_BLOCKS(32, avx2_ctl_mask, data, 0, len, i + sse42_find_ctl(data + i, len - i));
+}
+
+static const HttpScanner s_avx2 = { "avx2", avx2_find_lf, avx2_token_len, avx2_find_ctl };
+
+#endif
+
+const HttpScanner* http_get_scanner(HttpScanKind kind)
+{
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();  //可能在静态初始化阶段调用，先初始化CPUID的检测结果
+    switch (kind) {
+    case HttpScanKind::Avx2:
+        return __builtin_cpu_supports("avx2") ? &s_avx2 : nullptr;
+    case HttpScanKind::Sse42:
+        return __builtin_cpu_supports("sse4.2") ? &s_sse42 : nullptr;
+    default:
+        return &s_scalar;
+    }
+#else
+    return kind == HttpScanKind::Scalar ? &s_scalar : nullptr;
+#endif
+}
+
+static atomic<const HttpScanner*> s_active{ nullptr };
+
+const HttpScanner& http_scanner()
+{
+    const HttpScanner *scanner = s_active.load(memory_order_relaxed);
+    if (scanner == nullptr) {
+        for (HttpScanKind kind : { HttpScanKind::Avx2, HttpScanKind::Sse42, HttpScanKind::Scalar }) {
+            if ((scanner = http_get_scanner(kind)) != nullptr) {
+                break;
+            }
+        }
+        s_active.store(scanner, memory_order_relaxed);
+    }
+    return *scanner;
+}
+
+bool http_select_scanner(HttpScanKind kind)
+{
+    const HttpScanner *scanner = http_get_scanner(kind);
+    if (scanner == nullptr) {
+        return false;
+    }
+    s_active.store(scanner, memory_order_relaxed);
+    return true;
+}
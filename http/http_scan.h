@@ -0,0 +1,36 @@
+#ifndef __HTTP_SCAN_H__
+#define __HTTP_SCAN_H__
+
+#include <stddef.h>
+
+// 请求解析中的字节扫描实现
+enum class HttpScanKind {
+    Scalar,  // 逐字节扫描，所有平台可用
+    Sse42,  // SSE4.2的pcmpestri和SSSE3的pshufb，每次16字节
+    Avx2,  // AVX2，每次32字节
+};
+
+/*
+   HTTP请求头部解析中的热点扫描函数：
+   * find_lf：查找换行符，用于切分请求行、头部行和chunk大小行
+   * token_len：token字符（RFC 9110 tchar）的前缀长度，用于方法和头部名称，同时找到后面的分隔符（' '或':'）
+   * find_ctl：查找头部值和请求目标中不允许出现的控制字符（HTAB以外的0x00~0x1f和0x7f）
+   向量化实现每次比较16或32字节，尾部与前一个向量重叠比较，只有总长度不足16字节时逐字节处理，不会读取超出范围的内存
+*/
+struct HttpScanner {
+    const char *hs_name;
+    size_t (*hs_find_lf)(const char *data, size_t from, size_t len);  // [from, len)中第一个'\n'的下标，没有时返回len
+    size_t (*hs_token_len)(const char *data, size_t len);  // 第一个非token字符的下标，都是token字符时返回len
+    size_t (*hs_find_ctl)(const char *data, size_t len);  // 第一个非法控制字符的下标，没有时返回len
+};
+
+// 获取指定的实现，CPU不支持时返回nullptr
+const HttpScanner* http_get_scanner(HttpScanKind kind);
+
+// 当前使用的实现，第一次调用时通过CPUID选择CPU支持的最快的实现
+const HttpScanner& http_scanner();
+
+// 指定当前使用的实现（用于测试和对比），CPU不支持时返回false且不改变
+bool http_select_scanner(HttpScanKind kind);
+
+#endif
@@ -0,0 +1,98 @@
+#include <any>
+#include <string>
+
+#include "http_server.h"
+#include "../net/event_loop.h"
+#include "../log/pr.h"
+#include "../log/log.h"
+
+using namespace std;
+
+// 每个事件循环线程一个的响应缓冲区，一次读取中所有请求的响应追加到这里后一起发送，保留分配的内存
+static thread_local string t_out;
+static thread_local HttpResponse t_response;
+
+HttpServer::HttpServer(EventLoop* loop, const char *ip, uint16_t port, PollerType poller_type)
+    : hs_server(loop, ip, port, poller_type)
+{
+    hs_server.set_message_cb([this](const TcpConnSP& conn, InputBuffer* ibuf){ this->on_message(conn, ibuf); });
+}
+
+void HttpServer::on_message(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    if (conn->is_closing()) {
+        //已经决定关闭的连接丢弃后续到达的数据
+        ibuf->pop(ibuf->length());
+        ibuf->adjust();
+        return;
+    }
+    HttpContext* ctx = any_cast<HttpContext>(conn->get_context());
+    if (ctx == nullptr) {
+        conn->set_context(HttpContext());
+        ctx = any_cast<HttpContext>(conn->get_context());
+    }
+    HttpParser& parser = ctx->hc_parser;
+    string& out = t_out;
+    out.clear();
+    bool close = false;
+
+    //依次处理缓冲区中所有完整的请求，最后一个不完整的请求留在缓冲区中，下一次从停下的位置继续解析
+    while (ibuf->length() > 0) {
+        const char *data = ibuf->get_from_buf();
+        if (data == nullptr) {
+            close = true;
+            break;
+        }
+        HttpParser::Result result = parser.parse(data, ibuf->length());
+        if (result == HttpParser::Incomplete) {
+            break;
+        }
+
+        HttpResponse& resp = t_response;
+        resp.reset();
+        if (result == HttpParser::Error) {
+            LOG_INFO("bad http request on fd %d, reply %d\n", conn->get_fd(), parser.error_status());
+            resp.set_status(parser.error_status());
+            resp.set_close(true);
+            resp.append_to(out, true, false);
+            close = true;
+            break;
+        }
+
+        const HttpRequest& req = parser.request();
+        resp.set_close(!req.rq_keep_alive);
+        if (hs_request_cb) {
+            hs_request_cb(req, resp);
+        }
+        else {
+            resp.set_status(404);
+        }
+        bool with_body = req.rq_method != "HEAD";
+        resp.append_to(out, with_body, !resp.is_close() && req.rq_minor_version == 0);
+        if (resp.has_file() && with_body) {
+            //文件区域之前的响应先放入输出缓冲区，由连接保证和文件内容按顺序发送
+            conn->send(out.data(), static_cast<int>(out.size()));
+            out.clear();
+            conn->send_file(resp.get_file_fd(), resp.get_file_offset(), resp.get_file_len());
+        }
+
+        //请求回调返回后请求中的string_view不再使用，弹出该请求的数据
+        ibuf->pop(static_cast<int>(parser.consumed()));
+        parser.reset();
+        if (resp.is_close()) {
+            close = true;
+            break;
+        }
+    }
+
+    if (close) {
+        ibuf->pop(ibuf->length());
+    }
+    ibuf->adjust();
+    if (!out.empty()) {
+        conn->send(out.data(), static_cast<int>(out.size()));
+    }
+    if (close) {
+        conn->close_after_write();
+    }
+}
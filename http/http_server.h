@@ -0,0 +1,52 @@
+#ifndef __HTTP_SERVER_H__
+#define __HTTP_SERVER_H__
+
+#include <stdint.h>
+#include <functional>
+
+#include "http_parser.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "../net/tcp_server.h"
+
+using namespace std;
+
+class EventLoop;
+
+/*
+   在TcpServer上实现的HTTP/1.1服务器：
+   * 每个连接一个增量解析器，第一次收到数据时创建并保存在连接的上下文中，请求跨多次读取到达时从上次停下的位置继续解析
+   * 一次读取到的多个流水线请求依次解析、依次调用请求回调，所有响应追加到同一个缓冲区，最后一次send发出
+   * 响应后根据请求的版本和Connection头部保持或者关闭连接，关闭时等待响应发送完
+   * 请求格式错误时回复对应的错误状态码并关闭连接
+   * 请求回调在连接所属的事件循环线程中执行
+*/
+class HttpServer
+{
+public:
+    typedef function<void(const HttpRequest&, HttpResponse&)> RequestCallback;
+
+    HttpServer(EventLoop* loop, const char *ip, uint16_t port, PollerType poller_type = PollerType::Epoll);
+
+    // 设置请求回调，没有设置时所有请求回复404
+    void set_request_cb(const RequestCallback& cb) { hs_request_cb = cb; }
+
+    // 获取底层的TcpServer，用于设置线程数、超时、ET模式、连接建立和关闭回调等，需要在start()之前设置
+    // 消息回调和连接的上下文由HttpServer使用，不能再设置
+    TcpServer& get_tcp_server() { return hs_server; }
+
+    void start() { hs_server.start(); }
+
+private:
+    // 连接的上下文
+    struct HttpContext {
+        HttpParser hc_parser;  // 请求解析器
+    };
+
+    void on_message(const TcpConnSP& conn, InputBuffer* ibuf);
+
+    TcpServer hs_server;
+    RequestCallback hs_request_cb;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// HTTP服务器流水线吞吐测试：
+// * blind：原来http_for_bench的做法，不解析请求，每次读到数据就回复一个固定响应（只能测试流水线深度1）
+// * http：HttpServer解析每个请求，一次读取中的所有响应一起发送
+// 每个客户端连接一次写出depth个请求，读完depth个响应后再发送下一批，统计请求吞吐和每个请求的等待事件次数
+// 用法: ./http_bench [conn_num] [seconds] [loop_num]
+
+const char *g_ip = "127.0.0.1";
+const string g_request = "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: http_bench\r\n"
+                         "Accept: */*\r\nConnection: keep-alive\r\n\r\n";
+const string g_body = "<html><head><title>my title</title><body>Hello World!</body></head></html>";
+const string g_blind_response = "HTTP/1.1 200 OK\r\nContent-Length: " + to_string(g_body.size()) + "\r\n\r\n" + g_body;
+
+//原来的做法：收到数据就回复一个响应，流水线请求只会得到一个响应
+void blind_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    ibuf->pop(ibuf->length());
+    ibuf->adjust();
+    conn->send(g_blind_response.c_str(), g_blind_response.length());
+}
+
+void bench_client(uint16_t port, int depth, atomic<bool>* stop, atomic<long long>* req_cnt)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton(g_ip, &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        PR_ERROR("connect to %s:%d failed\n", g_ip, (int)port);
+        close(fd);
+        return;
+    }
+    int op = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
+
+    string batch;
+    for (int i = 0; i < depth; i++) {
+        batch += g_request;
+    }
+    size_t resp_len = g_blind_response.size() * depth;  //两种服务器的响应相同
+    vector<char> rbuf(resp_len);
+    while (!stop->load()) {
+        if (write(fd, batch.data(), batch.size()) != (ssize_t)batch.size()) {
+            break;
+        }
+        size_t recvd = 0;
+        while (recvd < resp_len) {
+            int n = read(fd, rbuf.data() + recvd, resp_len - recvd);
+            if (n <= 0) { close(fd); return; }
+            recvd += n;
+        }
+        req_cnt->fetch_add(depth);
+    }
+    close(fd);
+}
+
+void run_bench(const char *name, TcpServer& server, uint16_t port, int depth, int conn_num, int seconds)
+{
+    atomic<bool> stop{ false };
+    atomic<long long> req_cnt{ 0 };
+    uint64_t poll_before = server.get_poll_cnt();
+
+    vector<thread> clients;
+    for (int i = 0; i < conn_num; i++) {
+        clients.emplace_back(bench_client, port, depth, &stop, &req_cnt);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    uint64_t polls = server.get_poll_cnt() - poll_before;
+    long long reqs = req_cnt.load();
+    printf("%-8s depth: %-4d req/s: %-12.1f poll calls/req: %.3f\n", name, depth, (double)reqs / seconds,
+           reqs ? (double)polls / reqs : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int conn_num = argc > 1 ? atoi(argv[1]) : 4;
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    int loop_num = argc > 3 ? atoi(argv[3]) : 2;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    EventLoop base_loop;
+    TcpServer blind(&base_loop, g_ip, 9021);
+    blind.set_message_cb(blind_message_cb);
+    HttpServer http(&base_loop, g_ip, 9022);
+    http.set_request_cb([](const HttpRequest&, HttpResponse& resp) {
+        resp.set_body(g_body);
+    });
+    blind.set_thread_num(loop_num);
+    blind.start();
+    http.get_tcp_server().set_thread_num(loop_num);
+    http.start();
+    thread base_thread([&base_loop]() { base_loop.loop(); });
+
+    printf("conn_num: %d, seconds: %d, loop_num: %d, request size: %zu bytes\n", conn_num, seconds, loop_num, g_request.size());
+    run_bench("blind", blind, 9021, 1, conn_num, seconds);
+    for (int depth : { 1, 8, 32, 128 }) {
+        run_bench("http", http.get_tcp_server(), 9022, depth, conn_num, seconds);
+    }
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "http_parser.h"
+#include "http_scan.h"
+
+using namespace std;
+
+// 对比逐字节、SSE4.2、AVX2三种扫描实现解析浏览器大小请求头部的速度：
+// * scan：只做扫描，按行切分头部，对每个头部计算名称长度并检查值中的控制字符
+// * parse：完整的HttpParser解析（包括生成请求、查找特殊头部）
+// 以rdtsc计数统计每个周期处理的字节数（TSC频率，不随睿频变化），同时给出每个请求的耗时
+// 用法: ./http_scan_bench [iterations]
+
+// 与Chrome发出的请求相当的头部，约900字节
+static const string g_request =
+    "GET /static/js/app.bundle.min.js?v=20240915 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\", \"Google Chrome\";v=\"128\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/128.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Accept: */*\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Referer: https://www.example.com/products/list?category=books&page=3\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8,en-US;q=0.7\r\n"
+    "Cookie: session_id=4f9c2a7d8e1b43c6a5d0e7f8b9c1d2e3; _ga=GA1.1.1234567890.1712345678; "
+    "_ga_ABCDEF1234=GS1.1.1712345678.5.1.1712349999.0.0.0; theme=dark; lang=zh-CN; "
+    "csrftoken=Zt3kP9qLm2Xv8Rb1Nc7Wd4Yf6Hg0Js5A\r\n"
+    "\r\n";
+
+static inline uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// 只做扫描，返回一个与结果相关的值防止被优化掉
+static size_t scan_head(const HttpScanner& scanner, const char *data, size_t len)
+{
+    size_t sum = 0;
+    size_t pos = 0;
+    bool first = true;
+    while (pos < len) {
+        size_t lf = scanner.hs_find_lf(data, pos, len);
+        size_t end = (lf > pos && data[lf - 1] == '\r') ? lf - 1 : lf;
+        if (end == pos) {
+            break;
+        }
+        if (first) {
+            sum += scanner.hs_token_len(data + pos, end - pos);
+            sum += scanner.hs_find_ctl(data + pos, end - pos);
+            first = false;
+        }
+        else {
+            size_t name_len = scanner.hs_token_len(data + pos, end - pos);
+            size_t value_off = name_len + 1;
+            while (pos + value_off < end && data[pos + value_off] == ' ') {
+                value_off++;
+            }
+            sum += name_len + scanner.hs_find_ctl(data + pos + value_off, end - pos - value_off);
+        }
+        pos = lf + 1;
+    }
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    const char *data = g_request.data();
+    size_t len = g_request.size();
+
+    printf("request head: %zu bytes, iterations: %d\n", len, iterations);
+    for (HttpScanKind kind : { HttpScanKind::Scalar, HttpScanKind::Sse42, HttpScanKind::Avx2 }) {
+        const HttpScanner* scanner = http_get_scanner(kind);
+        if (scanner == nullptr) {
+            printf("%-7s not supported by cpu\n", kind == HttpScanKind::Avx2 ? "avx2" : "sse4.2");
+            continue;
+        }
+
+        //只扫描
+        volatile size_t sink = 0;
+        for (int i = 0; i < iterations / 10; i++) {
+            sink = sink + scan_head(*scanner, data, len);
+        }
+        uint64_t start = cycles();
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sink = sink + scan_head(*scanner, data, len);
+        }
+        uint64_t scan_cycles = cycles() - start;
+        double scan_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / iterations;
+
+        //完整解析
+        http_select_scanner(kind);
+        HttpParser parser;
+        for (int i = 0; i < iterations / 10; i++) {
+            parser.parse(data, len);
+            parser.reset();
+        }
+        size_t headers = 0;
+        start = cycles();
+        t0 = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            if (parser.parse(data, len) != HttpParser::Complete) {
+                printf("parse failed\n");
+                return 1;
+            }
+            headers += parser.request().rq_headers.size();
+            parser.reset();
+        }
+        uint64_t parse_cycles = cycles() - start;
+        double parse_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / iterations;
+
+        double total = static_cast<double>(len) * iterations;
+        printf("%-7s scan: %6.2f bytes/cycle %7.1f ns/req    parse: %6.2f bytes/cycle %7.1f ns/req (%zu headers)\n",
+               scanner->hs_name, total / scan_cycles, scan_ns, total / parse_cycles, parse_ns, headers / iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_parser.h"
+#include "http_scan.h"
+#include "http_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// HTTP解析器和服务器的测试：
+// * 扫描：SSE4.2/AVX2实现与逐字节实现的结果一致
+// * 解析器（每种扫描实现各一遍）：逐字节输入、流水线请求、Content-Length和chunked请求体、保持连接的判断、各种错误请求的状态码
+// * 服务器：流水线请求随机切分后发送，响应按请求顺序返回；Connection: close和错误请求在响应后关闭连接
+// 用法: ./http_test
+
+// 模拟输入缓冲区：数据分多次到达，每解析完一个请求从头部弹出
+struct Feeder {
+    HttpParser parser;
+    string buf;
+
+    // 追加数据并解析，返回最后一次解析的结果
+    HttpParser::Result feed(const string& data)
+    {
+        buf.append(data);
+        return parser.parse(buf.data(), buf.size());
+    }
+
+    void next()
+    {
+        buf.erase(0, parser.consumed());
+        parser.reset();
+    }
+};
+
+void test_simple()
+{
+    Feeder f;
+    auto r = f.feed("GET /index.html?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\nUser-Agent:  test  \r\n\r\n");
+    const HttpRequest& req = f.parser.request();
+    check(r == HttpParser::Complete, "simple GET complete");
+    check(req.rq_method == "GET" && req.rq_target == "/index.html?a=1&b=2", "method and target");
+    check(req.rq_path == "/index.html" && req.rq_query == "a=1&b=2", "path and query split");
+    check(req.rq_headers.size() == 2 && req.header("host") == "example.com", "case-insensitive header lookup");
+    check(req.header("User-Agent") == "test", "header value trimmed");
+    check(req.rq_body.empty() && req.rq_keep_alive && req.rq_minor_version == 1, "no body, HTTP/1.1 keep-alive");
+    check(f.parser.consumed() == f.buf.size(), "consumed whole request");
+}
+
+void test_byte_by_byte()
+{
+    string request = "POST /submit HTTP/1.1\r\nHost: x\r\nContent-Length: 11\r\n\r\nhello world";
+    Feeder f;
+    int complete_at = -1;
+    for (size_t i = 0; i < request.size(); i++) {
+        auto r = f.feed(string(1, request[i]));
+        if (r == HttpParser::Complete) {
+            complete_at = i;
+            break;
+        }
+        if (r == HttpParser::Error) {
+            break;
+        }
+        f.buf.reserve(f.buf.size() * 2 + 1);  //数据地址变化，解析器只能依赖偏移量
+    }
+    check(complete_at == (int)request.size() - 1, "byte-by-byte: complete only at last byte");
+    check(f.parser.request().rq_body == "hello world", "byte-by-byte: Content-Length body");
+    check(f.parser.request().header("Host") == "x", "byte-by-byte: headers survive buffer moves");
+}
+
+void test_pipeline()
+{
+    Feeder f;
+    string batch;
+    for (int i = 0; i < 3; i++) {
+        batch += "GET /" + to_string(i) + " HTTP/1.1\r\nHost: x\r\n\r\n";
+    }
+    batch += "GET /3 HTTP/1.1\r\nHo";   //最后一个请求不完整
+    f.feed(batch);
+    int parsed = 0;
+    bool order = true;
+    while (f.parser.parse(f.buf.data(), f.buf.size()) == HttpParser::Complete) {
+        order &= f.parser.request().rq_path == "/" + to_string(parsed);
+        parsed++;
+        f.next();
+    }
+    check(parsed == 3 && order, "pipeline: three complete requests in order");
+    auto r = f.feed("st: x\r\n\r\n");
+    check(r == HttpParser::Complete && f.parser.request().rq_path == "/3", "pipeline: partial request resumes");
+}
+
+void test_chunked()
+{
+    string request = "POST /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                     "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: t\r\n\r\nGET /next HTTP/1.1\r\n\r\n";
+    //每次最多输入7个字节
+    Feeder f;
+    HttpParser::Result r = HttpParser::Incomplete;
+    size_t fed = 0;
+    while (fed < request.size() && r == HttpParser::Incomplete) {
+        r = f.feed(request.substr(fed, 7));
+        fed += min<size_t>(7, request.size() - fed);
+    }
+    check(r == HttpParser::Complete && f.parser.request().rq_body == "hello world", "chunked body decoded across reads");
+    f.next();
+    r = f.feed(request.substr(fed));
+    check(r == HttpParser::Complete && f.parser.request().rq_path == "/next", "request after chunked body");
+}
+
+void test_keep_alive()
+{
+    struct Case { const char* request; bool keep_alive; };
+    Case cases[] = {
+        { "GET / HTTP/1.1\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nConnection: close\r\n\r\n", false },
+        { "GET / HTTP/1.0\r\n\r\n", false },
+        { "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nConnection: upgrade, close\r\n\r\n", false },
+    };
+    bool ok = true;
+    for (auto& c : cases) {
+        Feeder f;
+        ok &= f.feed(c.request) == HttpParser::Complete && f.parser.request().rq_keep_alive == c.keep_alive;
+    }
+    check(ok, "keep-alive by version and Connection header");
+}
+
+void test_errors()
+{
+    struct Case { string request; int status; };
+    vector<Case> cases = {
+        { "GET /\r\n\r\n", 400 },
+        { "GET / HTTP/2.0\r\n\r\n", 505 },
+        { "G(T / HTTP/1.1\r\n\r\n", 400 },
+        { "GET / HTTP/1.1\r\nNo colon here\r\n\r\n", 400 },
+        { "GET / HTTP/1.1\r\nBad Name: x\r\n\r\n", 400 },
+        { "GET / HTTP/1.1\r\nHost: x\r\n folded\r\n\r\n", 400 },
+        { "GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n", 400 },
+        { "GET /a\x01" "b HTTP/1.1\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nContent-Length: 99999999\r\n\r\n", 413 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", 501 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 400 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX", 400 },
+        { "GET / HTTP/1.1\r\nX: " + string(HTTP_MAX_HEADER_SIZE, 'a'), 431 },
+    };
+    bool ok = true;
+    for (auto& c : cases) {
+        Feeder f;
+        auto r = f.feed(c.request);
+        if (r != HttpParser::Error || f.parser.error_status() != c.status) {
+            printf("  request %.40s... got result %d status %d, expect %d\n", c.request.c_str(), (int)r,
+                   f.parser.error_status(), c.status);
+            ok = false;
+        }
+    }
+    check(ok, "malformed requests rejected with proper status");
+}
+
+// 向量化扫描与逐字节扫描的结果一致：随机数据中放入换行符、非token字符和控制字符，检查所有起止位置
+void test_scanners()
+{
+    const HttpScanner* scalar = http_get_scanner(HttpScanKind::Scalar);
+    mt19937 mt(99);
+    const char special[] = { '\n', '\r', '\t', ':', ' ', 0x7f, 0x01, (char)0x80, (char)0xff, '"', '~', '|' };
+    for (HttpScanKind kind : { HttpScanKind::Sse42, HttpScanKind::Avx2 }) {
+        const HttpScanner* scanner = http_get_scanner(kind);
+        if (scanner == nullptr) {
+            printf("%-60s %s\n", "scanner not supported by cpu", "skip");
+            continue;
+        }
+        bool ok = true;
+        for (int round = 0; round < 2000 && ok; round++) {
+            string data(mt() % 100, 'a');
+            for (auto& c : data) {
+                c = mt() % 8 == 0 ? special[mt() % sizeof(special)] : "aZ09-_.Xyz"[mt() % 10];
+            }
+            for (size_t from = 0; from <= data.size(); from++) {
+                ok &= scanner->hs_find_lf(data.data(), from, data.size()) == scalar->hs_find_lf(data.data(), from, data.size());
+                ok &= scanner->hs_token_len(data.data() + from, data.size() - from) == scalar->hs_token_len(data.data() + from, data.size() - from);
+                ok &= scanner->hs_find_ctl(data.data() + from, data.size() - from) == scalar->hs_find_ctl(data.data() + from, data.size() - from);
+            }
+        }
+        string what = string(scanner->hs_name) + " scanner matches scalar";
+        check(ok, what.c_str());
+    }
+}
+
+// 服务器测试的客户端连接
+static int connect_to(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    struct timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// 读取直到对端关闭或者超时
+static string read_all(int fd)
+{
+    string data;
+    char buf[4096];
+    while (true) {
+        int n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        data.append(buf, n);
+    }
+    return data;
+}
+
+void test_server(uint16_t port)
+{
+    //流水线请求随机切分成多段发送，最后一个请求要求关闭连接
+    string batch;
+    string expect;
+    const int num = 50;
+    for (int i = 0; i < num; i++) {
+        bool last = i == num - 1;
+        if (i % 5 == 1) {
+            batch += "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n2\r\n" + to_string(i % 10) + "x\r\n0\r\n\r\n";
+            expect += "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nabc" + to_string(i % 10) + "x";
+            continue;
+        }
+        string path = "/p" + to_string(i);
+        batch += "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + (last ? "Connection: close\r\n" : "") + "\r\n";
+        expect += "HTTP/1.1 200 OK\r\nContent-Length: " + to_string(path.size()) + "\r\n" +
+                  (last ? "Connection: close\r\n" : "") + "\r\n" + path;
+    }
+    int fd = connect_to(port);
+    mt19937 mt(7);
+    size_t sent = 0;
+    while (sent < batch.size()) {
+        size_t n = min(batch.size() - sent, static_cast<size_t>(mt() % 200 + 1));
+        if (write(fd, batch.data() + sent, n) != (ssize_t)n) {
+            break;
+        }
+        sent += n;
+        if (mt() % 4 == 0) {
+            usleep(1000);
+        }
+    }
+    string got = read_all(fd);
+    close(fd);
+    check(got == expect, "server: split pipelined requests answered in order, closed");
+
+    //HTTP/1.0默认关闭连接，HEAD请求没有响应体
+    fd = connect_to(port);
+    string req = "HEAD /head HTTP/1.0\r\n\r\n";
+    write(fd, req.data(), req.size());
+    got = read_all(fd);
+    close(fd);
+    check(got == "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: close\r\n\r\n", "server: HTTP/1.0 HEAD, no body, closed");
+
+    //错误请求回复400并关闭连接，后面的请求不再处理
+    fd = connect_to(port);
+    req = "GET / HTTP/1.1\r\n\r\nBROKEN\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+    write(fd, req.data(), req.size());
+    got = read_all(fd);
+    close(fd);
+    check(got == "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n/"
+                 "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+          "server: bad request gets 400 and close");
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    test_scanners();
+    //解析器测试在每种CPU支持的扫描实现下各运行一遍
+    for (HttpScanKind kind : { HttpScanKind::Scalar, HttpScanKind::Sse42, HttpScanKind::Avx2 }) {
+        if (!http_select_scanner(kind)) {
+            continue;
+        }
+        printf("---- parser with %s scanner ----\n", http_scanner().hs_name);
+        test_simple();
+        test_byte_by_byte();
+        test_pipeline();
+        test_chunked();
+        test_keep_alive();
+        test_errors();
+    }
+
+    uint16_t port = 18931;
+    atomic<bool> ready{ false };
+    thread server_thread([&]() {
+        EventLoop loop;
+        HttpServer server(&loop, "127.0.0.1", port);
+        server.get_tcp_server().set_thread_num(2);
+        server.set_request_cb([](const HttpRequest& req, HttpResponse& resp) {
+            resp.set_body(req.rq_method == "POST" ? req.rq_body : req.rq_path);
+        });
+        server.start();
+        ready = true;
+        loop.loop();
+    });
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::milliseconds(50));
+    test_server(port);
+
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+    }
+    else {
+        printf("all checks passed\n");
+    }
+    //服务器的事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(g_failed ? 1 : 0);
+}
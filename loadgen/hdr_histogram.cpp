@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+#include "hdr_histogram.h"
+
+HdrHistogram::HdrHistogram(int64_t lowest, int64_t highest, int significant_digits) :
+        hh_lowest(max<int64_t>(lowest, 1)), hh_highest(highest)
+{
+    assert(significant_digits >= 1 && significant_digits <= 5);
+    assert(hh_highest >= 2 * hh_lowest);
+
+    //第0段需要能直接区分2*10^digits个值，子桶数取不小于它的2的幂
+    int64_t largest_single_unit = 2 * static_cast<int64_t>(pow(10, significant_digits));
+    int sub_bucket_count_magnitude = static_cast<int>(ceil(log2(static_cast<double>(largest_single_unit))));
+    hh_sub_bucket_half_count_magnitude = max(sub_bucket_count_magnitude, 1) - 1;
+    int64_t sub_bucket_count = int64_t(1) << (hh_sub_bucket_half_count_magnitude + 1);
+    hh_sub_bucket_half_count = sub_bucket_count / 2;
+    hh_unit_magnitude = 63 - __builtin_clzll(static_cast<uint64_t>(hh_lowest));
+    hh_sub_bucket_mask = (sub_bucket_count - 1) << hh_unit_magnitude;
+
+    //每多一段，能表示的最大值翻倍
+    int64_t smallest_untrackable = sub_bucket_count << hh_unit_magnitude;
+    int buckets_needed = 1;
+    while (smallest_untrackable <= hh_highest) {
+        if (smallest_untrackable > INT64_MAX / 2) {
+            buckets_needed++;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        buckets_needed++;
+    }
+    hh_counts.assign((buckets_needed + 1) * hh_sub_bucket_half_count, 0);
+}
+
+int HdrHistogram::counts_index(int64_t value) const
+{
+    int pow2_ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | hh_sub_bucket_mask));
+    int bucket_index = pow2_ceiling - hh_unit_magnitude - (hh_sub_bucket_half_count_magnitude + 1);
+    int64_t sub_bucket_index = value >> (bucket_index + hh_unit_magnitude);
+    return static_cast<int>(((bucket_index + 1) << hh_sub_bucket_half_count_magnitude)
+                            + (sub_bucket_index - hh_sub_bucket_half_count));
+}
+
+int64_t HdrHistogram::value_from_index(int index) const
+{
+    int bucket_index = (index >> hh_sub_bucket_half_count_magnitude) - 1;
+    int64_t sub_bucket_index = (index & (hh_sub_bucket_half_count - 1)) + hh_sub_bucket_half_count;
+    if (bucket_index < 0) {
+        sub_bucket_index -= hh_sub_bucket_half_count;
+        bucket_index = 0;
+    }
+    return sub_bucket_index << (bucket_index + hh_unit_magnitude);
+}
+
+int64_t HdrHistogram::highest_equivalent(int index) const
+{
+    int bucket_index = max((index >> hh_sub_bucket_half_count_magnitude) - 1, 0);
+    return value_from_index(index) + (int64_t(1) << (bucket_index + hh_unit_magnitude)) - 1;
+}
+
+void HdrHistogram::record(int64_t value, int64_t count)
+{
+    value = min(max<int64_t>(value, 0), hh_highest);
+    hh_counts[counts_index(value)] += count;
+    hh_total += count;
+    hh_min = min(hh_min, value);
+    hh_max = max(hh_max, value);
+}
+
+void HdrHistogram::merge(const HdrHistogram& other)
+{
+    assert(hh_counts.size() == other.hh_counts.size() && hh_unit_magnitude == other.hh_unit_magnitude);
+    for (size_t i = 0; i < hh_counts.size(); i++) {
+        hh_counts[i] += other.hh_counts[i];
+    }
+    hh_total += other.hh_total;
+    hh_min = min(hh_min, other.hh_min);
+    hh_max = max(hh_max, other.hh_max);
+}
+
+void HdrHistogram::reset()
+{
+    fill(hh_counts.begin(), hh_counts.end(), 0);
+    hh_total = 0;
+    hh_min = INT64_MAX;
+    hh_max = 0;
+}
+
+int64_t HdrHistogram::value_at_percentile(double percentile) const
+{
+    if (hh_total == 0) {
+        return 0;
+    }
+    percentile = min(max(percentile, 0.0), 100.0);
+    int64_t target = max<int64_t>(static_cast<int64_t>(ceil(percentile / 100.0 * hh_total)), 1);
+    int64_t cumulative = 0;
+    for (size_t i = 0; i < hh_counts.size(); i++) {
+        cumulative += hh_counts[i];
+        if (cumulative >= target) {
+            //桶的上界可能超过实际记录的范围
+            return min(max(highest_equivalent(static_cast<int>(i)), hh_min), hh_max);
+        }
+    }
+    return hh_max;
+}
+
+double HdrHistogram::get_mean() const
+{
+    if (hh_total == 0) {
+        return 0;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < hh_counts.size(); i++) {
+        if (hh_counts[i] != 0) {
+            int64_t low = value_from_index(static_cast<int>(i));
+            sum += (low + (highest_equivalent(static_cast<int>(i)) - low) / 2.0) * hh_counts[i];
+        }
+    }
+    return sum / hh_total;
+}
+
+void HdrHistogram::print_percentiles(FILE* out, const char *name, double scale, const char *unit) const
+{
+    static const double percentiles[] = { 50, 75, 90, 99, 99.9, 99.99 };
+
+    int title_len = fprintf(out, "%s(%s)", name, unit);
+    fprintf(out, "  %10s %10s", "min", "mean");
+    for (double p : percentiles) {
+        char column[16];
+        snprintf(column, sizeof(column), "p%g", p);
+        fprintf(out, " %10s", column);
+    }
+    fprintf(out, " %10s\n", "max");
+
+    fprintf(out, "%*s  %10.1f %10.1f", title_len, "",
+            get_min() / scale, get_mean() / scale);
+    for (double p : percentiles) {
+        fprintf(out, " %10.1f", value_at_percentile(p) / scale);
+    }
+    fprintf(out, " %10.1f\n", get_max() / scale);
+}
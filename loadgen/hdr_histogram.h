@@ -0,0 +1,57 @@
+#ifndef __HDR_HISTOGRAM_H__
+#define __HDR_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/*
+   HDR（High Dynamic Range）直方图，用于记录延迟分布：
+   * 值域按2的幂分成若干段，每段再等分成相同个数的子桶，任意值的相对误差不超过10^-significant_digits
+   * 记录一个值只是计算下标和一次加法，O(1)且不分配内存；桶数组在构造时一次分配
+   * 每个压测线程一个直方图，不加锁，结束后合并到一起再计算百分位数
+   超过最大值的值按最大值记录
+*/
+class HdrHistogram
+{
+public:
+    // lowest：能区分的最小值（不小于1），highest：能记录的最大值，significant_digits：有效数字位数（1~5）
+    HdrHistogram(int64_t lowest, int64_t highest, int significant_digits);
+
+    void record(int64_t value, int64_t count = 1);  // 记录count次value
+
+    void merge(const HdrHistogram& other);  // 合并另一个直方图，两者的参数必须相同
+
+    void reset();  // 清空所有记录
+
+    int64_t value_at_percentile(double percentile) const;  // 百分位数（0~100）对应的值，返回所在桶能表示的最大值
+
+    int64_t get_count() const { return hh_total; }  // 记录的总次数
+    int64_t get_min() const { return hh_total ? hh_min : 0; }  // 记录的最小值
+    int64_t get_max() const { return hh_total ? hh_max : 0; }  // 记录的最大值
+    double get_mean() const;  // 平均值（按每个桶的中间值计算）
+
+    // 输出名为name的一行常用百分位数，值除以scale后按unit输出（例如记录纳秒、按微秒输出时scale为1000）
+    void print_percentiles(FILE* out, const char *name, double scale, const char *unit) const;
+
+private:
+    int counts_index(int64_t value) const;  // 值对应的桶下标
+    int64_t value_from_index(int index) const;  // 桶能表示的最小值
+    int64_t highest_equivalent(int index) const;  // 桶能表示的最大值
+
+    int64_t hh_lowest;
+    int64_t hh_highest;
+    int hh_unit_magnitude;  // log2(lowest)，低于该位的差别不区分
+    int hh_sub_bucket_half_count_magnitude;  // log2(子桶数/2)
+    int64_t hh_sub_bucket_half_count;  // 子桶数的一半
+    int64_t hh_sub_bucket_mask;  // 第0段能直接表示的值的掩码
+    vector<int64_t> hh_counts;  // 每个桶的计数
+
+    int64_t hh_total{ 0 };
+    int64_t hh_min{ INT64_MAX };
+    int64_t hh_max{ 0 };
+};
+
+#endif
@@ -0,0 +1,657 @@
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <thread>
+
+#include "load_gen.h"
+#include "event_loop.h"
+#include "pr.h"
+
+const int LOAD_READ_BUF_SIZE = 64 * 1024;  // 每个线程的读缓冲区大小
+const size_t LOAD_MAX_RESPONSE_HEAD = 16 * 1024;  // 响应头部的最大长度
+
+static inline int64_t now_ns()
+{
+    //与timerfd使用同一个时钟
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void LoadStats::merge(const LoadStats& other)
+{
+    ls_latency.merge(other.ls_latency);
+    ls_service.merge(other.ls_service);
+    ls_max_inflight = max(ls_max_inflight, other.ls_max_inflight);
+    ls_requests += other.ls_requests;
+    ls_responses += other.ls_responses;
+    ls_bad_status += other.ls_bad_status;
+    ls_connects += other.ls_connects;
+    ls_connect_errors += other.ls_connect_errors;
+    ls_io_errors += other.ls_io_errors;
+    ls_bytes_in += other.ls_bytes_in;
+    ls_bytes_out += other.ls_bytes_out;
+}
+
+void LoadStats::reset()
+{
+    ls_latency.reset();
+    ls_service.reset();
+    ls_max_inflight = 0;
+    ls_requests = ls_responses = ls_bad_status = 0;
+    ls_connects = ls_connect_errors = ls_io_errors = 0;
+    ls_bytes_in = ls_bytes_out = 0;
+}
+
+// 压测客户端的一个连接，只在所属线程中访问
+struct LoadConn {
+    enum State { Closed, Connecting, Connected };
+
+    int lc_index{ 0 };  // 在所属线程连接数组中的下标
+    int lc_fd{ -1 };
+    State lc_state{ Closed };
+    bool lc_want_write{ false };  // 是否注册了写事件
+
+    struct InFlight {
+        int64_t if_intended_ns;  // 计划发送时间，延迟从该时间开始计算；闭环和固定速率模式下为请求的开始时间
+        int64_t if_sent_ns;  // 开始写出的时间，0表示还没有写出
+    };
+    deque<InFlight> lc_inflight;  // 已经开始、还没有收到响应的请求，按发送顺序；只有开环模式下会有多个
+    size_t lc_written{ 0 };  // lc_inflight中已经完整写出的请求数
+    size_t lc_out_off{ 0 };  // 下一个要写出的请求已经写出的字节数
+    int64_t lc_next_due_ns{ 0 };  // 固定速率模式下下一个请求的发送时间
+    bool lc_scheduled{ false };  // 是否已经在发送计划中
+
+    //响应解析状态
+    string lc_head;  // 不完整的HTTP响应头部
+    int64_t lc_body_remain{ -1 };  // HTTP响应体剩余字节数，-1表示还在读头部
+    int lc_status{ 0 };  // HTTP响应状态码
+    bool lc_server_close{ false };  // 服务器在响应中要求关闭连接
+    size_t lc_echo_remain{ 0 };  // echo响应剩余字节数
+};
+
+// 一个压测线程：一个EventLoop、该线程的所有连接、固定速率模式下的发送计划和统计结果
+class LoadWorker
+{
+public:
+    LoadWorker(const LoadConfig& config, const sockaddr_in& addr, const vector<int>& global_index, int64_t interval_ns) :
+            lw_config(config), lw_addr(addr), lw_global_index(global_index), lw_interval_ns(interval_ns),
+            lw_conns(global_index.size()), lw_rbuf(LOAD_READ_BUF_SIZE)
+    {
+        for (size_t i = 0; i < lw_conns.size(); i++) {
+            lw_conns[i].lc_index = static_cast<int>(i);
+        }
+    }
+
+    void start() { lw_thread = thread([this]() { run(); }); }
+    void join() { lw_thread.join(); }
+
+    const LoadStats& get_stats() const { return lw_stats; }
+    double get_elapsed_sec() const { return lw_elapsed_ns / 1e9; }
+
+private:
+    void run();
+
+    void request_next(LoadConn* c);  // 闭环和固定速率模式下安排该连接的下一个请求
+    void start_request(LoadConn* c, int64_t intended_ns);  // 开始一个请求，没有连接时先建立连接
+    void finish_request(LoadConn* c);  // 收到最早的请求的完整响应
+    void reset_response(LoadConn* c);  // 准备解析下一个响应
+
+    void do_connect(LoadConn* c);
+    void on_connected(LoadConn* c);
+    void flush_request(LoadConn* c);  // 发送当前请求还没有发送的部分
+    void on_writable(LoadConn* c);
+    void on_readable(LoadConn* c);
+    size_t consume(LoadConn* c, const char *data, size_t len, bool* done, bool* error);  // 解析响应数据，返回使用的字节数
+    bool parse_http_head(LoadConn* c, size_t head_len);
+    void close_conn(LoadConn* c);
+    void fail_conn(LoadConn* c, bool connect_error);  // 连接出错，关闭后稍后重试
+
+    void schedule(LoadConn* c, int64_t due_ns);  // 在due_ns时开始该连接的下一个请求
+    void arm_timer(int64_t due_ns);
+    void on_timer();
+
+    const LoadConfig& lw_config;
+    sockaddr_in lw_addr;
+    vector<int> lw_global_index;  // 每个连接在所有连接中的序号，用于错开固定速率模式下的发送时间
+    int64_t lw_interval_ns;  // 固定速率和开环模式下每个连接的请求间隔，0表示闭环
+
+    EventLoop* lw_loop{ nullptr };
+    vector<LoadConn> lw_conns;
+    vector<char> lw_rbuf;  // 所有连接共用的读缓冲区，响应数据读出后立即解析
+
+    typedef pair<int64_t, int> DueEntry;  // (发送时间, 连接下标)
+    priority_queue<DueEntry, vector<DueEntry>, greater<DueEntry>> lw_due;  // 固定速率和开环模式下的发送计划
+    int lw_timer_fd{ -1 };
+    int64_t lw_armed_ns{ 0 };  // timerfd当前设置的到期时间，0表示没有设置
+
+    bool lw_running{ false };  // 是否在预热或统计期间，结束后不再发送请求、不再记录结果
+    int64_t lw_measure_start_ns{ 0 };
+    int64_t lw_elapsed_ns{ 0 };
+    LoadStats lw_stats;
+    thread lw_thread;
+};
+
+void LoadWorker::run()
+{
+    //EventLoop必须在执行loop的线程中创建
+    EventLoop loop;
+    lw_loop = &loop;
+
+    if (lw_interval_ns > 0) {
+        lw_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        loop.add_to_poller(lw_timer_fd, EPOLLIN, [this]() { on_timer(); });
+    }
+
+    lw_running = true;
+    int64_t start = now_ns();
+    lw_measure_start_ns = start + lw_config.lc_warmup_seconds * 1000000000LL;
+    for (LoadConn& c : lw_conns) {
+        if (lw_interval_ns > 0) {
+            if (lw_config.lc_keep_alive) {
+                do_connect(&c);  //长连接预先建立，第一个请求不包括建立连接的时间
+            }
+            //各个连接的第一个请求在一个间隔内均匀错开
+            c.lc_next_due_ns = start + lw_interval_ns * lw_global_index[c.lc_index] / lw_config.lc_conn_num;
+            schedule(&c, c.lc_next_due_ns);
+        }
+        else {
+            start_request(&c, now_ns());  //长连接建立后重新计时
+        }
+    }
+
+    if (lw_config.lc_warmup_seconds > 0) {
+        loop.run_after(lw_config.lc_warmup_seconds * 1000, [this]() {
+            lw_stats.reset();
+            lw_measure_start_ns = now_ns();
+        });
+    }
+    loop.run_after((lw_config.lc_warmup_seconds + lw_config.lc_seconds) * 1000, [this]() {
+        lw_elapsed_ns = now_ns() - lw_measure_start_ns;
+        lw_running = false;
+        lw_loop->quit();
+    });
+    loop.loop();
+
+    for (LoadConn& c : lw_conns) {
+        close_conn(&c);
+    }
+    if (lw_timer_fd >= 0) {
+        loop.del_from_poller(lw_timer_fd);
+        close(lw_timer_fd);
+    }
+    lw_loop = nullptr;
+}
+
+void LoadWorker::request_next(LoadConn* c)
+{
+    //开环模式下按时间表发送，与响应无关
+    if (!lw_running || lw_config.lc_open_loop) {
+        return;
+    }
+    if (lw_interval_ns == 0) {
+        start_request(c, now_ns());
+        return;
+    }
+    if (c->lc_scheduled) {
+        return;
+    }
+    //响应慢于请求间隔时不追赶落下的请求，实际速率会低于目标速率
+    int64_t now = now_ns();
+    c->lc_next_due_ns = max(c->lc_next_due_ns + lw_interval_ns, now);
+    if (c->lc_next_due_ns <= now) {
+        start_request(c, now);
+    }
+    else {
+        schedule(c, c->lc_next_due_ns);
+    }
+}
+
+void LoadWorker::start_request(LoadConn* c, int64_t intended_ns)
+{
+    if (!lw_running) {
+        return;
+    }
+    //闭环和固定速率模式下每个连接同时只有一个请求；开环模式下不等待响应，在同一个连接上流水线发送
+    if (!lw_config.lc_open_loop && !c->lc_inflight.empty()) {
+        return;
+    }
+    c->lc_inflight.push_back({ intended_ns, 0 });
+    lw_stats.ls_max_inflight = max<uint64_t>(lw_stats.ls_max_inflight, c->lc_inflight.size());
+    if (c->lc_state == LoadConn::Closed) {
+        do_connect(c);  //短连接的延迟包括建立连接的时间
+        return;
+    }
+    if (c->lc_state == LoadConn::Connected) {
+        flush_request(c);
+    }
+}
+
+void LoadWorker::finish_request(LoadConn* c)
+{
+    if (c->lc_written == 0) {
+        fail_conn(c, false);  //请求还没有发送完就收到了响应
+        return;
+    }
+    int64_t now = now_ns();
+    LoadConn::InFlight req = c->lc_inflight.front();
+    c->lc_inflight.pop_front();
+    c->lc_written--;
+
+    lw_stats.ls_responses++;
+    if (lw_config.lc_protocol == LoadProtocol::Http && (c->lc_status < 200 || c->lc_status >= 400)) {
+        lw_stats.ls_bad_status++;
+    }
+    lw_stats.ls_latency.record(now - req.if_intended_ns);
+    if (lw_config.lc_open_loop) {
+        lw_stats.ls_service.record(now - req.if_sent_ns);
+    }
+
+    bool close = !lw_config.lc_keep_alive || c->lc_server_close;
+    reset_response(c);
+    if (close) {
+        //服务器关闭连接后，开环模式下该连接上还没有收到响应的请求都失败
+        lw_stats.ls_io_errors += c->lc_inflight.size();
+        close_conn(c);
+        //在下一轮循环中重新连接，新连接可能复用同一个fd，不能在该fd的回调中注册
+        lw_loop->queue_task([this, c]() { request_next(c); });
+        return;
+    }
+    request_next(c);
+}
+
+void LoadWorker::reset_response(LoadConn* c)
+{
+    c->lc_head.clear();
+    c->lc_body_remain = -1;
+    c->lc_status = 0;
+    c->lc_server_close = false;
+    c->lc_echo_remain = lw_config.lc_request.size();
+}
+
+void LoadWorker::do_connect(LoadConn* c)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        PR_ERROR("create socket failed, errno %d\n", errno);
+        fail_conn(c, true);
+        return;
+    }
+    int op = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
+    c->lc_fd = fd;
+    c->lc_state = LoadConn::Connecting;
+    reset_response(c);
+    if (connect(fd, (const sockaddr*)&lw_addr, sizeof(lw_addr)) < 0 && errno != EINPROGRESS) {
+        fail_conn(c, true);
+        return;
+    }
+    lw_loop->add_to_poller(fd, EPOLLIN, [this, c]() { on_readable(c); });
+    lw_loop->add_to_poller(fd, EPOLLOUT, [this, c]() { on_writable(c); });
+    c->lc_want_write = true;
+}
+
+void LoadWorker::on_connected(LoadConn* c)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c->lc_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        fail_conn(c, true);
+        return;
+    }
+    c->lc_state = LoadConn::Connected;
+    lw_stats.ls_connects++;
+    if (c->lc_inflight.empty()) {
+        lw_loop->del_from_poller(c->lc_fd, EPOLLOUT);
+        c->lc_want_write = false;
+        return;
+    }
+    //长连接的闭环和固定速率模式不计算重新建立连接的时间；开环模式下按计划时间计算，等待连接的时间也计算在内
+    if (lw_config.lc_keep_alive && !lw_config.lc_open_loop) {
+        c->lc_inflight.front().if_intended_ns = now_ns();
+    }
+    flush_request(c);
+}
+
+void LoadWorker::flush_request(LoadConn* c)
+{
+    const string& req = lw_config.lc_request;
+    while (c->lc_written < c->lc_inflight.size()) {
+        LoadConn::InFlight& next = c->lc_inflight[c->lc_written];
+        if (next.if_sent_ns == 0) {
+            next.if_sent_ns = now_ns();
+            lw_stats.ls_requests++;
+        }
+        ssize_t n = ::send(c->lc_fd, req.data() + c->lc_out_off, req.size() - c->lc_out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;  //发送缓冲区满，开环模式下后面的请求等待写事件
+            }
+            fail_conn(c, false);
+            return;
+        }
+        c->lc_out_off += n;
+        lw_stats.ls_bytes_out += n;
+        if (c->lc_out_off == req.size()) {
+            c->lc_written++;
+            c->lc_out_off = 0;
+        }
+    }
+
+    bool pending = c->lc_written < c->lc_inflight.size();
+    if (pending && !c->lc_want_write) {
+        lw_loop->add_to_poller(c->lc_fd, EPOLLOUT, [this, c]() { on_writable(c); });
+        c->lc_want_write = true;
+    }
+    else if (!pending && c->lc_want_write) {
+        lw_loop->del_from_poller(c->lc_fd, EPOLLOUT);
+        c->lc_want_write = false;
+    }
+}
+
+void LoadWorker::on_writable(LoadConn* c)
+{
+    if (c->lc_state == LoadConn::Connecting) {
+        on_connected(c);
+    }
+    else if (c->lc_state == LoadConn::Connected) {
+        flush_request(c);
+    }
+}
+
+void LoadWorker::on_readable(LoadConn* c)
+{
+    if (c->lc_state != LoadConn::Connected) {
+        //连接失败时读事件也会就绪，由写事件处理
+        if (c->lc_state == LoadConn::Connecting) {
+            on_connected(c);
+        }
+        return;
+    }
+    ssize_t n = read(c->lc_fd, lw_rbuf.data(), lw_rbuf.size());
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        if (!c->lc_inflight.empty()) {
+            fail_conn(c, false);  //等待响应时被关闭
+        }
+        else {
+            close_conn(c);  //空闲时被服务器关闭（如空闲超时），下一个请求重新连接
+        }
+        return;
+    }
+    lw_stats.ls_bytes_in += n;
+
+    size_t off = 0;
+    while (off < static_cast<size_t>(n) && !c->lc_inflight.empty()) {
+        bool done = false;
+        bool error = false;
+        off += consume(c, lw_rbuf.data() + off, n - off, &done, &error);
+        if (error) {
+            fail_conn(c, false);
+            return;
+        }
+        if (done) {
+            finish_request(c);
+        }
+    }
+}
+
+size_t LoadWorker::consume(LoadConn* c, const char *data, size_t len, bool* done, bool* error)
+{
+    if (lw_config.lc_protocol == LoadProtocol::Echo) {
+        size_t take = min(len, c->lc_echo_remain);
+        c->lc_echo_remain -= take;
+        *done = c->lc_echo_remain == 0;
+        return take;
+    }
+
+    size_t used = 0;
+    if (c->lc_body_remain < 0) {
+        //头部可能跨越多次读取，结束标记可能被切开，从上次末尾往前3个字节开始查找
+        size_t old = c->lc_head.size();
+        c->lc_head.append(data, len);
+        size_t end = c->lc_head.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+        if (end == string::npos) {
+            *error = c->lc_head.size() > LOAD_MAX_RESPONSE_HEAD;
+            return len;
+        }
+        size_t head_len = end + 4;
+        used = head_len - old;
+        if (!parse_http_head(c, head_len)) {
+            *error = true;
+            return len;
+        }
+    }
+    size_t take = min(static_cast<size_t>(c->lc_body_remain), len - used);
+    c->lc_body_remain -= take;
+    *done = c->lc_body_remain == 0;
+    return used + take;
+}
+
+bool LoadWorker::parse_http_head(LoadConn* c, size_t head_len)
+{
+    const char *head = c->lc_head.data();
+    if (head_len < 12 || strncmp(head, "HTTP/1.", 7) != 0) {
+        return false;
+    }
+    c->lc_status = atoi(head + 9);
+    c->lc_server_close = head[7] == '0';  //HTTP/1.0默认关闭，有keep-alive头部时保持
+    c->lc_body_remain = 0;
+
+    size_t pos = c->lc_head.find("\r\n") + 2;
+    while (pos + 2 < head_len) {
+        size_t eol = c->lc_head.find("\r\n", pos);
+        const char *line = head + pos;
+        size_t line_len = eol - pos;
+        if (line_len > 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+            c->lc_body_remain = strtoll(line + 15, nullptr, 10);
+        }
+        else if (line_len > 11 && strncasecmp(line, "Connection:", 11) == 0) {
+            string value(line + 11, line_len - 11);
+            if (strcasestr(value.c_str(), "close") != nullptr) {
+                c->lc_server_close = true;
+            }
+            else if (strcasestr(value.c_str(), "keep-alive") != nullptr) {
+                c->lc_server_close = false;
+            }
+        }
+        else if (line_len > 18 && strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            PR_ERROR("chunked response is not supported\n");
+            return false;
+        }
+        pos = eol + 2;
+    }
+    c->lc_head.clear();
+    return c->lc_body_remain >= 0;
+}
+
+void LoadWorker::close_conn(LoadConn* c)
+{
+    if (c->lc_fd >= 0) {
+        lw_loop->del_from_poller(c->lc_fd);
+        close(c->lc_fd);
+    }
+    c->lc_fd = -1;
+    c->lc_state = LoadConn::Closed;
+    c->lc_want_write = false;
+    c->lc_inflight.clear();
+    c->lc_written = 0;
+    c->lc_out_off = 0;
+}
+
+void LoadWorker::fail_conn(LoadConn* c, bool connect_error)
+{
+    if (connect_error) {
+        lw_stats.ls_connect_errors++;
+    }
+    else {
+        lw_stats.ls_io_errors += max<size_t>(c->lc_inflight.size(), 1);
+    }
+    close_conn(c);
+    //服务器拒绝连接时不要忙等，等待一段时间后重试
+    lw_loop->run_after(LOAD_RECONNECT_DELAY_MS, [this, c]() { request_next(c); });
+}
+
+void LoadWorker::schedule(LoadConn* c, int64_t due_ns)
+{
+    c->lc_scheduled = true;
+    lw_due.emplace(due_ns, c->lc_index);
+    if (lw_armed_ns == 0 || due_ns < lw_armed_ns) {
+        arm_timer(due_ns);
+    }
+}
+
+void LoadWorker::arm_timer(int64_t due_ns)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = due_ns / 1000000000LL;
+    its.it_value.tv_nsec = due_ns % 1000000000LL;
+    timerfd_settime(lw_timer_fd, TFD_TIMER_ABSTIME, &its, nullptr);
+    lw_armed_ns = due_ns;
+}
+
+void LoadWorker::on_timer()
+{
+    uint64_t expirations;
+    if (read(lw_timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN) {
+        return;
+    }
+    lw_armed_ns = 0;
+    int64_t now = now_ns();
+    while (!lw_due.empty() && lw_due.top().first <= now) {
+        int64_t due = lw_due.top().first;
+        LoadConn* c = &lw_conns[lw_due.top().second];
+        lw_due.pop();
+        c->lc_scheduled = false;
+        if (lw_config.lc_open_loop) {
+            //延迟从计划时间开始计算，客户端自己没有及时发送的时间也计算在内；下一个请求的时间与响应无关
+            start_request(c, due);
+            c->lc_next_due_ns = due + lw_interval_ns;
+            schedule(c, c->lc_next_due_ns);
+        }
+        else {
+            start_request(c, now_ns());
+        }
+    }
+    if (!lw_due.empty()) {
+        arm_timer(lw_due.top().first);
+    }
+}
+
+
+LoadGenerator::LoadGenerator(const LoadConfig& config) : lg_config(config) {}
+
+LoadGenerator::~LoadGenerator() {}
+
+bool LoadGenerator::run()
+{
+    LoadConfig& cfg = lg_config;
+    if (cfg.lc_conn_num < 1 || cfg.lc_thread_num < 1 || cfg.lc_seconds < 1 || cfg.lc_warmup_seconds < 0
+        || cfg.lc_rate < 0 || cfg.lc_request.empty()) {
+        PR_ERROR("invalid load config\n");
+        return false;
+    }
+    if (cfg.lc_open_loop && (cfg.lc_rate <= 0 || !cfg.lc_keep_alive)) {
+        PR_ERROR("open loop mode needs a request rate and keep-alive connections\n");
+        return false;
+    }
+    cfg.lc_thread_num = min(cfg.lc_thread_num, cfg.lc_conn_num);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(cfg.lc_port);
+    if (inet_aton(cfg.lc_ip.c_str(), &addr.sin_addr) == 0) {
+        struct addrinfo hints;
+        struct addrinfo *res = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(cfg.lc_ip.c_str(), nullptr, &hints, &res) != 0 || res == nullptr) {
+            PR_ERROR("resolve host %s failed\n", cfg.lc_ip.c_str());
+            return false;
+        }
+        addr.sin_addr = ((sockaddr_in*)res->ai_addr)->sin_addr;
+        freeaddrinfo(res);
+    }
+
+    //每个连接按 连接数/总速率 的间隔发送请求
+    int64_t interval_ns = cfg.lc_rate > 0 ? static_cast<int64_t>(cfg.lc_conn_num * 1e9 / cfg.lc_rate) : 0;
+    lg_workers.clear();
+    for (int t = 0; t < cfg.lc_thread_num; t++) {
+        vector<int> global_index;
+        for (int i = t; i < cfg.lc_conn_num; i += cfg.lc_thread_num) {
+            global_index.push_back(i);
+        }
+        lg_workers.emplace_back(new LoadWorker(cfg, addr, global_index, interval_ns));
+    }
+    for (auto& worker : lg_workers) {
+        worker->start();
+    }
+
+    lg_stats.reset();
+    double elapsed = 0;
+    for (auto& worker : lg_workers) {
+        worker->join();
+        lg_stats.merge(worker->get_stats());
+        elapsed += worker->get_elapsed_sec();
+    }
+    lg_elapsed_sec = elapsed / lg_workers.size();
+    return true;
+}
+
+void LoadGenerator::print_report(FILE* out) const
+{
+    const LoadConfig& cfg = lg_config;
+    const LoadStats& st = lg_stats;
+    fprintf(out, "target %s:%d %s, %d connections (%s), %d threads, ", cfg.lc_ip.c_str(), (int)cfg.lc_port,
+            cfg.lc_protocol == LoadProtocol::Http ? "http" : "echo", cfg.lc_conn_num,
+            cfg.lc_keep_alive ? "keep-alive" : "new connection per request", cfg.lc_thread_num);
+    if (cfg.lc_open_loop) {
+        fprintf(out, "open loop %.0f req/s, ", cfg.lc_rate);
+    }
+    else if (cfg.lc_rate > 0) {
+        fprintf(out, "fixed rate %.0f req/s, ", cfg.lc_rate);
+    }
+    else {
+        fprintf(out, "closed loop, ");
+    }
+    fprintf(out, "%.2fs\n", lg_elapsed_sec);
+
+    fprintf(out, "requests %llu, responses %llu, bad status %llu, new connections %llu, connect errors %llu, io errors %llu\n",
+            (unsigned long long)st.ls_requests, (unsigned long long)st.ls_responses,
+            (unsigned long long)st.ls_bad_status, (unsigned long long)st.ls_connects,
+            (unsigned long long)st.ls_connect_errors, (unsigned long long)st.ls_io_errors);
+
+    double sec = lg_elapsed_sec > 0 ? lg_elapsed_sec : 1;
+    fprintf(out, "throughput %.1f req/s, in %.2f MB/s, out %.2f MB/s\n", st.ls_responses / sec,
+            st.ls_bytes_in / sec / (1024 * 1024), st.ls_bytes_out / sec / (1024 * 1024));
+    if (!cfg.lc_open_loop) {
+        st.ls_latency.print_percentiles(out, "latency", 1000.0, "us");
+        return;
+    }
+    //开环模式下同时给出从实际发送开始的服务时间，两者的差别是请求在客户端等待发送的时间
+    fprintf(out, "max in-flight requests per connection %llu\n", (unsigned long long)st.ls_max_inflight);
+    st.ls_latency.print_percentiles(out, "latency", 1000.0, "us");
+    st.ls_service.print_percentiles(out, "service", 1000.0, "us");
+}
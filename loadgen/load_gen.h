@@ -0,0 +1,89 @@
+#ifndef __LOAD_GEN_H__
+#define __LOAD_GEN_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hdr_histogram.h"
+
+using namespace std;
+
+const int64_t LOAD_LATENCY_MAX_NS = 60LL * 1000 * 1000 * 1000;  // 直方图能记录的最大延迟(60s)
+const int LOAD_LATENCY_DIGITS = 3;  // 直方图的有效数字位数，误差不超过0.1%
+const int LOAD_RECONNECT_DELAY_MS = 10;  // 连接失败后重新连接的等待时间(ms)
+
+// 请求协议
+enum class LoadProtocol {
+    Http,  // 发送HTTP请求，按Content-Length读取完整的响应
+    Echo,  // 发送固定长度的数据，收到同样长度的数据即为一个完整的响应
+};
+
+// 压测配置
+struct LoadConfig {
+    string lc_ip{ "127.0.0.1" };  // 服务器地址
+    uint16_t lc_port{ 8888 };  // 服务器端口
+    LoadProtocol lc_protocol{ LoadProtocol::Http };
+    string lc_request;  // 每次发送的请求数据
+    int lc_conn_num{ 16 };  // 总连接数，按轮询分配到各个线程
+    int lc_thread_num{ 2 };  // 线程数，每个线程一个EventLoop
+    int lc_seconds{ 10 };  // 统计时长(s)
+    int lc_warmup_seconds{ 1 };  // 预热时长(s)，预热期间的结果不计入统计
+    double lc_rate{ 0 };  // 总请求速率(req/s)，0表示闭环：收到响应后立即发送下一个请求
+    bool lc_open_loop{ false };  // 开环模式，需要lc_rate和长连接：按固定的时间表发送请求，不等待响应，延迟从计划发送时间开始计算
+    bool lc_keep_alive{ true };  // 是否保持连接，false时每个请求新建一个连接，延迟包括建立连接的时间
+};
+
+// 压测统计结果，每个线程一份，结束后合并
+struct LoadStats {
+    HdrHistogram ls_latency{ 1, LOAD_LATENCY_MAX_NS, LOAD_LATENCY_DIGITS };  // 请求延迟(ns)，开环模式下从计划发送时间开始
+    HdrHistogram ls_service{ 1, LOAD_LATENCY_MAX_NS, LOAD_LATENCY_DIGITS };  // 开环模式下从实际发送开始的服务时间(ns)
+    uint64_t ls_requests{ 0 };  // 发送的请求数
+    uint64_t ls_responses{ 0 };  // 收到的完整响应数
+    uint64_t ls_bad_status{ 0 };  // HTTP状态码不是2xx/3xx的响应数
+    uint64_t ls_connects{ 0 };  // 建立的连接数
+    uint64_t ls_connect_errors{ 0 };  // 连接失败次数
+    uint64_t ls_io_errors{ 0 };  // 读写出错或连接被服务器关闭而没有收到响应的请求数
+    uint64_t ls_max_inflight{ 0 };  // 一个连接上同时等待响应的最大请求数
+    uint64_t ls_bytes_in{ 0 };  // 接收的字节数
+    uint64_t ls_bytes_out{ 0 };  // 发送的字节数
+
+    void merge(const LoadStats& other);
+    void reset();
+};
+
+class LoadWorker;
+
+/*
+   基于EventLoop的压测客户端：
+   * lc_thread_num个线程，每个线程一个EventLoop，线程中的所有连接都是非阻塞socket，由该线程的epoll驱动
+   * 闭环模式下每个连接收到响应后立即发送下一个请求；固定速率模式下每个连接按 连接数/速率 的间隔发送请求，
+     由每个线程一个的timerfd按纳秒精度触发；响应慢于间隔时收到响应后立即发送，不追赶落下的请求
+   * 延迟从实际发送请求（短连接从开始建立连接）到收到完整响应，记录在每个线程自己的HDR直方图中，不加锁
+   * 闭环和固定速率模式下，服务器停顿时客户端也在等待，停顿期间本应发出的请求没有发出，也就没有被记录（coordinated omission），
+     尾延迟被严重低估；开环模式按固定的到达速率发送，不等待响应（同一个连接上流水线发送），
+     延迟从计划发送时间开始计算，服务器或客户端自己的停顿都会完整反映在延迟分布中
+*/
+class LoadGenerator
+{
+public:
+    explicit LoadGenerator(const LoadConfig& config);
+    ~LoadGenerator();
+
+    bool run();  // 执行压测，阻塞到预热和统计时长结束，配置错误时返回false
+
+    const LoadStats& get_stats() const { return lg_stats; }  // 合并后的统计结果
+    double get_elapsed_sec() const { return lg_elapsed_sec; }  // 实际统计时长(s)
+
+    void print_report(FILE* out) const;  // 输出吞吐量、错误数和延迟百分位数
+
+private:
+    LoadConfig lg_config;
+    vector<unique_ptr<LoadWorker>> lg_workers;
+    LoadStats lg_stats;
+    double lg_elapsed_sec{ 0 };
+};
+
+#endif
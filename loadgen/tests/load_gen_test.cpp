@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "hdr_histogram.h"
+#include "load_gen.h"
+#include "http_server.h"
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 压测客户端的测试：
+// * HDR直方图：百分位数的相对误差不超过0.1%，合并后与一起记录的结果相同，超出范围的值按最大值记录
+// * 压测客户端：对本进程中的echo服务器和HTTP服务器分别进行闭环长连接、短连接、固定速率和开环压测，检查响应数和错误数
+// * 服务器周期性停顿时，固定速率模式的p90看不到停顿，开环模式的p90就能反映停顿
+// 用法: ./load_gen_test
+
+static bool near(int64_t value, int64_t expect, double tolerance)
+{
+    return value >= expect * (1 - tolerance) && value <= expect * (1 + tolerance);
+}
+
+void test_histogram()
+{
+    HdrHistogram h(1, LOAD_LATENCY_MAX_NS, 3);
+    for (int64_t v = 1; v <= 1000000; v++) {
+        h.record(v);
+    }
+    check(h.get_count() == 1000000 && h.get_min() == 1 && h.get_max() == 1000000, "histogram: count, min and max exact");
+    bool ok = true;
+    for (double p : { 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 99.99 }) {
+        ok &= near(h.value_at_percentile(p), static_cast<int64_t>(p * 10000), 0.001);
+    }
+    check(ok, "histogram: percentiles within 0.1%");
+    check(near(static_cast<int64_t>(h.get_mean()), 500000, 0.001), "histogram: mean within 0.1%");
+    check(h.value_at_percentile(100) == 1000000, "histogram: p100 is max");
+
+    //分成两半记录再合并，与一起记录的结果相同
+    mt19937_64 mt(7);
+    HdrHistogram all(1, LOAD_LATENCY_MAX_NS, 3);
+    HdrHistogram a(1, LOAD_LATENCY_MAX_NS, 3);
+    HdrHistogram b(1, LOAD_LATENCY_MAX_NS, 3);
+    for (int i = 0; i < 100000; i++) {
+        int64_t v = mt() % 50000000;
+        all.record(v);
+        (i % 2 ? a : b).record(v);
+    }
+    a.merge(b);
+    ok = a.get_count() == all.get_count() && a.get_max() == all.get_max() && a.get_min() == all.get_min();
+    for (double p : { 50.0, 99.0, 99.9 }) {
+        ok &= a.value_at_percentile(p) == all.value_at_percentile(p);
+    }
+    check(ok, "histogram: merge equals recording together");
+
+    h.reset();
+    h.record(LOAD_LATENCY_MAX_NS * 10);
+    h.record(-5);
+    check(h.get_count() == 2 && h.get_max() == LOAD_LATENCY_MAX_NS && h.get_min() == 0, "histogram: out of range values clamped");
+}
+
+static LoadStats run_load(LoadConfig cfg)
+{
+    LoadGenerator gen(cfg);
+    gen.run();
+    gen.print_report(stdout);
+    return gen.get_stats();
+}
+
+void test_load(uint16_t echo_port, uint16_t http_port)
+{
+    LoadConfig cfg;
+    cfg.lc_conn_num = 4;
+    cfg.lc_thread_num = 2;
+    cfg.lc_seconds = 1;
+    cfg.lc_warmup_seconds = 0;
+
+    //echo闭环长连接
+    cfg.lc_port = echo_port;
+    cfg.lc_protocol = LoadProtocol::Echo;
+    cfg.lc_request.assign(100, 'e');
+    LoadStats st = run_load(cfg);
+    check(st.ls_responses > 100 && st.ls_connect_errors == 0 && st.ls_io_errors == 0
+          && static_cast<uint64_t>(st.ls_latency.get_count()) == st.ls_responses && st.ls_bytes_in == st.ls_responses * 100,
+          "echo: closed loop keep-alive");
+
+    //HTTP闭环长连接
+    cfg.lc_port = http_port;
+    cfg.lc_protocol = LoadProtocol::Http;
+    cfg.lc_request = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    st = run_load(cfg);
+    check(st.ls_responses > 100 && st.ls_bad_status == 0 && st.ls_io_errors == 0 && st.ls_connects == 4,
+          "http: closed loop keep-alive, connections reused");
+
+    //HTTP短连接，每个请求一个连接
+    cfg.lc_keep_alive = false;
+    cfg.lc_request = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    st = run_load(cfg);
+    check(st.ls_responses > 10 && st.ls_io_errors == 0 && st.ls_connects >= st.ls_responses,
+          "http: new connection per request");
+
+    //HTTP固定速率
+    cfg.lc_keep_alive = true;
+    cfg.lc_rate = 500;
+    cfg.lc_seconds = 2;
+    cfg.lc_request = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    st = run_load(cfg);
+    check(near(st.ls_responses, 1000, 0.1) && st.ls_io_errors == 0, "http: fixed rate 500 req/s");
+
+    //echo开环，同一个连接上流水线发送
+    cfg.lc_port = echo_port;
+    cfg.lc_protocol = LoadProtocol::Echo;
+    cfg.lc_request.assign(100, 'e');
+    cfg.lc_open_loop = true;
+    cfg.lc_rate = 2000;
+    st = run_load(cfg);
+    check(near(st.ls_responses, 4000, 0.1) && st.ls_io_errors == 0 && static_cast<uint64_t>(st.ls_service.get_count()) == st.ls_responses,
+          "echo: open loop 2000 req/s");
+    cfg.lc_open_loop = false;
+
+    //服务器不存在时记录连接错误，不会忙等
+    cfg.lc_port = 1;
+    cfg.lc_rate = 0;
+    cfg.lc_seconds = 1;
+    st = run_load(cfg);
+    check(st.ls_responses == 0 && st.ls_connect_errors > 0 && st.ls_connect_errors < 4 * 1000 / LOAD_RECONNECT_DELAY_MS * 2,
+          "connect errors counted and retried with delay");
+}
+
+// 服务器每隔500ms停顿100ms（模拟事件循环中执行很慢的任务）
+void test_stall(uint16_t stall_port)
+{
+    LoadConfig cfg;
+    cfg.lc_port = stall_port;
+    cfg.lc_conn_num = 4;
+    cfg.lc_thread_num = 2;
+    cfg.lc_seconds = 2;
+    cfg.lc_warmup_seconds = 0;
+    cfg.lc_rate = 1000;
+    cfg.lc_request = "GET /stall HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+    //固定速率：停顿期间每个连接只有一个请求在等待，其余请求没有发出
+    LoadStats fixed = run_load(cfg);
+    cfg.lc_open_loop = true;
+    LoadStats open = run_load(cfg);
+
+    //固定速率下停顿只影响每个连接上等待的一个请求，约占1%，p99会落在边界上，比较p90
+    int64_t fixed_p90 = fixed.ls_latency.value_at_percentile(90);
+    int64_t open_p90 = open.ls_latency.value_at_percentile(90);
+    printf("fixed rate p90 %.1fms, open loop p90 %.1fms\n", fixed_p90 / 1e6, open_p90 / 1e6);
+    check(open.ls_max_inflight > 10 && open_p90 > 20 * 1000000LL && fixed_p90 * 2 < open_p90,
+          "stalls: hidden by fixed rate, visible in open loop");
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+    pr_level = PR_LEVEL_ERROR;
+    signal(SIGPIPE, SIG_IGN);
+
+    test_histogram();
+
+    uint16_t echo_port = 18951;
+    uint16_t http_port = 18952;
+    uint16_t stall_port = 18953;
+    atomic<bool> ready{ false };
+    thread server_thread([&]() {
+        EventLoop loop;
+        TcpServer echo(&loop, "127.0.0.1", echo_port);
+        echo.set_message_cb([](const TcpConnSP& conn, InputBuffer* ibuf) {
+            conn->send(ibuf->get_from_buf(), ibuf->length());
+            ibuf->pop(ibuf->length());
+            ibuf->adjust();
+        });
+        echo.set_thread_num(1);
+        echo.start();
+        HttpServer http(&loop, "127.0.0.1", http_port);
+        http.get_tcp_server().set_thread_num(1);
+        http.set_request_cb([](const HttpRequest&, HttpResponse& resp) {
+            resp.set_body("hello load generator");
+        });
+        http.start();
+        HttpServer stall(&loop, "127.0.0.1", stall_port);
+        stall.get_tcp_server().set_thread_num(1);
+        int64_t last_stall = 0;
+        stall.set_request_cb([&last_stall](const HttpRequest&, HttpResponse& resp) {
+            int64_t now = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+            if (now - last_stall >= 500) {
+                last_stall = now;
+                this_thread::sleep_for(chrono::milliseconds(100));
+            }
+            resp.set_body("ok");
+        });
+        stall.start();
+        ready = true;
+        loop.loop();
+    });
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::milliseconds(50));
+    test_load(echo_port, http_port);
+    test_stall(stall_port);
+
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+    }
+    else {
+        printf("all checks passed\n");
+    }
+    //服务器的事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(g_failed ? 1 : 0);
+}
@@ -0,0 +1,32 @@
+#! /bin/sh
+
+# 在本机回环上对echo_server和http_for_bench分别进行闭环压测和几种速率的开环压测，对比延迟分布
+# 闭环的延迟只反映服务器能及时处理时的情况，开环的延迟从计划发送时间开始计算，包括服务器停顿期间积压的请求
+# 用法: sh open_loop_bench.sh [build_dir] [seconds] [rate...]
+# build_dir为cmake的构建目录，默认为../../../build/Debug
+
+BUILD=${1:-../../../build/Debug}
+DURATION=${2:-5}
+if [ $# -gt 2 ]; then
+    shift 2
+    RATES="$*"
+else
+    RATES="5000 20000 50000"
+fi
+LOAD_GEN=$BUILD/loadgen/tests/load_gen
+
+$BUILD/net/tests/echo_server > /dev/null 2>&1 &
+ECHO_PID=$!
+$BUILD/net/tests/http_for_bench 127.0.0.1 8889 2 > /dev/null 2>&1 &
+HTTP_PID=$!
+trap 'kill $ECHO_PID $HTTP_PID 2> /dev/null' EXIT
+sleep 1
+
+for target in "-e 64 127.0.0.1:8888" "http://127.0.0.1:8889/index.html"; do
+    echo "==== closed loop: $target"
+    $LOAD_GEN -c 16 -t 2 -d $DURATION $target
+    for rate in $RATES; do
+        echo "==== open loop $rate req/s: $target"
+        $LOAD_GEN -c 16 -t 2 -d $DURATION -o -r $rate $target
+    done
+done
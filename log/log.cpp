@@ -3,12 +3,21 @@
 #include <chrono>
 #include <stdarg.h>
 #include <stdexcept>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #include "log.h"
 
 using namespace std;
 
 Logger::log_level g_log_level = Logger::LOG_LEVEL_INFO;
 
+const int LOG_IOV_MAX = 1024;        // 后台线程单次writev的最大iovec数量
+const int LOG_FLUSH_BYTES = 64 * 1024;      // 同步模式下日志文件缓冲区大小，写满即写出
+const int LOG_FLUSH_INTERVAL_MS = 1000;     // 同步模式下缓冲区中的日志最长的滞留时间
+const int LOG_IDLE_SPINS = 64;       // 后台线程休眠之前让出CPU的次数，连续写日志时减少休眠和唤醒
+const int LOG_BINARY_QUEUE_SIZE = 64;       // 二进制日志未指定缓冲队列大小时使用的默认值
+
 const char* LogLevelName[Logger::NUM_LOG_LEVELS] =
 {
   "[ERROR]",
@@ -27,14 +36,122 @@ struct my_time
     char second; 
 };
 
+const int LOG_TIME_LEN = 19;   // "YYYY-MM-DD HH:MM:SS"的长度
+
+// 线程本地的时间戳缓存，秒数不变时直接复用已经格式化好的时间字符串
+// 只有秒数变化时才调用localtime_r和snprintf，避免每条日志都进入glibc的时区锁
+struct LogTimeCache
+{
+    time_t sec = -1;
+    my_time tm;
+    char str[40];  // 按各字段的最大宽度留出空间（int年份11字节、5个char字段各4字节、5个分隔符和结尾共37字节），实际只用前LOG_TIME_LEN字节
+};
+
+static thread_local LogTimeCache t_time_cache;
+
+//获取当前系统时间，usec不为空时返回当前秒内的微秒数
+static const LogTimeCache &get_cached_time(long *usec)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (ts.tv_sec != t_time_cache.sec)
+    {
+        struct tm tm_buf;
+        localtime_r(&ts.tv_sec, &tm_buf);
+        t_time_cache.tm = { tm_buf.tm_year + 1900, static_cast<char>(tm_buf.tm_mon + 1), static_cast<char>(tm_buf.tm_mday),
+                static_cast<char>(tm_buf.tm_hour), static_cast<char>(tm_buf.tm_min), static_cast<char>(tm_buf.tm_sec)};
+        snprintf(t_time_cache.str, sizeof(t_time_cache.str), "%04d-%02d-%02d %02d:%02d:%02d",
+                 t_time_cache.tm.year, t_time_cache.tm.month, t_time_cache.tm.day,
+                 t_time_cache.tm.hour, t_time_cache.tm.minute, t_time_cache.tm.second);
+        t_time_cache.sec = ts.tv_sec;
+    }
+    if (usec)
+    {
+        *usec = ts.tv_nsec / 1000;
+    }
+    return t_time_cache;
+}
+
 //获取当前系统时间
 static my_time get_current_sys_time()
 {
-    auto tt = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    struct tm* ptm = localtime(&tt);
-    my_time t = { ptm->tm_year + 1900, static_cast<char>(ptm->tm_mon + 1), static_cast<char>(ptm->tm_mday),
-            static_cast<char>(ptm->tm_hour), static_cast<char>(ptm->tm_min), static_cast<char>(ptm->tm_sec)};
-    return t;
+    return get_cached_time(NULL).tm;
+}
+
+//把当前时间按精度写入buf，返回写入的长度，毫秒/微秒部分逐位写入，不经过snprintf
+static int format_log_time(char *buf, Logger::time_precision precision, my_time *tm)
+{
+    long usec = 0;
+    const LogTimeCache &cache = get_cached_time(&usec);
+    memcpy(buf, cache.str, LOG_TIME_LEN);
+    *tm = cache.tm;
+
+    int digits = 0;
+    if (precision == Logger::LOG_TIME_MILLI)
+    {
+        digits = 3;
+        usec /= 1000;
+    }
+    else if (precision == Logger::LOG_TIME_MICRO)
+    {
+        digits = 6;
+    }
+    if (digits == 0)
+    {
+        return LOG_TIME_LEN;
+    }
+
+    buf[LOG_TIME_LEN] = '.';
+    for (int i = digits; i > 0; i--)
+    {
+        buf[LOG_TIME_LEN + i] = '0' + usec % 10;
+        usec /= 10;
+    }
+    return LOG_TIME_LEN + 1 + digits;
+}
+
+// 线程退出时通知后台线程回收该线程的环形缓冲区
+struct LogRingHolder
+{
+    LogRing *ring = nullptr;
+    ~LogRingHolder()
+    {
+        if(ring)
+        {
+            ring->close();
+        }
+    }
+};
+
+static thread_local LogRingHolder t_ring_holder;
+
+// 把iov全部写入fd，处理writev只写出部分数据的情况
+static void writev_all(int fd, struct iovec *iov, int iov_cnt)
+{
+    while(iov_cnt > 0)
+    {
+        ssize_t n = writev(fd, iov, iov_cnt);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            PR_ERROR("write log failed, errno %d\n", errno);
+            return;
+        }
+        while(iov_cnt > 0 && static_cast<size_t>(n) >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            iov_cnt--;
+        }
+        if(iov_cnt > 0)
+        {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
 }
 
 //日志类无参构造
@@ -47,32 +164,60 @@ Logger::Logger()
 //析构函数
 Logger::~Logger()
 {
+    {
+        lock_guard<mutex> lck (l_async_mutex);  //加锁后再修改，避免后台线程检查条件之后、休眠之前错过唤醒
+        is_thread_stop = true; //后台线程标志改变为停止状态
+    }
+    l_async_cond.notify_all();  //唤醒休眠的后台线程
+    if(l_flush_thread)
+    {
+        l_flush_thread->join();
+        delete l_flush_thread;
+        l_flush_thread = nullptr;
+    }
+
     if(l_asyncw_thread)
     {
-        is_thread_stop = true; //异步写入线程标志改变为停止状态
         if(l_asyncw_thread->joinable())  //和主线程之间仍然存在联系
         {
-            l_buffer_queue->notify();  //唤醒所有读取数据的线程
-            l_asyncw_thread->join();   //主线程阻塞等待该线程运行结束后，系统自动回收该线程资源
+            l_asyncw_thread->join();   //主线程阻塞等待该线程写完剩余日志后退出，系统自动回收该线程资源
         }
         delete l_asyncw_thread;   //删除该指针
-        l_asyncw_thread==nullptr;   
+        l_asyncw_thread = nullptr;
+
+        long long dropped = get_dropped_count();
+        if(dropped > 0)
+        {
+            PR_WARN("async logger dropped %lld records\n", dropped);
+        }
+        for(LogRing *ring : l_rings)
+        {
+            delete ring;
+        }
+        l_rings.clear();
     }
 
     lock_guard<mutex> lck (l_mutex);
-    if (l_fp != NULL)   //关闭文件
+    if (l_fp != NULL)   //关闭文件，同时写出缓冲区中剩余的日志
     {
-        fclose(l_fp);
+        if (l_fp == stdout)
+        {
+            fflush(l_fp);
+        }
+        else
+        {
+            fclose(l_fp);
+        }
     }
 
-    if(l_buf)    //清除日志缓冲区
+    if(l_file_buf)
     {
-        delete [] l_buf;
+        delete [] l_file_buf;
     }
 
-    if(l_buffer_queue)  //删除缓冲队列指针
+    if(l_buf)    //清除日志缓冲区
     {
-        delete l_buffer_queue;
+        delete [] l_buf;
     }
 }
 
@@ -103,12 +248,23 @@ Logger::~Logger()
     //设置日志级别
     set_log_level(level);
 
+    //二进制日志只能写入文件，并且总是使用异步写入
+    if (l_is_binary && l_is_stdout)
+    {
+        PR_ERROR("binary log must be written to a file, fall back to text log\n");
+        l_is_binary = false;
+    }
+    if (l_is_binary && buffer_queue_size < 1)
+    {
+        buffer_queue_size = LOG_BINARY_QUEUE_SIZE;
+    }
+
     //如果设置缓冲队列的缓冲区数量大于1,则表明使用异步写入
+    //每个写日志的线程首次写日志时创建自己的环形缓冲区，异步写入线程在日志文件打开之后启动
     if (buffer_queue_size >= 1)
     {
         l_is_async = true;
-        l_buffer_queue = new buffer_queue<string>(buffer_queue_size);  //初始化缓冲队列
-        l_asyncw_thread = new thread(&Logger::async_flush);  //初始化异步写入线程，用于将缓冲队列中的数据写入日志文件中
+        l_ring_size = static_cast<size_t>(buffer_queue_size) * buffer_size;
     }
     
     l_buf_size = buffer_size;   // 设置缓冲区大小
@@ -124,6 +280,14 @@ Logger::~Logger()
     {
         l_inited = true;
         l_fp = stdout;   // 设置日志输出至stdout
+        if(l_is_async)
+        {
+            l_asyncw_thread = new thread(&Logger::async_flush);  //初始化异步写入线程，用于将各线程环形缓冲区中的数据写入日志
+        }
+        else
+        {
+            l_flush_thread = new thread(&Logger::flush_loop, this);  //定时刷新stdout缓冲区
+        }
         PR_DEBUG("succeed in using stdout as log output\n");
         PR_DEBUG("log init finished!\n");
         return true;
@@ -159,6 +323,21 @@ Logger::~Logger()
 
     //初始化成功
     l_inited = true;
+    if(l_is_binary)
+    {
+        write_binary_head();
+    }
+    if(l_is_async)
+    {
+        l_asyncw_thread = new thread(&Logger::async_flush);  //初始化异步写入线程，用于将各线程环形缓冲区中的数据写入日志文件中
+    }
+    else
+    {
+        //同步模式下使用较大的stdio缓冲区，写满后由stdio一次写出，其余由刷新线程定时写出
+        l_file_buf = new char[LOG_FLUSH_BYTES];
+        setvbuf(l_fp, l_file_buf, _IOFBF, LOG_FLUSH_BYTES);
+        l_flush_thread = new thread(&Logger::flush_loop, this);
+    }
     PR_DEBUG("succeed in using file %s as log output\n", log_file_fullname); //输出写入日志的名字
     PR_DEBUG("log init finished!\n");
 
@@ -168,7 +347,34 @@ Logger::~Logger()
 //写日志
 void Logger::write_log(const char* file_name, const char* tn_callbackname, int line_no, log_level level, const char *format, ...)
 {
-    my_time my_tm = get_current_sys_time();
+    my_time my_tm;
+    char time_str[32];
+    int time_len = format_log_time(time_str, l_time_precision, &my_tm);
+
+    //使用异步写入：在线程自己的环形缓冲区中格式化并追加日志，不加锁，缓冲区满时等待后台线程写出（或按设置丢弃）
+    //日志文件的切换由异步写入线程完成
+    if (l_is_async)
+    {
+        LogRing *ring = get_thread_ring();
+        char *buf = ring->get_scratch();
+        int size = ring->get_scratch_size();
+
+        memcpy(buf, time_str, time_len);
+        int n = time_len + snprintf(buf + time_len, 300, " %s [%s:%s:%d] ",
+                            LogLevelName[level], file_name, tn_callbackname, line_no);
+
+        va_list valst;
+        va_start(valst, format);
+        int m = vsnprintf(buf + n, size - n - 1, format, valst);
+        va_end(valst);
+        if (m > size - n - 2)  //日志过长被截断
+        {
+            m = size - n - 2;
+        }
+        buf[n + m] = '\n';
+        push_record(ring, buf, n + m + 1);
+        return;
+    }
 
     {
         lock_guard<mutex> lck (l_mutex);
@@ -200,6 +406,7 @@ void Logger::write_log(const char* file_name, const char* tn_callbackname, int l
                 snprintf(new_file_name, 300, "%s%s%s.%lld", l_dir_name, prefix, l_file_name, l_count / l_split_lines); 
             }
             l_fp = fopen(new_file_name, "a");   // 打开新的日志文件
+            setvbuf(l_fp, l_file_buf, _IOFBF, LOG_FLUSH_BYTES);  // 旧文件已关闭，复用缓冲区
         }
     }
 
@@ -211,10 +418,9 @@ void Logger::write_log(const char* file_name, const char* tn_callbackname, int l
         lock_guard<mutex> lck (l_mutex);;
 
         //写入数据的前缀：包括写入日期，日志级别,写入文件名，调用该函数的函数名，以及函数所在的行数
-        int n = snprintf(l_buf, 300, "%04d-%02d-%02d %02d:%02d:%02d %s [%s:%s:%d] ",
-                        my_tm.year, my_tm.month, my_tm.day,
-                            my_tm.hour, my_tm.minute, my_tm.second, LogLevelName[level],
-                            file_name, tn_callbackname, line_no);
+        memcpy(l_buf, time_str, time_len);
+        int n = time_len + snprintf(l_buf + time_len, 300, " %s [%s:%s:%d] ",
+                            LogLevelName[level], file_name, tn_callbackname, line_no);
         
         //将所有可变参数添加到前缀后面
         int m = vsnprintf(l_buf + n, l_buf_size - 1, format, valst);
@@ -224,44 +430,307 @@ void Logger::write_log(const char* file_name, const char* tn_callbackname, int l
     }
     va_end(valst);
     
-     //使用异步写入
-    if (l_is_async)
+    //同步方式写入
     {
-        //将要写入的数据放在缓冲队列之中，交给异步写入日志线程处理，将数据写入日志文件中
-        while (!l_buffer_queue->push(log_str) && !is_thread_stop)   
-        {    
-                       
-        }
-        
-    }
-    else
-    { //同步方式写入
         lock_guard<mutex> lck (l_mutex);
-        fputs(log_str.c_str(), l_fp);   // 将日志内容写入文件
+        fputs(log_str.c_str(), l_fp);   // 将日志内容写入文件缓冲区
+        if (level == LOG_LEVEL_ERROR)   // 错误日志立即写出，避免进程崩溃时丢失
+        {
+            fflush(l_fp);
+            l_dirty = false;
+        }
+        else
+        {
+            l_dirty = true;
+        }
     }
 }
 
 // 刷新日志缓冲区
+// 异步模式下日志由后台线程直接writev到文件描述符，不经过stdio缓冲，无需刷新
 void Logger::flush(void)
 {
+    if (l_is_async)
+    {
+        return;
+    }
     lock_guard<mutex> lck (l_mutex);
     fflush(l_fp);
+    l_dirty = false;
 }
 
-//异步写日志，将缓冲队列中的数据读读出写入日志文件中
-void* Logger::async_write()
+//缓冲区已满时默认让出CPU等待后台线程写出，写日志的速度不会超过写文件的速度，日志不会丢失
+//设置了丢弃策略、日志比整个环还长，或日志对象正在析构（后台线程可能已经退出）时丢弃并计数
+void Logger::push_record(LogRing *ring, const char *data, size_t len)
+{
+    while (!ring->push(data, len))
+    {
+        if (l_drop_when_full || len > ring->capacity() || is_thread_stop.load(memory_order_relaxed))
+        {
+            l_dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        wakeup_writer();
+        this_thread::yield();
+    }
+    wakeup_writer();
+}
+
+//写入日志之后调用：与async_write中先写l_writer_sleeping再检查环形缓冲区配合，
+//两边都有seq_cst屏障，后台线程要么看到新日志，要么在这里被看到正在休眠而被唤醒
+//后台线程忙碌时只读一次l_writer_sleeping，不加锁
+void Logger::wakeup_writer()
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (l_writer_sleeping.load(memory_order_relaxed) && l_writer_sleeping.exchange(false, memory_order_acq_rel))
+    {
+        lock_guard<mutex> lck (l_async_mutex);
+        l_writer_wakeup = true;
+        l_async_cond.notify_one();
+    }
+}
+
+bool Logger::rings_empty()
+{
+    lock_guard<mutex> lck (l_ring_mutex);
+    for (LogRing *ring : l_rings)
+    {
+        if (!ring->empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+LogRing *Logger::get_thread_ring()
+{
+    if (!t_ring_holder.ring)
+    {
+        LogRing *ring = new LogRing(l_ring_size, l_buf_size);
+        {
+            lock_guard<mutex> lck (l_ring_mutex);
+            l_rings.push_back(ring);
+        }
+        t_ring_holder.ring = ring;
+    }
+    return t_ring_holder.ring;
+}
+
+//异步模式下切换日志文件，只由异步写入线程调用，规则与同步模式相同
+//行数按批次累计，因此每个文件的行数以批次为粒度，可能略多于l_split_lines
+void Logger::roll_file(long long records)
+{
+    if (l_is_stdout)
+    {
+        return;
+    }
+
+    my_time my_tm = get_current_sys_time();
+    long long old_count = l_count;
+    l_count += records;
+    if (l_today == my_tm.day && old_count / l_split_lines == l_count / l_split_lines)
+    {
+        return;
+    }
+
+    PR_DEBUG("start to create a new log file\n");
+    char new_file_name[301] = {0};
+    char prefix[24] = {0};
+    snprintf(prefix, 23, "%04d_%02d_%02d_", my_tm.year, my_tm.month, my_tm.day);
+    if (l_today != my_tm.day)
+    {
+        snprintf(new_file_name, 300, "%s%s%s", l_dir_name, prefix, l_file_name);
+        l_today = my_tm.day;
+        l_count = 0;
+    }
+    else
+    {
+        snprintf(new_file_name, 300, "%s%s%s.%lld", l_dir_name, prefix, l_file_name, l_count / l_split_lines);
+    }
+
+    FILE *fp = fopen(new_file_name, "a");
+    if (fp == NULL)
+    {
+        PR_ERROR("open %s failed!\n", new_file_name);
+        return;
+    }
+    fclose(l_fp);
+    l_fp = fp;
+    if (l_is_binary)
+    {
+        write_binary_head();
+    }
+}
+
+int64_t Logger::get_time_ns()
 {
-    string single_line;
-    while(l_buffer_queue->pop(single_line) && !is_thread_stop)  //l_buffer_queue 中取出日志信息，直到 is_thread_stop 变量被设置为 true 或者队列为空
-   {
-      lock_guard<mutex> lck (l_mutex);
-      fputs(single_line.c_str(), l_fp);
-   }
-   return NULL;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
 }
-/*
-   该异步写入的任务函数存在一定缺陷：
-   比如当缓冲队列的数据被全部取出后该线程的任务就执行完毕然后退出，但是如果此时又有新的日志数据被写入到任务队列中，由于异步写入到文件的线程关闭，新到来的所有日志信息都无法被写入日志文件，造成数据丢失。
-   针对此问题的改进方法：
-   使用任务队列中的条件变量（需要为任务队列再编写一个接口用于获取其私有的条件变量），当任务队列为空时，该线程阻塞等待新日志数据的到来，数据一到来就会被唤醒，将新到来的数据写入日志文件。
-*/
+
+//二进制日志：登记格式，定义条目追加到l_format_defs，由异步写入线程在使用该格式的记录之前写入文件
+uint32_t Logger::register_format(log_level level, const char *file_name, const char *tn_callbackname,
+                                 int line_no, const char *format)
+{
+    size_t file_len = strlen(file_name) + 1;
+    size_t func_len = strlen(tn_callbackname) + 1;
+    size_t fmt_len = strlen(format) + 1;
+
+    lock_guard<mutex> lck (l_format_mutex);
+    LogBinaryEntry entry;
+    entry.len = sizeof(LogBinaryEntry) + sizeof(LogBinaryFormatDef) + file_len + func_len + fmt_len;
+    entry.id = LOG_BINARY_FORMAT_DEF;
+    LogBinaryFormatDef def;
+    def.fmt_id = l_format_num++;
+    def.level = level;
+    def.line = line_no;
+
+    l_format_defs.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    l_format_defs.append(reinterpret_cast<const char*>(&def), sizeof(def));
+    l_format_defs.append(file_name, file_len);
+    l_format_defs.append(tn_callbackname, func_len);
+    l_format_defs.append(format, fmt_len);
+    return def.fmt_id;
+}
+
+//二进制日志：写入文件头，新文件中需要重新写入所有格式定义
+void Logger::write_binary_head()
+{
+    struct
+    {
+        LogBinaryEntry entry;
+        LogBinaryFileHead head;
+    } file_head;
+    file_head.entry.len = sizeof(file_head);
+    file_head.entry.id = LOG_BINARY_FILE_HEAD;
+    file_head.head.version = LOG_BINARY_VERSION;
+    file_head.head.precision = l_time_precision;
+
+    struct iovec iov = { &file_head, sizeof(file_head) };
+    writev_all(fileno(l_fp), &iov, 1);
+    l_defs_written = 0;
+}
+
+//把所有线程环形缓冲区中的可读数据组成iovec，一次writev写入日志文件，返回本轮是否写了数据
+bool Logger::write_rings()
+{
+    {
+        lock_guard<mutex> lck (l_ring_mutex);
+        l_batch_rings.assign(l_rings.begin(), l_rings.end());
+    }
+
+    //iov[0]留给二进制日志的格式定义
+    struct iovec iov[LOG_IOV_MAX];
+    int iov_cnt = 1;
+    long long records = 0;
+    l_batch_lens.clear();
+    for (size_t i = 0; i < l_batch_rings.size() && iov_cnt + 2 <= LOG_IOV_MAX; i++)
+    {
+        int cnt = 0;
+        records += l_batch_rings[i]->take_records();
+        l_batch_lens.push_back(l_batch_rings[i]->peek(iov + iov_cnt, &cnt));
+        iov_cnt += cnt;
+    }
+
+    bool has_data = iov_cnt > 1;
+    int iov_start = 1;
+    if (has_data && l_is_binary)
+    {
+        //记录已经从环中取出，使用的格式一定已经登记，先写入本文件中尚未写入的格式定义
+        {
+            lock_guard<mutex> lck (l_format_mutex);
+            l_defs_batch.assign(l_format_defs, l_defs_written, string::npos);
+            l_defs_written = l_format_defs.size();
+        }
+        if (!l_defs_batch.empty())
+        {
+            iov[0].iov_base = &l_defs_batch[0];
+            iov[0].iov_len = l_defs_batch.size();
+            iov_start = 0;
+        }
+    }
+
+    if (has_data)
+    {
+        writev_all(fileno(l_fp), iov + iov_start, iov_cnt - iov_start);
+        roll_file(records);   //本批日志写完后再判断是否切换，后续批次写入新文件
+    }
+    for (size_t i = 0; i < l_batch_lens.size(); i++)
+    {
+        l_batch_rings[i]->consume(l_batch_lens[i]);
+    }
+
+    //回收所属线程已经退出并且数据已经写完的环形缓冲区
+    {
+        lock_guard<mutex> lck (l_ring_mutex);
+        for (size_t i = 0; i < l_rings.size(); )
+        {
+            LogRing *ring = l_rings[i];
+            if (ring->is_closed() && ring->empty())
+            {
+                delete ring;
+                l_rings[i] = l_rings.back();
+                l_rings.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    return has_data;
+}
+
+//同步模式下定时把缓冲区中的日志写出，保证日志最多滞留LOG_FLUSH_INTERVAL_MS
+void Logger::flush_loop()
+{
+    unique_lock<mutex> lck (l_async_mutex);
+    while (!is_thread_stop)
+    {
+        l_async_cond.wait_for(lck, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS),
+                              [this] { return is_thread_stop.load(); });
+        lock_guard<mutex> flck (l_mutex);
+        if (l_dirty)
+        {
+            fflush(l_fp);
+            l_dirty = false;
+        }
+    }
+}
+
+//异步写日志，循环收集各线程环形缓冲区中的日志批量写入文件
+//没有数据时先让出CPU若干次，仍然没有数据才在l_async_cond上休眠，直到写日志的线程写入新日志后唤醒，空闲时不定时轮询
+void* Logger::async_write()
+{
+    int idle = 0;
+    while (!is_thread_stop)
+    {
+        if (write_rings())
+        {
+            idle = 0;
+            continue;
+        }
+        if (++idle < LOG_IDLE_SPINS)
+        {
+            this_thread::yield();
+            continue;
+        }
+        idle = 0;
+        unique_lock<mutex> lck (l_async_mutex);
+        l_writer_sleeping.store(true, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        //宣布休眠之后再检查一次，避免错过宣布之前写入的日志
+        if (rings_empty())
+        {
+            l_async_cond.wait(lck, [this] { return l_writer_wakeup || is_thread_stop.load(); });
+        }
+        l_writer_sleeping.store(false, memory_order_relaxed);
+        l_writer_wakeup = false;
+    }
+    while (write_rings())  //退出前写完剩余的日志
+    {
+    }
+    return NULL;
+}
\ No newline at end of file
@@ -10,8 +10,11 @@
 #include <mutex>
 #include <assert.h>
 #include <atomic>
+#include <vector>
+#include <condition_variable>
 
-#include "log_queue.h"
+#include "log_ring.h"
+#include "log_binary.h"
 #include "pr.h"
 
 using namespace std;
@@ -28,6 +31,13 @@ public:
         NUM_LOG_LEVELS,     //日志级别总数
     } log_level;
 
+    typedef enum  //日志时间戳精度
+    {
+        LOG_TIME_SECOND,    //精确到秒：2024-01-01 12:00:00
+        LOG_TIME_MILLI,     //精确到毫秒：2024-01-01 12:00:00.123
+        LOG_TIME_MICRO,     //精确到微秒：2024-01-01 12:00:00.123456
+    } time_precision;
+
     static Logger *get_instance()  //使用静态方法获取Logger类唯一实例
     {
         //懒汉模式，采用局部静态变量的方法：函数首次调用的时候会创建并初始化(并且只能初始化一次），作用域为当前函数,具有记忆性，函数退出后依然存在，只是不能使用，一直到程序运行结束才会被销毁，
@@ -45,9 +55,36 @@ public:
     static log_level set_log_level(log_level level);  //设置日志级别
 
     // 这个init函数不是可重入的（不支持多线程并发调用），并且应该在主线程中在启动子线程之前进行调用
+    // buffer_queue_size >= 1 时使用异步日志，每个线程的环形缓冲区可容纳 buffer_queue_size 条 buffer_size 长度的日志
     bool init(const char *file_name, int buffer_queue_size = 0, Logger::log_level = Logger::LOG_LEVEL_INFO,
                 int buffer_size = 8192, int split_lines = 5000);
     
+    // 设置日志时间戳精度，与init一样应在启动子线程之前调用
+    void set_time_precision(time_precision precision)
+    {
+        l_time_precision = precision;
+    }
+
+    // 设置异步模式下线程环形缓冲区已满时的处理方式，与init一样应在启动子线程之前调用
+    // 默认为false：写日志的线程等待后台线程写出日志腾出空间（反压），日志不会丢失
+    // 为true时丢弃该条日志并计数，写日志的线程不会被阻塞，可通过get_dropped_count()查询丢弃的条数
+    void set_drop_when_full(bool drop)
+    {
+        l_drop_when_full = drop;
+    }
+
+    // 设置是否使用二进制日志，必须在init之前调用
+    // 二进制日志只能写入文件，并且总是使用异步方式，写出的文件需要用log_decoder转换为文本
+    void set_binary(bool binary)
+    {
+        l_is_binary = binary;
+    }
+
+    bool is_binary()
+    {
+        return l_is_binary;
+    }
+
     //判断该日志对象是否被初始化
     bool is_inited()
     {
@@ -59,11 +96,52 @@ public:
 
     void flush(void);
 
+    // 二进制日志：登记一个调用处的格式，返回格式编号，每个调用处只登记一次
+    uint32_t register_format(log_level level, const char *file_name, const char *tn_callbackname,
+                             int line_no, const char *format);
+
+    // 二进制日志：只记录格式编号、时间戳和参数的原始字节，不做格式化
+    template <typename... Args>
+    void write_binary(uint32_t fmt_id, Args... args)
+    {
+        LogRing *ring = get_thread_ring();
+        char *buf = ring->get_scratch();
+        size_t size = ring->get_scratch_size();
+        size_t pos = sizeof(LogBinaryEntry) + sizeof(int64_t);
+        (void)size;  //没有参数时折叠表达式为空，不会用到size
+        if (!(log_encode_arg(buf, size, pos, args) && ...))  //参数过多，放不下一条记录
+        {
+            l_dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+
+        LogBinaryEntry entry = { static_cast<uint32_t>(pos), fmt_id };
+        int64_t now = get_time_ns();
+        memcpy(buf, &entry, sizeof(entry));
+        memcpy(buf + sizeof(entry), &now, sizeof(now));
+        push_record(ring, buf, pos);
+    }
+
+    // 异步模式下丢弃的日志条数（set_drop_when_full(true)时缓冲区已满，或日志过长），不加锁，可以频繁调用
+    long long get_dropped_count()
+    {
+        return l_dropped.load(memory_order_relaxed);
+    }
+
 private:
     Logger();  // 私有构造函数
     Logger(const Logger&);  // 私有拷贝构造函数
     ~Logger();  // 析构函数
     void *async_write(); // 异步写入日志
+    LogRing *get_thread_ring();  // 获取当前线程的环形缓冲区，首次调用时创建并注册
+    void push_record(LogRing *ring, const char *data, size_t len);  // 把一条日志写入线程环形缓冲区，缓冲区满时按l_drop_when_full等待或丢弃
+    void wakeup_writer();        // 后台线程在休眠时唤醒它
+    bool rings_empty();          // 所有线程环形缓冲区是否都没有待写出的日志
+    bool write_rings();          // 把所有线程环形缓冲区中的日志批量写入文件
+    void roll_file(long long records);  // 异步模式下检查日期和行数，必要时切换日志文件
+    void flush_loop();           // 同步模式下定时刷新日志文件缓冲区
+    void write_binary_head();    // 二进制日志：在新打开的日志文件中写入文件头
+    static int64_t get_time_ns();  // 当前时间，纳秒
 
 private:
     char l_dir_name[128];    // 日志目录
@@ -76,14 +154,34 @@ private:
     char *l_buf = nullptr;   // 日志缓冲区
 
     bool l_inited = false;   // 是否已经初始化
-    buffer_queue<string> *l_buffer_queue = nullptr;   // 异步写入日志的缓冲队列
     bool l_is_async=false;         // 是否以异步方式写日志,默认情况不是以异步方式
+    size_t l_ring_size = 0;        // 异步模式下每个线程环形缓冲区的大小
+    vector<LogRing*> l_rings;      // 所有写过日志的线程的环形缓冲区
+    mutex l_ring_mutex;            // 保护l_rings，只在线程注册和后台线程遍历时使用
+    atomic<long long> l_dropped = {0};   // 所有线程累计丢弃的日志条数，丢弃很少发生，各线程共用一个计数
+    bool l_drop_when_full = false;  // 异步模式下线程环形缓冲区已满时是否丢弃日志，默认等待
+    mutex l_async_mutex;           // 与l_async_cond配合，让后台线程空闲时休眠
+    condition_variable l_async_cond;
+    atomic<bool> l_writer_sleeping = {false};  // 后台线程是否（即将）在l_async_cond上休眠
+    bool l_writer_wakeup = false;  // 写日志的线程已经发出唤醒，由l_async_mutex保护
+    vector<LogRing*> l_batch_rings;  // 后台线程每轮遍历的环形缓冲区快照
+    vector<size_t> l_batch_lens;     // 后台线程每轮从各环中取出的字节数
     bool l_is_stdout = false;  // 是否输出到标准输出
+    time_precision l_time_precision = LOG_TIME_SECOND;  // 日志时间戳精度
+    bool l_is_binary = false;      // 是否使用二进制日志
+    mutex l_format_mutex;          // 保护l_format_defs和l_format_num
+    string l_format_defs;          // 所有已登记格式的定义条目，按编号顺序拼接
+    uint32_t l_format_num = 0;     // 已登记的格式数量
+    size_t l_defs_written = 0;     // 当前日志文件中已写入的格式定义字节数，只由异步写入线程使用
+    string l_defs_batch;           // 异步写入线程本轮要写入的格式定义
 
     atomic<bool> is_thread_stop ={false};   // 用于控制异步写入日志的线程
     mutex l_mutex;   // 互斥量，保护关键资源
 
     thread *l_asyncw_thread = nullptr;  // 异步写入日志的线程
+    thread *l_flush_thread = nullptr;   // 同步模式下定时刷新缓冲区的线程
+    char *l_file_buf = nullptr;         // 同步模式下日志文件的stdio缓冲区，写满时由stdio写出
+    bool l_dirty = false;               // 同步模式下是否有未刷新的日志，由l_mutex保护
 };
 
 extern Logger::log_level g_log_level;  // 外部声明的日志级别
@@ -101,64 +199,59 @@ inline Logger::log_level Logger::set_log_level(Logger::log_level level)
     return old_level;  // 返回旧的日志级别
 }
 
-// 调试日志输出宏
-#define LOG_DEBUG(format, ...)              \
-    do {                                    \
-        if(!Logger::get_instance()->is_inited())                       \
-        {                                                               \
-            PR_ERROR("logger must be inited before user!\n");           \
-        }                                                               \
-        if(Logger::LOG_LEVEL_DEBUG <= Logger::get_log_level())            \
-        {                                       \
-            Logger::get_instance()->write_log(__FILE__, __FUNCTION__,       \
-                __LINE__, Logger::LOG_LEVEL_DEBUG, format, ##__VA_ARGS__);   \
-            Logger::get_instance()->flush();                                \
+// 编译期保留的最低日志级别，数值与log_level一致（0:ERROR 1:WARN 2:INFO 3:DEBUG）
+// 由CMake选项LOG_MIN_LEVEL设置，级别高于它的LOG_*宏被展开为空语句，参数不会被求值
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 3
+#endif
+
+// 运行时日志输出宏，先判断运行时日志级别，通过后才检查日志对象是否初始化并写日志
+// 写日志后不再逐行刷新，由Logger按缓冲区大小和时间间隔批量刷新
+// 二进制日志模式下，每个调用处在首次执行时登记格式（format必须是字符串常量），之后只记录格式编号和参数
+#define LOG_WRITE(level, format, ...)                                       \
+    do {                                                                    \
+        if(level <= Logger::get_log_level())                                \
+        {                                                                   \
+            if(!Logger::get_instance()->is_inited())                        \
+            {                                                               \
+                PR_ERROR("logger must be inited before user!\n");           \
+            }                                                               \
+            if(Logger::get_instance()->is_binary())                         \
+            {                                                               \
+                static const uint32_t log_fmt_id = Logger::get_instance()-> \
+                    register_format(level, __FILE__, __FUNCTION__, __LINE__, format); \
+                Logger::get_instance()->write_binary(log_fmt_id, ##__VA_ARGS__); \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                Logger::get_instance()->write_log(__FILE__, __FUNCTION__,   \
+                    __LINE__, level, format, ##__VA_ARGS__);                \
+            }                                                               \
         }                                                                   \
     } while(0)
 
+// 调试日志输出宏
+#if LOG_COMPILE_LEVEL >= 3
+#define LOG_DEBUG(format, ...) LOG_WRITE(Logger::LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) do {} while(0)
+#endif
+
 // 信息日志输出宏
-#define LOG_INFO(format, ...)               \
-    do {                                   \
-        if(!Logger::get_instance()->is_inited())                       \
-        {                                                               \
-            PR_ERROR("logger must be inited before user!\n");           \
-        }                                                               \
-        if(Logger::LOG_LEVEL_INFO <= Logger::get_log_level())             \
-        {                                   \
-            Logger::get_instance()->write_log(__FILE__, __FUNCTION__,       \
-                __LINE__, Logger::LOG_LEVEL_INFO, format, ##__VA_ARGS__);   \
-            Logger::get_instance()->flush();                                \
-        }                                                                  \
-    } while(0)
+#if LOG_COMPILE_LEVEL >= 2
+#define LOG_INFO(format, ...) LOG_WRITE(Logger::LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) do {} while(0)
+#endif
 
 // 警告日志输出宏
-#define LOG_WARN(format, ...)                                               \
-    do {                                                                      \
-        if(!Logger::get_instance()->is_inited())                       \
-        {                                                               \
-            PR_ERROR("logger must be inited before user!\n");           \
-        }                                                               \
-        if(Logger::LOG_LEVEL_WARN <= Logger::get_log_level())              \
-        {                                                                    \
-            Logger::get_instance()->write_log(__FILE__, __FUNCTION__,       \
-                __LINE__, Logger::LOG_LEVEL_WARN, format, ##__VA_ARGS__);   \
-            Logger::get_instance()->flush();                                  \
-        }                                                                     \
-    } while(0)
+#if LOG_COMPILE_LEVEL >= 1
+#define LOG_WARN(format, ...) LOG_WRITE(Logger::LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) do {} while(0)
+#endif
 
-// 错误日志输出宏
-#define LOG_ERROR(format, ...)                                              \
-    do {                                                                      \
-        if(!Logger::get_instance()->is_inited())                       \
-        {                                                               \
-            PR_ERROR("logger must be inited before user!\n");           \
-        }                                                               \
-        if(Logger::LOG_LEVEL_ERROR <= Logger::get_log_level())             \
-        {                                                                   \
-            Logger::get_instance()->write_log(__FILE__, __FUNCTION__,       \
-                __LINE__, Logger::LOG_LEVEL_ERROR, format, ##__VA_ARGS__);   \
-            Logger::get_instance()->flush();                                 \
-        }                                                                   \
-    } while(0)
+// 错误日志输出宏，错误日志总是保留
+#define LOG_ERROR(format, ...) LOG_WRITE(Logger::LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
 
 #endif  // 结束条件编译指令
\ No newline at end of file
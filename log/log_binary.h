@@ -0,0 +1,114 @@
+#ifndef __LOG_BINARY_H__
+#define __LOG_BINARY_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+using namespace std;
+
+// 二进制日志格式，日志文件由若干条目组成，每个条目以LogBinaryEntry开头
+//   文件头条目：id为LOG_BINARY_FILE_HEAD，负载为LogBinaryFileHead，每次打开日志文件时写入
+//   格式定义条目：id为LOG_BINARY_FORMAT_DEF，负载为LogBinaryFormatDef + 文件名\0 + 函数名\0 + 格式字符串\0
+//   日志记录条目：id为格式编号，负载为int64时间戳（纳秒）+ 逐个编码的参数（1字节类型 + 数据）
+// 写日志的线程只拷贝参数的原始字节，格式化由离线的log_decoder完成
+
+const uint32_t LOG_BINARY_VERSION = 1;
+const uint32_t LOG_BINARY_FILE_HEAD = 0xfffffffe;   // 文件头条目
+const uint32_t LOG_BINARY_FORMAT_DEF = 0xffffffff;  // 格式定义条目
+
+struct LogBinaryEntry
+{
+    uint32_t len;   // 整个条目的长度，包括本结构
+    uint32_t id;    // 条目类型或格式编号
+};
+
+struct LogBinaryFileHead
+{
+    uint32_t version;      // 格式版本
+    uint32_t precision;    // 时间戳精度，取值同Logger::time_precision
+};
+
+struct LogBinaryFormatDef
+{
+    uint32_t fmt_id;   // 格式编号
+    uint32_t level;    // 日志级别
+    uint32_t line;     // 调用处所在行号
+};
+
+// 参数类型
+enum LogArgType : uint8_t
+{
+    LOG_ARG_INT,       // 有符号整数，按int64保存
+    LOG_ARG_UINT,      // 无符号整数，按uint64保存
+    LOG_ARG_DOUBLE,    // 浮点数，按double保存
+    LOG_ARG_STRING,    // 字符串，uint32长度 + 内容
+    LOG_ARG_POINTER,   // 指针，按uint64保存
+};
+
+// 把一个定长参数写入buf，空间不足时返回false
+template <typename T>
+inline bool log_encode_raw(char *buf, size_t size, size_t &pos, LogArgType type, T value)
+{
+    if (pos + 1 + sizeof(T) > size)
+    {
+        return false;
+    }
+    buf[pos] = type;
+    memcpy(buf + pos + 1, &value, sizeof(T));
+    pos += 1 + sizeof(T);
+    return true;
+}
+
+inline bool log_encode_arg(char *buf, size_t size, size_t &pos, const char *str)
+{
+    if (!str)
+    {
+        str = "(null)";
+    }
+    if (pos + 1 + sizeof(uint32_t) > size)
+    {
+        return false;
+    }
+    size_t len = strlen(str);
+    size_t room = size - pos - 1 - sizeof(uint32_t);
+    uint32_t n = len < room ? len : room;   //空间不足时截断字符串
+    buf[pos] = LOG_ARG_STRING;
+    memcpy(buf + pos + 1, &n, sizeof(n));
+    memcpy(buf + pos + 1 + sizeof(n), str, n);
+    pos += 1 + sizeof(n) + n;
+    return true;
+}
+
+inline bool log_encode_arg(char *buf, size_t size, size_t &pos, char *str)
+{
+    return log_encode_arg(buf, size, pos, static_cast<const char*>(str));
+}
+
+template <typename T>
+inline bool log_encode_arg(char *buf, size_t size, size_t &pos, T value)
+{
+    if constexpr (is_enum<T>::value)
+    {
+        return log_encode_raw(buf, size, pos, LOG_ARG_INT, static_cast<int64_t>(value));
+    }
+    else if constexpr (is_floating_point<T>::value)
+    {
+        return log_encode_raw(buf, size, pos, LOG_ARG_DOUBLE, static_cast<double>(value));
+    }
+    else if constexpr (is_integral<T>::value && is_signed<T>::value)
+    {
+        return log_encode_raw(buf, size, pos, LOG_ARG_INT, static_cast<int64_t>(value));
+    }
+    else if constexpr (is_integral<T>::value)
+    {
+        return log_encode_raw(buf, size, pos, LOG_ARG_UINT, static_cast<uint64_t>(value));
+    }
+    else
+    {
+        static_assert(is_pointer<T>::value, "unsupported binary log argument type");
+        return log_encode_raw(buf, size, pos, LOG_ARG_POINTER, reinterpret_cast<uint64_t>(value));
+    }
+}
+
+#endif
@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "log_binary.h"
+
+using namespace std;
+
+// 二进制日志解码工具：把Logger二进制模式写出的日志文件还原为与文本日志相同格式的文本
+// 用法：log_decoder <binary_log_file> [binary_log_file ...]，结果输出到标准输出
+
+const char* LogLevelName[] =
+{
+  "[ERROR]",
+  "[WARN ]",
+  "[INFO ]",
+  "[DEBUG]",
+};
+
+// 登记的格式
+struct LogFormat
+{
+    uint32_t level;
+    uint32_t line;
+    string file_name;
+    string func_name;
+    string format;
+};
+
+// 解码出的一个参数
+struct LogArg
+{
+    LogArgType type;
+    int64_t i;
+    uint64_t u;
+    double d;
+    string s;
+};
+
+class LogDecoder
+{
+public:
+    explicit LogDecoder(FILE *out) : ld_out(out)
+    {
+    }
+
+    // 解码一个文件，返回解码出的日志条数，文件格式错误时返回-1
+    long long decode_file(const char *path);
+
+private:
+    bool decode_record(uint32_t fmt_id, const char *data, size_t len);
+    bool decode_args(const char *data, size_t len, vector<LogArg> &args);
+    void format_message(const string &format, const vector<LogArg> &args, string &out);
+    void append_time(int64_t time_ns, string &out);
+
+    FILE *ld_out;
+    uint32_t ld_precision = 0;                       // 时间戳精度
+    unordered_map<uint32_t, LogFormat> ld_formats;   // 格式编号到格式的映射
+    string ld_line;                                  // 当前输出的一行
+};
+
+long long LogDecoder::decode_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "open %s failed\n", path);
+        return -1;
+    }
+    vector<char> data;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(fp);
+
+    long long records = 0;
+    size_t pos = 0;
+    while (pos + sizeof(LogBinaryEntry) <= data.size())
+    {
+        LogBinaryEntry entry;
+        memcpy(&entry, &data[pos], sizeof(entry));
+        if (entry.len < sizeof(entry) || pos + entry.len > data.size())
+        {
+            fprintf(stderr, "%s: broken entry at offset %zu\n", path, pos);
+            return -1;
+        }
+        const char *payload = &data[pos] + sizeof(entry);
+        size_t payload_len = entry.len - sizeof(entry);
+
+        if (entry.id == LOG_BINARY_FILE_HEAD)
+        {
+            LogBinaryFileHead head;
+            if (payload_len < sizeof(head))
+            {
+                fprintf(stderr, "%s: broken file head at offset %zu\n", path, pos);
+                return -1;
+            }
+            memcpy(&head, payload, sizeof(head));
+            if (head.version != LOG_BINARY_VERSION)
+            {
+                fprintf(stderr, "%s: unsupported version %u\n", path, head.version);
+                return -1;
+            }
+            ld_precision = head.precision;
+            ld_formats.clear();   //追加写入的新进程重新登记格式
+        }
+        else if (entry.id == LOG_BINARY_FORMAT_DEF)
+        {
+            LogBinaryFormatDef def;
+            if (payload_len < sizeof(def))
+            {
+                fprintf(stderr, "%s: broken format at offset %zu\n", path, pos);
+                return -1;
+            }
+            memcpy(&def, payload, sizeof(def));
+            const char *str = payload + sizeof(def);
+            const char *end = payload + payload_len;
+            LogFormat &format = ld_formats[def.fmt_id];
+            format.level = def.level;
+            format.line = def.line;
+            format.file_name = string(str, strnlen(str, end - str));
+            str += format.file_name.size() + 1;
+            format.func_name = str < end ? string(str, strnlen(str, end - str)) : string();
+            str += format.func_name.size() + 1;
+            format.format = str < end ? string(str, strnlen(str, end - str)) : string();
+        }
+        else
+        {
+            if (!decode_record(entry.id, payload, payload_len))
+            {
+                fprintf(stderr, "%s: broken record at offset %zu\n", path, pos);
+                return -1;
+            }
+            records++;
+        }
+        pos += entry.len;
+    }
+    return records;
+}
+
+bool LogDecoder::decode_record(uint32_t fmt_id, const char *data, size_t len)
+{
+    auto it = ld_formats.find(fmt_id);
+    if (it == ld_formats.end() || len < sizeof(int64_t))
+    {
+        return false;
+    }
+    const LogFormat &format = it->second;
+
+    int64_t time_ns;
+    memcpy(&time_ns, data, sizeof(time_ns));
+    vector<LogArg> args;
+    if (!decode_args(data + sizeof(time_ns), len - sizeof(time_ns), args))
+    {
+        return false;
+    }
+
+    ld_line.clear();
+    append_time(time_ns, ld_line);
+    char prefix[600];
+    snprintf(prefix, sizeof(prefix), " %s [%s:%s:%u] ",
+             format.level < sizeof(LogLevelName) / sizeof(LogLevelName[0]) ? LogLevelName[format.level] : "[?????]",
+             format.file_name.c_str(), format.func_name.c_str(), format.line);
+    ld_line += prefix;
+    format_message(format.format, args, ld_line);
+    ld_line += '\n';
+    fwrite(ld_line.data(), 1, ld_line.size(), ld_out);
+    return true;
+}
+
+bool LogDecoder::decode_args(const char *data, size_t len, vector<LogArg> &args)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        LogArg arg;
+        arg.type = static_cast<LogArgType>(data[pos++]);
+        switch (arg.type)
+        {
+        case LOG_ARG_INT:
+        case LOG_ARG_UINT:
+        case LOG_ARG_POINTER:
+        case LOG_ARG_DOUBLE:
+            if (pos + 8 > len)
+            {
+                return false;
+            }
+            memcpy(&arg.u, data + pos, 8);
+            memcpy(&arg.i, data + pos, 8);
+            memcpy(&arg.d, data + pos, 8);
+            pos += 8;
+            break;
+        case LOG_ARG_STRING:
+        {
+            uint32_t n;
+            if (pos + sizeof(n) > len)
+            {
+                return false;
+            }
+            memcpy(&n, data + pos, sizeof(n));
+            pos += sizeof(n);
+            if (pos + n > len)
+            {
+                return false;
+            }
+            arg.s.assign(data + pos, n);
+            pos += n;
+            break;
+        }
+        default:
+            return false;
+        }
+        args.push_back(arg);
+    }
+    return true;
+}
+
+// 按日志时间戳精度输出时间，与文本日志的时间格式相同
+void LogDecoder::append_time(int64_t time_ns, string &out)
+{
+    time_t sec = time_ns / 1000000000;
+    long usec = (time_ns % 1000000000) / 1000;
+    struct tm tm_buf;
+    localtime_r(&sec, &tm_buf);
+    char buf[40];
+    int n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    if (ld_precision == 1)
+    {
+        n += snprintf(buf + n, sizeof(buf) - n, ".%03ld", usec / 1000);
+    }
+    else if (ld_precision == 2)
+    {
+        n += snprintf(buf + n, sizeof(buf) - n, ".%06ld", usec);
+    }
+    out.append(buf, n);
+}
+
+// 逐个解析格式字符串中的转换说明，用对应的参数单独调用snprintf
+// 整数参数统一按64位保存，因此整数转换去掉原有的长度修饰并改为ll
+void LogDecoder::format_message(const string &format, const vector<LogArg> &args, string &out)
+{
+    size_t arg_idx = 0;
+    const char *p = format.c_str();
+    char buf[4096];
+    while (*p)
+    {
+        if (*p != '%')
+        {
+            out += *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out += '%';
+            p += 2;
+            continue;
+        }
+
+        // spec = % + 标志 + 宽度 + 精度
+        string spec = "%";
+        p++;
+        while (*p && strchr("-+ #0'", *p))
+        {
+            spec += *p++;
+        }
+        for (int part = 0; part < 2; part++)   //宽度和精度
+        {
+            if (part == 1)
+            {
+                if (*p != '.')
+                {
+                    break;
+                }
+                spec += *p++;
+            }
+            if (*p == '*')
+            {
+                long long v = arg_idx < args.size() ? args[arg_idx].i : 0;
+                arg_idx++;
+                spec += to_string(v);
+                p++;
+            }
+            while (*p >= '0' && *p <= '9')
+            {
+                spec += *p++;
+            }
+        }
+        while (*p && strchr("hlLqjzt", *p))   //丢弃长度修饰
+        {
+            p++;
+        }
+        char conv = *p;
+        if (!conv)
+        {
+            break;
+        }
+        p++;
+
+        if (arg_idx >= args.size())
+        {
+            out += "<missing>";
+            continue;
+        }
+        const LogArg &arg = args[arg_idx++];
+        int n = 0;
+        switch (conv)
+        {
+        case 'd':
+        case 'i':
+            spec += "lld";
+            n = snprintf(buf, sizeof(buf), spec.c_str(),
+                         arg.type == LOG_ARG_DOUBLE ? static_cast<long long>(arg.d) : static_cast<long long>(arg.i));
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            spec += "ll";
+            spec += conv;
+            n = snprintf(buf, sizeof(buf), spec.c_str(),
+                         arg.type == LOG_ARG_DOUBLE ? static_cast<unsigned long long>(arg.d) : static_cast<unsigned long long>(arg.u));
+            break;
+        case 'c':
+            spec += 'c';
+            n = snprintf(buf, sizeof(buf), spec.c_str(), static_cast<int>(arg.i));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec += conv;
+            n = snprintf(buf, sizeof(buf), spec.c_str(),
+                         arg.type == LOG_ARG_DOUBLE ? arg.d : static_cast<double>(arg.i));
+            break;
+        case 's':
+            spec += 's';
+            n = snprintf(buf, sizeof(buf), spec.c_str(), arg.type == LOG_ARG_STRING ? arg.s.c_str() : "<bad arg>");
+            break;
+        case 'p':
+            spec += 'p';
+            n = snprintf(buf, sizeof(buf), spec.c_str(), reinterpret_cast<void*>(arg.u));
+            break;
+        default:
+            n = snprintf(buf, sizeof(buf), "<bad conversion %%%c>", conv);
+            break;
+        }
+        if (n > 0)
+        {
+            out.append(buf, n < static_cast<int>(sizeof(buf)) ? n : sizeof(buf) - 1);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <binary_log_file> [binary_log_file ...]\n", argv[0]);
+        return 1;
+    }
+
+    int ret = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        LogDecoder decoder(stdout);   //每个文件独立解码，文件中包含自身用到的全部格式定义
+        long long records = decoder.decode_file(argv[i]);
+        if (records < 0)
+        {
+            ret = 1;
+            continue;
+        }
+        fprintf(stderr, "%s: decoded %lld records\n", argv[i], records);
+    }
+    return ret;
+}
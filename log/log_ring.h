@@ -0,0 +1,141 @@
+#ifndef __LOG_RING_H__
+#define __LOG_RING_H__
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <atomic>
+
+using namespace std;
+
+// 单生产者单消费者的无锁字节环形缓冲区，每个写日志的线程独占一个
+// 生产者为写日志的线程，只修改lr_write；消费者为后台写日志线程，只修改lr_read
+// 环中只存放已经格式化好的日志文本，消费者可以直接把可读区间作为iovec交给writev
+class LogRing
+{
+public:
+    // capacity会向上取整为2的幂，scratch_size为线程格式化日志时使用的临时缓冲区大小
+    LogRing(size_t capacity, int scratch_size)
+    {
+        lr_capacity = 1;
+        while(lr_capacity < capacity)
+        {
+            lr_capacity <<= 1;
+        }
+        lr_mask = lr_capacity - 1;
+        lr_data = new char[lr_capacity];
+        lr_scratch_size = scratch_size;
+        lr_scratch = new char[lr_scratch_size];
+    }
+
+    ~LogRing()
+    {
+        delete [] lr_data;
+        delete [] lr_scratch;
+    }
+
+    // 生产者：写入一条日志，空间不足时不写入并返回false，由调用者决定等待还是丢弃
+    bool push(const char *data, size_t len)
+    {
+        size_t w = lr_write.load(memory_order_relaxed);
+        size_t r = lr_read.load(memory_order_acquire);
+        if(lr_capacity - (w - r) < len)
+        {
+            return false;
+        }
+
+        size_t pos = w & lr_mask;
+        size_t first = len < lr_capacity - pos ? len : lr_capacity - pos;
+        memcpy(lr_data + pos, data, first);
+        memcpy(lr_data, data + first, len - first);  //环尾不够时回绕到环首
+        lr_write.store(w + len, memory_order_release);
+        lr_records.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // 消费者：把当前可读区间填入iov（最多2段），返回可读的字节数
+    size_t peek(struct iovec *iov, int *iov_cnt)
+    {
+        size_t r = lr_read.load(memory_order_relaxed);
+        size_t w = lr_write.load(memory_order_acquire);
+        size_t len = w - r;
+        *iov_cnt = 0;
+        if(len == 0)
+        {
+            return 0;
+        }
+
+        size_t pos = r & lr_mask;
+        size_t first = len < lr_capacity - pos ? len : lr_capacity - pos;
+        iov[0].iov_base = lr_data + pos;
+        iov[0].iov_len = first;
+        *iov_cnt = 1;
+        if(first < len)
+        {
+            iov[1].iov_base = lr_data;
+            iov[1].iov_len = len - first;
+            *iov_cnt = 2;
+        }
+        return len;
+    }
+
+    // 消费者：数据写出之后释放len字节空间
+    void consume(size_t len)
+    {
+        lr_read.store(lr_read.load(memory_order_relaxed) + len, memory_order_release);
+    }
+
+    bool empty()
+    {
+        return lr_read.load(memory_order_relaxed) == lr_write.load(memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return lr_capacity;
+    }
+
+    char *get_scratch()
+    {
+        return lr_scratch;
+    }
+
+    int get_scratch_size()
+    {
+        return lr_scratch_size;
+    }
+
+    // 取出自上次调用以来写入的日志条数，用于日志文件按行数滚动
+    long long take_records()
+    {
+        return lr_records.exchange(0, memory_order_relaxed);
+    }
+
+    // 所属线程退出时设置，消费者写完剩余数据后回收该环
+    void close()
+    {
+        lr_closed.store(true, memory_order_release);
+    }
+
+    bool is_closed()
+    {
+        return lr_closed.load(memory_order_acquire);
+    }
+
+private:
+    LogRing(const LogRing&);
+    LogRing& operator=(const LogRing&);
+
+    char *lr_data;             // 环形缓冲区
+    size_t lr_capacity;        // 容量，2的幂
+    size_t lr_mask;            // 取模掩码
+    char *lr_scratch;          // 格式化日志的临时缓冲区，只由所属线程使用
+    int lr_scratch_size;       // 临时缓冲区大小
+
+    alignas(64) atomic<size_t> lr_write = {0};   // 生产者写入位置，单调递增
+    atomic<long long> lr_records = {0};          // 写入的日志条数
+    alignas(64) atomic<size_t> lr_read = {0};    // 消费者读取位置，单调递增
+    atomic<bool> lr_closed = {false};            // 所属线程是否已经退出
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+
+#include <stdio.h>
+
+// 测试程序共用的检查函数：打印检查项及结果，失败时计数，main根据g_failed决定是否通过
+
+inline int g_failed = 0;  // 失败的检查项个数
+
+inline void check(bool ok, const char* what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        g_failed++;
+    }
+}
+
+#endif
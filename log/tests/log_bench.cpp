@@ -0,0 +1,119 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#include "../log.h"
+#include "../pr.h"
+
+using namespace std;
+
+// 多线程日志吞吐测试：分别以同步和异步方式、不同线程数写日志
+// Logger为单例，每种配置在fork出的子进程中单独初始化运行
+const int g_item_num = 200000;   // 所有线程总共写入的日志条数
+const int g_queue_size = 1024;   // 异步模式下每个线程环形缓冲区可容纳的最长日志条数
+
+struct BenchMode
+{
+    const char *name;
+    bool async;
+    Logger::time_precision precision;
+    bool binary;
+};
+
+const BenchMode g_modes[] = {
+    {"sync", false, Logger::LOG_TIME_SECOND, false},
+    {"async", true, Logger::LOG_TIME_SECOND, false},
+    {"async-us", true, Logger::LOG_TIME_MICRO, false},   //带微秒时间戳的异步日志
+    {"binary", true, Logger::LOG_TIME_MICRO, true},      //二进制日志，不在写日志的线程上格式化
+};
+
+static void run_case(const BenchMode &mode, int thread_num)
+{
+    const char *file = mode.async ? "/tmp/log_bench/async.txt" : "/tmp/log_bench/sync.txt";
+    Logger::get_instance()->set_time_precision(mode.precision);
+    Logger::get_instance()->set_binary(mode.binary);
+    Logger::get_instance()->init(file, mode.async ? g_queue_size : 0, Logger::LOG_LEVEL_INFO, 8192, 1000000);
+
+    int per_thread = g_item_num / thread_num;
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for(int i=0; i<thread_num; i++)
+    {
+        threads.emplace_back([per_thread, i]() {
+            for(int j=0; j<per_thread; j++)
+            {
+                LOG_INFO("[thread_%d] log bench record %d, payload %s", i, j, "abcdefghijklmnopqrstuvwxyz");
+            }
+        });
+    }
+    for(auto &t : threads)
+    {
+        t.join();
+    }
+    auto end = chrono::steady_clock::now();
+    long long dropped = Logger::get_instance()->get_dropped_count();
+    double ms = chrono::duration_cast<chrono::microseconds>(end - start).count() / 1000.0;
+
+    // time为写日志线程的耗时，异步模式下不包括后台线程写完剩余日志的时间
+    printf("%-8s threads=%2d  records=%d  time=%8.1f ms  %8.0f records/s  %6.0f ns/record  dropped=%lld",
+           mode.name, thread_num, per_thread * thread_num, ms,
+           per_thread * thread_num / ms * 1000, ms * 1e6 / (per_thread * thread_num), dropped);
+    fflush(stdout);
+}
+
+// 被过滤掉的调试日志的开销：运行时级别为INFO，编译期级别低于DEBUG时LOG_DEBUG被编译为空语句
+static void run_disabled()
+{
+    const int call_num = 10000000;
+    Logger::get_instance()->init(NULL, 0, Logger::LOG_LEVEL_INFO);
+    auto start = chrono::steady_clock::now();
+    for(int i=0; i<call_num; i++)
+    {
+        LOG_DEBUG("disabled record %d", i);
+    }
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    printf("disabled LOG_DEBUG (LOG_COMPILE_LEVEL=%d): %.2f ns/call\n", LOG_COMPILE_LEVEL, ns / call_num);
+    fflush(stdout);
+}
+
+int main()
+{
+    pr_level = PR_LEVEL_ERROR;   //丢弃条数已在结果中输出
+    fflush(stdout);
+    pid_t disabled_pid = fork();
+    if(disabled_pid == 0)
+    {
+        run_disabled();
+        return 0;
+    }
+    waitpid(disabled_pid, NULL, 0);
+    mkdir("/tmp/log_bench", 0755);
+    int thread_nums[] = {1, 2, 4, 8, 16};
+    for(const BenchMode &mode : g_modes)
+    {
+        for(int thread_num : thread_nums)
+        {
+            fflush(stdout);   //避免子进程继承未输出的缓冲区
+            auto start = chrono::steady_clock::now();
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                run_case(mode, thread_num);
+                return 0;   //正常退出，异步模式下由Logger析构写完剩余日志
+            }
+            waitpid(pid, NULL, 0);
+            auto end = chrono::steady_clock::now();
+            printf("  total=%8.1f ms\n", chrono::duration_cast<chrono::microseconds>(end - start).count() / 1000.0);
+        }
+    }
+    if(system("rm -rf /tmp/log_bench") != 0)
+    {
+        PR_WARN("failed to remove /tmp/log_bench\n");
+    }
+    return 0;
+}
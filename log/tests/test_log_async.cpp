@@ -48,5 +48,6 @@ int main()
     PR_INFO("end logging\n"); 
     PR_INFO("totally write %d items into files\n", g_item_num * g_t_num);
     PR_INFO("costed time: %d ms\n" ,static_cast<int>(duration.count()));
+    PR_INFO("dropped %lld items\n", Logger::get_instance()->get_dropped_count());
     return 0;
 }
\ No newline at end of file
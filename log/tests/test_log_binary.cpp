@@ -0,0 +1,125 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "../log.h"
+#include "../pr.h"
+
+using namespace std;
+
+// 二进制日志测试：子进程以二进制模式多线程写日志，父进程调用log_decoder解码并检查结果
+const int g_item_num = 11000;
+const int g_t_num = 5;
+
+enum test_enum
+{
+    TEST_ENUM_ZERO,
+    TEST_ENUM_ONE,
+};
+
+void log_binary_test(int t_idx)
+{
+    for(int i=0; i<g_item_num; i++)
+    {
+        LOG_INFO("[thread_%d] log binary test: %d", t_idx, i);
+    }
+}
+
+static void write_logs()
+{
+    Logger::get_instance()->set_binary(true);
+    Logger::get_instance()->set_time_precision(Logger::LOG_TIME_MICRO);
+    Logger::get_instance()->init("./log_binary.bin", 256, Logger::LOG_LEVEL_INFO, 8192, 1000000);
+
+    // 覆盖各种参数类型
+    string str = "std::string";
+    char buf[16] = "char array";
+    LOG_ERROR("types: %d %u %lld %llu %hd %c %s %s %s %p %.3f %5.1e %x %o %%", -1, 2u, -3LL, 4ULL,
+              static_cast<short>(-5), 'c', str.c_str(), buf, static_cast<const char*>(NULL),
+              reinterpret_cast<void*>(0x1234), 3.14159, 12345.678, 255, 8);
+    LOG_WARN("width: [%*d] [%-6s] enum %d", 6, 42, "ab", TEST_ENUM_ONE);
+    LOG_INFO("no args");
+
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for(int i=0; i<g_t_num; i++)
+    {
+        threads.emplace_back(log_binary_test, i);
+    }
+    for(int i=0; i<g_t_num; i++)
+    {
+        threads[i].join();
+    }
+    auto end = chrono::steady_clock::now();
+    PR_INFO("binary log: write %d items, costed time: %d ms, dropped %lld items\n", g_item_num * g_t_num,
+            static_cast<int>(chrono::duration_cast<chrono::milliseconds>(end - start).count()),
+            Logger::get_instance()->get_dropped_count());
+}
+
+int main(int, char *argv[])
+{
+    // 日志文件名带有日期前缀
+    time_t now = time(NULL);
+    struct tm tm_buf;
+    localtime_r(&now, &tm_buf);
+    char log_file[64];
+    snprintf(log_file, sizeof(log_file), "./%04d_%02d_%02d_log_binary.bin",
+             tm_buf.tm_year + 1900, tm_buf.tm_mon + 1, tm_buf.tm_mday);
+    unlink(log_file);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        write_logs();
+        return 0;   //正常退出，由Logger析构写完剩余日志
+    }
+    waitpid(pid, NULL, 0);
+
+    // log_decoder与本测试程序在同一目录下
+    string decoder = argv[0];
+    size_t slash = decoder.rfind('/');
+    decoder = (slash == string::npos ? string(".") : decoder.substr(0, slash)) + "/log_decoder " + log_file;
+    FILE *fp = popen(decoder.c_str(), "r");
+    if(!fp)
+    {
+        PR_ERROR("run %s failed\n", decoder.c_str());
+        return 1;
+    }
+
+    char line[1024];
+    int lines = 0;
+    int errors = 0;
+    while(fgets(line, sizeof(line), fp))
+    {
+        if(lines < 3)
+        {
+            PR_INFO("%s", line);
+        }
+        if(lines == 0 && !strstr(line, "types: -1 2 -3 4 -5 c std::string char array (null) 0x1234 3.142 1.2e+04 ff 10 %"))
+        {
+            errors++;
+        }
+        if(lines == 1 && !strstr(line, "width: [    42] [ab    ] enum 1"))
+        {
+            errors++;
+        }
+        lines++;
+    }
+    pclose(fp);
+
+    int expect = g_item_num * g_t_num + 3;
+    PR_INFO("decoded %d lines, expect %d, %d errors\n", lines, expect, errors);
+    if(lines != expect || errors != 0)
+    {
+        PR_ERROR("binary log test failed\n");
+        return 1;
+    }
+    PR_INFO("binary log test passed\n");
+    return 0;
+}
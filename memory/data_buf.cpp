@@ -1,11 +1,21 @@
-#include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <memory.h>
 #include <assert.h>
+#include <errno.h>
 
 #include "data_buf.h"
 #include "pr.h"
 
+#define READ_SPILL_SIZE (64 * 1024)  // 读数据时栈上临时空间的大小
+#define WRITE_IOV_NUM (64)  // 写数据时一次writev最多的chunk个数
+
+// chunk尾部剩余的空间
+static inline int chunk_space(const Chunk *chunk)
+{
+    return chunk->capacity - chunk->head - chunk->length;
+}
+
 // BufferBase 构造函数，初始化为 nullptr
 BufferBase::BufferBase() 
 {
@@ -20,93 +30,161 @@ BufferBase::~BufferBase()
 // 返回数据缓冲区的长度
 const int BufferBase::length() const 
 {
-    return data_buf != nullptr ? data_buf->length : 0;
+    return buf_length;
 }
 
-// 从缓冲区中弹出指定长度的数据
+// 从缓冲区中弹出指定长度的数据，数据被取完的chunk还给内存池
 void BufferBase::pop(int len) 
 {
-    assert(data_buf != nullptr && len <= data_buf->length);
-
-    data_buf->pop(len);
-    if(data_buf->length == 0) {
-        Mempool::get_instance().retrieve(data_buf);
-        data_buf = nullptr;
+    assert(len <= buf_length);
+
+    buf_length -= len;
+    while (len > 0) {
+        int n = len < data_buf->length ? len : data_buf->length;
+        data_buf->pop(n);
+        len -= n;
+        if (data_buf->length == 0) {
+            Chunk *next = data_buf->next;
+            Mempool::get_instance().retrieve(data_buf);
+            data_buf = next;
+        }
+    }
+    if (data_buf == nullptr) {
+        buf_tail = nullptr;
     }
 }
 
 // 清空数据缓冲区
 void BufferBase::clear()
 {
-    if (data_buf != nullptr)  {
+    while (data_buf != nullptr)  {
+        Chunk *next = data_buf->next;
         Mempool::get_instance().retrieve(data_buf);
-        data_buf = nullptr;
+        data_buf = next;
     }
+    buf_tail = nullptr;
+    buf_length = 0;
 }
 
-// 从文件描述符中读取数据到缓冲区，返回读取到的长度
-int InputBuffer::read_from_fd(int fd)
+// 在链表尾部追加一个chunk
+void BufferBase::append_chunk(Chunk *chunk)
 {
-    int need_read;
-    // 获取可读取的字节数到内核缓冲区
-
-    if (ioctl(fd, FIONREAD, &need_read) == -1) {
-        PR_ERROR("ioctl FIONREAD error\n");
-        return -1;
-    }
-    
-    //设置缓冲区大学
-    //缓冲区大小为空
-    if (data_buf == nullptr) {
-        data_buf = Mempool::get_instance().alloc_chunk(need_read);
-        if (data_buf == nullptr) {
-            PR_INFO("no free buf for alloc\n");
-            return -1;
-        }
+    chunk->next = nullptr;
+    if (buf_tail == nullptr) {
+        data_buf = chunk;
     }
     else {
-        assert(data_buf->head == 0);
-        if (data_buf->capacity - data_buf->length < (int)need_read) {   //剩余缓冲区大小装不下要读取的数据
-            Chunk *new_buf = Mempool::get_instance().alloc_chunk(need_read + data_buf->length); //创建一个容量刚好满足的缓冲区
-            if (new_buf == nullptr) {
+        buf_tail->next = chunk;
+    }
+    buf_tail = chunk;
+}
+
+// 将数据复制到链表尾部，先填满尾部chunk的剩余空间，再按剩余长度申请新的chunk
+int BufferBase::append(const char *data, int len)
+{
+    while (len > 0) {
+        if (buf_tail == nullptr || chunk_space(buf_tail) == 0) {
+            Chunk *chunk = Mempool::get_instance().alloc_chunk(len < mUp ? len : mUp);
+            if (chunk == nullptr) {
                 PR_INFO("no free buf for alloc\n");
                 return -1;
             }
-            new_buf->copy(data_buf);    //将原来的数据复制到新缓冲区
-            Mempool::get_instance().retrieve(data_buf);   //回收旧缓冲区
-            data_buf = new_buf;
+            append_chunk(chunk);
+        }
+        int space = chunk_space(buf_tail);
+        int n = len < space ? len : space;
+        memcpy(buf_tail->data + buf_tail->head + buf_tail->length, data, n);
+        buf_tail->length += n;
+        buf_length += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// 从文件描述符中读取数据到缓冲区，返回读取到的长度
+int InputBuffer::read_from_fd(int fd)
+{
+    //尾部chunk没有剩余空间时先申请一个最小的chunk，小消息可以直接读到chunk中，读到数据后再追加到链表
+    Chunk *target = buf_tail;
+    Chunk *new_chunk = nullptr;
+    if (target == nullptr || chunk_space(target) == 0) {
+        new_chunk = Mempool::get_instance().alloc_chunk();
+        if (new_chunk == nullptr) {
+            PR_INFO("no free buf for alloc\n");
+            return -1;
         }
+        target = new_chunk;
     }
 
-    //开始读数据
+    //一次readv读到尾部chunk的剩余空间和栈上的临时空间，不需要先用ioctl查询可读的字节数
+    char spill[READ_SPILL_SIZE];
+    struct iovec iov[2];
+    int space = chunk_space(target);
+    iov[0].iov_base = target->data + target->head + target->length;
+    iov[0].iov_len = space;
+    iov[1].iov_base = spill;
+    iov[1].iov_len = sizeof(spill);
+
     int already_read = 0;  //已读数据长度
     do { 
-        if(need_read == 0) {//首次读取，或者上一次读取已完成
-            already_read = read(fd, data_buf->data + data_buf->length, m4K);  //将读取到的数据放在缓冲区的数据之后
-        } else {
-            already_read = read(fd, data_buf->data + data_buf->length, need_read);
-        }
+        already_read = readv(fd, iov, 2);
     } while (already_read == -1 && errno == EINTR);
-    if (already_read > 0)  {
-        if (need_read != 0) {
-            assert(already_read == need_read);
+
+    if (already_read <= 0) {
+        if (new_chunk != nullptr) {
+            Mempool::get_instance().retrieve(new_chunk);
         }
-        data_buf->length += already_read;
+        return already_read;
+    }
+    if (new_chunk != nullptr) {
+        append_chunk(new_chunk);
+    }
+
+    int n = already_read < space ? already_read : space;
+    buf_tail->length += n;
+    buf_length += n;
+    //临时空间中的数据追加到新的chunk
+    if (already_read > space && append(spill, already_read - space) == -1) {
+        return -1;
     }
 
     return already_read;
 }
 
-// 获取缓冲区中的数据
-const char *InputBuffer::get_from_buf() const 
+// 获取缓冲区中的数据，数据分布在多个chunk中时合并到一个足够大的chunk
+// 只有在取数据时才合并，读数据的过程中缓冲区增长不会复制已有的数据
+const char *InputBuffer::get_from_buf()
 {
-    return data_buf != nullptr ? data_buf->data + data_buf->head : nullptr;
+    if (data_buf == nullptr) {
+        return nullptr;
+    }
+    if (data_buf->next != nullptr) {
+        Chunk *merged = Mempool::get_instance().alloc_chunk(buf_length);
+        if (merged == nullptr) {
+            PR_INFO("no free buf for alloc\n");
+            return nullptr;
+        }
+        int offset = 0;
+        for (Chunk *c = data_buf; c != nullptr; ) {
+            memcpy(merged->data + offset, c->data + c->head, c->length);
+            offset += c->length;
+            Chunk *next = c->next;
+            Mempool::get_instance().retrieve(c);
+            c = next;
+        }
+        merged->length = offset;
+        data_buf = buf_tail = nullptr;
+        append_chunk(merged);
+        Mempool::get_instance().add_grow_copy(merged);
+    }
+    return data_buf->data + data_buf->head;
 }
 
-// 调整数据缓冲区
+// 调整数据缓冲区，只有一个chunk时把数据移动到chunk开头，腾出尾部空间
 void InputBuffer::adjust()
 {
-    if (data_buf != nullptr) {
+    if (data_buf != nullptr && data_buf->next == nullptr) {
         data_buf->adjust();
     }
 }
@@ -114,48 +192,36 @@ void InputBuffer::adjust()
 // 将数据写入到缓冲区
 int OutputBuffer::write2buf(const char *data, int len)
 {
-    //根据写入数据的长度，判断是否需要给缓冲区分配内存
-    if (data_buf == nullptr) {
-        data_buf = Mempool::get_instance().alloc_chunk(len);
-        if (data_buf == nullptr) {
-            PR_INFO("no free buf for alloc\n");
-            return -1;
-        }
-    }
-    else {
-        assert(data_buf->head == 0);
-        if (data_buf->capacity - data_buf->length < len) {
-            Chunk *new_buf = Mempool::get_instance().alloc_chunk(len + data_buf->length);
-            if (new_buf == nullptr) {
-                PR_INFO("no free buf for alloc\n");
-                return -1;
-            }
-            new_buf->copy(data_buf);
-            Mempool::get_instance().retrieve(data_buf);
-            data_buf = new_buf;
-        }
-    }
-
-    memcpy(data_buf->data + data_buf->length, data, len);
-    data_buf->length += len;
-
-    return 0;
+    return append(data, len);
 }
 
-// 将数据从输入缓冲区写入到文件描述符
-int OutputBuffer::write2fd(int fd)
+// 将缓冲区中的数据写入到文件描述符
+int OutputBuffer::write2fd(int fd, int max_len)
 {
-    assert(data_buf != nullptr && data_buf->head == 0);
+    assert(data_buf != nullptr);
+
+    struct iovec iov[WRITE_IOV_NUM];
+    int iov_cnt = 0;
+    int left = max_len < 0 ? buf_length : max_len;
+    for (Chunk *c = data_buf; c != nullptr && iov_cnt < WRITE_IOV_NUM && left > 0; c = c->next) {
+        int n = c->length < left ? c->length : left;
+        iov[iov_cnt].iov_base = c->data + c->head;
+        iov[iov_cnt].iov_len = n;
+        iov_cnt++;
+        left -= n;
+    }
+    if (iov_cnt == 0) {
+        return 0;
+    }
 
     int already_write = 0;
 
     do { 
-        already_write = write(fd, data_buf->data, data_buf->length);
+        already_write = writev(fd, iov, iov_cnt);
     } while (already_write == -1 && errno == EINTR);
 
     if (already_write > 0) {
-        data_buf->pop(already_write);
-        data_buf->adjust();
+        pop(already_write);  //只移动chunk的头部偏移量，不移动数据
     }
 
     if (already_write == -1 && errno == EAGAIN) {
@@ -163,4 +229,4 @@ int OutputBuffer::write2fd(int fd)
     }
 
     return already_write;
-}
\ No newline at end of file
+}
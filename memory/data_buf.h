@@ -1,9 +1,11 @@
 #ifndef __DATA_BUF_H__
-#define __DATA_NIF_H__
+#define __DATA_BUF_H__
 
 #include "chunk.h"
 #include "mem_pool.h"
 
+// 缓冲区由内存池分配的chunk通过next指针串成链表，数据从链表头部读出、向链表尾部追加
+// 数据增长时在尾部追加新的chunk，不再申请更大的chunk并复制原有数据
 class BufferBase {
 public:
     BufferBase();
@@ -14,15 +16,22 @@ public:
     void clear();
 
 protected:
-    Chunk *data_buf{ nullptr };
+    void append_chunk(Chunk *chunk);  // 在链表尾部追加一个chunk
+    int append(const char *data, int len);  // 将数据复制到链表尾部，空间不够时追加chunk
+
+    Chunk *data_buf{ nullptr };  // 链表头部的chunk
+    Chunk *buf_tail{ nullptr };  // 链表尾部的chunk
+    int buf_length{ 0 };  // 所有chunk中的数据总长度
 };
 
 class InputBuffer : public BufferBase 
 {
 public:
+    // 使用readv读取到尾部chunk的剩余空间和栈上的临时空间，临时空间中的数据再追加到新的chunk中
     int read_from_fd(int fd);
 
-    const char *get_from_buf() const;
+    // 获取缓冲区中连续的数据，数据分布在多个chunk中时先合并到一个chunk
+    const char *get_from_buf();
 
     void adjust();
 };
@@ -32,7 +41,8 @@ class OutputBuffer : public BufferBase
 public:
     int write2buf(const char *data, int len);
 
-    int write2fd(int fd);
+    // 使用writev一次写出链表中多个chunk的数据，max_len不小于0时最多写出max_len字节
+    int write2fd(int fd, int max_len = -1);
 };
 
-#endif
\ No newline at end of file
+#endif
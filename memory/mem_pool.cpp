@@ -3,34 +3,105 @@
 #include "../log/pr.h"
 #include "mem_pool.h"
 
+// 每种大小的内存块在每个线程缓存中最多保存的个数，大块内存占用多，缓存得少
+static const int CACHE_CAPACITY[MEM_CLASS_NUM] = { 64, 32, 16, 8, 2, 1 };
+
+// 线程缓存中各种内存块个数的槽位，每个线程独占一个，只由所属线程写入，get_stats读取所有槽位求和
+struct CacheStatSlot {
+    alignas(64) atomic<bool> used{ false };
+    atomic<int> cached[MEM_CLASS_NUM]{};
+};
+
+static CacheStatSlot g_cache_slots[MEM_STAT_SLOTS];
+
+// 线程缓存：每个线程（即每个事件循环）每种大小一条内存块链表
+// 分配和回收先在线程缓存中进行，不加锁；缓存空了从内存池批量取一半容量，超过容量时批量还回一半
+// 每次分配回收后把链表长度写入自己的槽位（relaxed的store，不与其他线程共享缓存行）
+// 槽位在第一次写入时才申请，保持默认构造，访问tl_cache不需要经过线程局部变量的初始化检查
+struct ThreadCache {
+    ChunkList lists[MEM_CLASS_NUM];
+    CacheStatSlot *slot{ nullptr }; // 槽位用完时为空，该线程缓存中的内存块计入使用中
+    bool slot_claimed{ false }; // 是否已经尝试申请过槽位
+
+    ~ThreadCache() {
+        Mempool::get_instance().flush_thread_cache(); // 线程退出时把缓存还给内存池
+        if (slot != nullptr) {
+            slot->used.store(false, memory_order_release);
+        }
+    }
+
+    bool claim_slot() {
+        slot_claimed = true;
+        for (int i = 0; i < MEM_STAT_SLOTS; i++) {
+            bool expected = false;
+            if (!g_cache_slots[i].used.load(memory_order_relaxed)
+                && g_cache_slots[i].used.compare_exchange_strong(expected, true)) {
+                slot = &g_cache_slots[i];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void sync(int cls) {
+        if (slot == nullptr && (slot_claimed || !claim_slot())) {
+            return;
+        }
+        slot->cached[cls].store(lists[cls].count, memory_order_relaxed);
+    }
+};
+
+static thread_local ThreadCache tl_cache;
+
+// 获取大小对应的内存块种类下标，向上取整
+int Mempool::size_to_class(int n)
+{
+    int cls = 0;
+    for (int cap = mLow; cap <= mUp; cap = cap * MEM_CAP_MULTI_POWER, cls++) {
+        if (n <= cap) {
+            return cls;
+        }
+    }
+    return -1;
+}
+
 // 内存初始化函数，根据给定的大小和数量初始化内存池
 void Mempool::mem_init(MEM_CAP size, int chunk_num)
 {
-    Chunk *prev; 
-    // 尝试分配指定大小的第一个Chunk
-    mp_pool[size] = new (std::nothrow) Chunk(size); // 在失败时返回null，不抛出异常
-    // 检查分配是否成功
-    if (mp_pool[size] == nullptr) {
-        PR_ERROR("new chunk %d error", static_cast<int>(size));
-        exit(1);
-    }
-    prev = mp_pool[size];
-
-    // 迭代创建指定数量的Chunk并连接起来
-    for (int i = 1; i < chunk_num; i ++) {
-        prev->next = new (std::nothrow) Chunk(size);
-        if (prev->next == nullptr) {
-            PR_ERROR("new chunk m4K error");
+    int cls = size_to_class(size);
+    ChunkList &list = mp_pool[cls];
+    // 迭代创建指定数量的Chunk并插入链表头部
+    for (int i = 0; i < chunk_num; i ++) {
+        Chunk *chunk = new (std::nothrow) Chunk(size); // 在失败时返回null，不抛出异常
+        // 检查分配是否成功
+        if (chunk == nullptr) {
+            PR_ERROR("new chunk %d error", static_cast<int>(size));
             exit(1);
         }
-        prev = prev->next;
+        chunk->next = list.head;
+        list.head = chunk;
+        list.count++;
     }
     // 更新总内存大小
     mp_total_size_kb += size / 1024 * chunk_num;
+    mp_counters[cls].cc_total.fetch_add(chunk_num, memory_order_relaxed);
+    update_pooled(cls);
+}
+
+// 同步全局链表中的内存块个数，并更新不在全局链表中的内存块数的最大值，只在mp_mutex内调用
+void Mempool::update_pooled(int cls)
+{
+    ClassCounters &cc = mp_counters[cls];
+    int64_t pooled = mp_pool[cls].count;
+    cc.cc_pooled.store(pooled, memory_order_relaxed);
+    int64_t out = cc.cc_total.load(memory_order_relaxed) - pooled;
+    if (out > cc.cc_peak.load(memory_order_relaxed)) {
+        cc.cc_peak.store(out, memory_order_relaxed);
+    }
 }
 
-// Mempool类的构造函数，初始化内存池并设置总内存大小和剩余内存大小
-Mempool::Mempool() : mp_total_size_kb(0), mp_left_size_kb(0)
+// Mempool类的构造函数，初始化内存池并设置总内存大小
+Mempool::Mempool() : mp_total_size_kb(0)
 {
     mem_init(m4K, 2000);
     mem_init(m16K, 500);
@@ -38,109 +109,170 @@ Mempool::Mempool() : mp_total_size_kb(0), mp_left_size_kb(0)
     mem_init(m256K, 100);
     mem_init(m1M, 25);
     mem_init(m4M, 10);
-    mp_left_size_kb = mp_total_size_kb;
 }
 
-// 分配指定大小的Chunk内存块
-Chunk *Mempool::alloc_chunk(int n) 
+// 从内存池中批量取出内存块放入list，一次加锁取出多个；内存池中没有时新申请一个
+int Mempool::fetch_batch(int cls, ChunkList& list, int n)
 {
-    int index;
-    bool found = false;
-    // 查找适合大小的内存块，采取向上整
-    for(index = mLow; index <= mUp; index = index * MEM_CAP_MULTI_POWER)
+    int size = mLow << (2 * cls);
+    int fetched = 0;
     {
-        if(n <= index)
-        {
-            found = true;
-            break;
+        lock_guard<mutex> lck(mp_mutex);
+        ChunkList &pool = mp_pool[cls];
+        while (fetched < n && pool.head != nullptr) {
+            Chunk *chunk = pool.head;
+            pool.head = chunk->next;
+            chunk->next = list.head;
+            list.head = chunk;
+            fetched++;
         }
-    }
+        pool.count -= fetched;
 
-    if(!found)
-    {
-        return nullptr;
+        if (fetched == 0) {
+            if (mp_total_size_kb + size / 1024 >= MAX_POOL_SIZE) {
+                PR_ERROR("beyond the limit size of memory!\n");
+                exit(1);
+            }
+            mp_total_size_kb += size / 1024; //新分配了内存块，内存池大小增加
+            mp_counters[cls].cc_total.fetch_add(1, memory_order_relaxed);
+            mp_counters[cls].cc_fallback.fetch_add(1, memory_order_relaxed);
+        }
+        update_pooled(cls);
     }
 
-    // 加锁并执行分配内存块的操作
-    lock_guard<mutex> lck(mp_mutex);
-    // 如果对应大小的内存池为空，尝试动态分配
-    if (mp_pool[index] == nullptr) {
-        if (mp_total_size_kb + index / 1024 >= MAX_POOL_SIZE) {
-            PR_ERROR("beyond the limit size of memory!\n");
+    // 如果对应大小的内存池为空，在锁外动态分配
+    if (fetched == 0) {
+        Chunk *new_buf = new (std::nothrow) Chunk(size);
+        if (new_buf == nullptr) {
+            PR_ERROR("new chunk error\n");
             exit(1);
         }
+        new_buf->next = list.head;
+        list.head = new_buf;
+        fetched = 1;
+    }
+    list.count += fetched;
+    return fetched;
+}
 
-        Chunk *new_buf = new (std::nothrow) Chunk(index);
-        if (new_buf == nullptr) {
-            PR_ERROR("new chunk error\n");
-            exit(1); 
-        } 
-        mp_total_size_kb += index / 1024; //新分配了内存块，内存池大小增加
-        return new_buf;
+// 从list头部取出n个内存块，一次加锁挂回内存池
+void Mempool::release_batch(int cls, ChunkList& list, int n)
+{
+    if (n <= 0 || list.head == nullptr) {
+        return;
+    }
+    // 在锁外找到要还回的一段链表
+    Chunk *first = list.head;
+    Chunk *last = first;
+    int released = 1;
+    while (released < n && last->next != nullptr) {
+        last = last->next;
+        released++;
+    }
+    list.head = last->next;
+    list.count -= released;
+
+    lock_guard<mutex> lck(mp_mutex);
+    ChunkList &pool = mp_pool[cls];
+    last->next = pool.head;
+    pool.head = first;
+    pool.count += released;
+    update_pooled(cls);
+}
+
+// 分配指定大小的Chunk内存块，向上取整到最近的内存块大小
+Chunk *Mempool::alloc_chunk(int n) 
+{
+    int cls = size_to_class(n);
+    if (cls < 0) {
+        mp_oversize.fetch_add(1, memory_order_relaxed);
+        return nullptr;
     }
 
-    // 从内存池中拿取内存块，拿取对应大小的内存池头部内存块
-    Chunk *target = mp_pool[index];
-    mp_pool[index] = target->next;  //更新头部内存块
+    // 线程缓存为空时从内存池批量补充
+    ChunkList &cache = tl_cache.lists[cls];
+    if (cache.head == nullptr) {
+        int batch = CACHE_CAPACITY[cls] / 2;
+        fetch_batch(cls, cache, batch > 0 ? batch : 1);
+    }
+
+    // 从线程缓存中拿取内存块，拿取链表头部内存块
+    Chunk *target = cache.head;
+    cache.head = target->next;  //更新头部内存块
+    cache.count--;
+    tl_cache.sync(cls);
     target->next = nullptr;
-    mp_left_size_kb -= index / 1024;  //剩余内存池大小减小
 
     return target;
 }
 
-// 回收内存块到内存池
+// 回收内存块到当前线程的缓存，超过缓存容量时批量还给内存池
 void Mempool::retrieve(Chunk *block)
 {
-    int index = block->capacity;
+    int cls = size_to_class(block->capacity);
+    assert(cls >= 0 && block->capacity == (mLow << (2 * cls)));
     //数据长度和起始偏移量置为0
     block->length = 0;
     block->head = 0;
 
-    // 加锁并执行回收内存操作
-    lock_guard<mutex> lck(mp_mutex);
-    assert(mp_pool.find(index) != mp_pool.end());
-
-    block->next = mp_pool[index];
+    ChunkList &cache = tl_cache.lists[cls];
+    block->next = cache.head;
     //更新块头
-    mp_pool[index] = block;
-    mp_left_size_kb += block->capacity / 1024;
+    cache.head = block;
+    cache.count++;
+    if (cache.count > CACHE_CAPACITY[cls]) {
+        release_batch(cls, cache, cache.count - CACHE_CAPACITY[cls] / 2);
+    }
+    tl_cache.sync(cls);
 }
 
-// 获取指定内存池容量大小的总字节大小
-int Mempool::get_list_size_byte(MEM_CAP index)
+// 将当前线程缓存的内存块全部还给内存池
+void Mempool::flush_thread_cache()
 {
-    int size = 0;
-    // 加锁并计算指定内存池容量的总字节大小
-    lock_guard<mutex> lck(mp_mutex);
-    assert(mp_pool.find(index) != mp_pool.end());
-    Chunk *node = mp_pool[index];
-
-    while(node)
-    {
-        size += node->capacity;
-        node = node->next;
-    } 
+    for (int cls = 0; cls < MEM_CLASS_NUM; cls++) {
+        release_batch(cls, tl_cache.lists[cls], tl_cache.lists[cls].count);
+        tl_cache.sync(cls);
+    }
+}
 
-    return size;
+void Mempool::add_grow_copy(const Chunk *chunk)
+{
+    int cls = size_to_class(chunk->capacity);
+    if (cls >= 0) {
+        mp_counters[cls].cc_grow_copies.fetch_add(1, memory_order_relaxed);
+    }
 }
 
-// 打印指定内存池容量大小的数据内容
-void Mempool::print_list_content(MEM_CAP index)
+// 各计数分别读取：全局链表的计数在锁内写入，线程缓存的个数从各线程的槽位求和，使用中的个数由总数减去空闲数得到
+void Mempool::get_stats(MempoolStats& out) const
 {
-    // 加锁并打印内存池容量大小的数据内容
-    lock_guard<mutex> lck(mp_mutex);
-    int cnt = 0;
-    printf("***************start to print %dkb chunk_size list data*******************\n", index / 1024);
-    assert(mp_pool.find(index) != mp_pool.end());
-    Chunk *node = mp_pool[index];
+    for (int cls = 0; cls < MEM_CLASS_NUM; cls++) {
+        const ClassCounters &cc = mp_counters[cls];
+        MempoolClassStats &cs = out.ms_classes[cls];
+        cs.cs_size = mLow << (2 * cls);
+        cs.cs_total = cc.cc_total.load(memory_order_relaxed);
+        cs.cs_pooled = cc.cc_pooled.load(memory_order_relaxed);
+        cs.cs_peak = cc.cc_peak.load(memory_order_relaxed);
+        cs.cs_fallback = cc.cc_fallback.load(memory_order_relaxed);
+        cs.cs_grow_copies = cc.cc_grow_copies.load(memory_order_relaxed);
+        cs.cs_cached = 0;
+        for (int i = 0; i < MEM_STAT_SLOTS; i++) {
+            cs.cs_cached += g_cache_slots[i].cached[cls].load(memory_order_relaxed);
+        }
+        int64_t in_use = cs.cs_total - cs.cs_pooled - cs.cs_cached;
+        cs.cs_in_use = in_use > 0 ? in_use : 0;
+    }
+    out.ms_oversize = mp_oversize.load(memory_order_relaxed);
+}
 
-    while (node)
-    {
-        if(cnt <= 5)
-            node->print_data();
-        cnt++;
-        node = node->next;
-    }
-    printf("...\n");
-    printf("******************end, node cnt is %d************************\n\n", cnt);
-}
\ No newline at end of file
+void MempoolStats::print(FILE* out) const
+{
+    fprintf(out, "%8s %8s %8s %8s %8s %8s %10s %12s\n",
+            "size", "total", "in_use", "pooled", "cached", "peak", "fallback", "grow_copies");
+    for (const MempoolClassStats &cs : ms_classes) {
+        fprintf(out, "%7dK %8lld %8lld %8lld %8lld %8lld %10llu %12llu\n", cs.cs_size / 1024,
+                (long long)cs.cs_total, (long long)cs.cs_in_use, (long long)cs.cs_pooled, (long long)cs.cs_cached,
+                (long long)cs.cs_peak, (unsigned long long)cs.cs_fallback, (unsigned long long)cs.cs_grow_copies);
+    }
+    fprintf(out, "oversize failures: %llu\n", (unsigned long long)ms_oversize);
+}
@@ -1,16 +1,17 @@
 #ifndef __MEM_POOL_H__
 #define __MEM_POOL_H__
 
-#include <unordered_map>
+#include <stdint.h>
+#include <stdio.h>
 #include <mutex>
+#include <atomic>
 
 #include "chunk.h"
 
 using namespace std;
 
-typedef unordered_map<int, Chunk*> pool_t;
-
 #define MEM_CAP_MULTI_POWER (4)
+#define MEM_CLASS_NUM (6) // 内存块大小的种类数：4KB到4MB
 
 typedef enum {
     mLow    = 4096, // 最低内存容量：4KB
@@ -24,7 +25,38 @@ typedef enum {
 } MEM_CAP;
 
 #define MAX_POOL_SIZE (4U *1024 *1024) // 最大内存池大小：4MB
+#define MEM_STAT_SLOTS (256) // 记录线程缓存中内存块个数的槽位数，超过该线程数时多出的线程缓存计入使用中
+
+// 一种内存块的统计快照
+struct MempoolClassStats {
+    int cs_size{ 0 }; // 内存块容量(字节)
+    int64_t cs_total{ 0 }; // 已创建的内存块数，包括mem_init预先创建的和内存池为空时新申请的
+    int64_t cs_in_use{ 0 }; // 正在使用的内存块数（已分配出去还没有回收）
+    int64_t cs_pooled{ 0 }; // 全局链表中空闲的内存块数
+    int64_t cs_cached{ 0 }; // 各线程缓存中空闲的内存块数
+    int64_t cs_peak{ 0 }; // 不在全局链表中（使用中和线程缓存中）的内存块数的最大值，mem_init的个数不小于它时不会新申请内存块
+    uint64_t cs_fallback{ 0 }; // 全局链表为空、新申请内存块的次数
+    uint64_t cs_grow_copies{ 0 }; // 缓冲区的多个内存块合并复制到一个该种内存块的次数
+
+    int64_t free_num() const { return cs_pooled + cs_cached; } // 空闲的内存块数
+};
+
+// 内存池的统计快照，各计数分别读取，不是同一时刻的值，但每个计数都是完整的
+struct MempoolStats {
+    MempoolClassStats ms_classes[MEM_CLASS_NUM]; // 下标为内存块种类
+    uint64_t ms_oversize{ 0 }; // 请求超过最大容量而分配失败的次数
+
+    void print(FILE* out) const; // 每种内存块输出一行
+};
+
+// 每种大小的内存块组成的链表
+struct ChunkList {
+    Chunk *head{ nullptr }; // 链表头
+    int count{ 0 }; // 链表中内存块的个数
+};
 
+// 内存池：全局的内存块链表由互斥锁保护，每个线程前面有一层不加锁的线程缓存，
+// 分配和回收通常只访问线程缓存，缓存空或满时才和全局链表批量交换内存块
 class Mempool 
 {
 public:
@@ -42,22 +74,24 @@ public:
     // 回收Chunk内存
     void retrieve(Chunk *block);
 
+    // 将当前线程缓存的内存块全部还给内存池，线程退出时会自动调用
+    void flush_thread_cache();
+
+    // 获取大小对应的内存块种类下标，n超过最大容量时返回-1
+    static int size_to_class(int n);
+
+    // 获取各种内存块的统计快照，只读取原子计数，不加锁，可以在任意线程中调用，开销与线程数成正比
+    void get_stats(MempoolStats& out) const;
+
+    // 记录一次合并复制：缓冲区的多个内存块被复制到一个更大的内存块chunk中
+    void add_grow_copy(const Chunk *chunk);
+
     // FIXME: 使用智能指针管理Chunk或添加销毁接口以回收内存
     // static void destroy();
 
     // 析构函数
     ~Mempool() = default;
 
-    // 用于调试的API
-    [[deprecated("内存池调试API已弃用!")]]
-    int get_total_size_kb(){ return mp_total_size_kb; }  //获取内存池总大小
-    [[deprecated("内存池调试API已弃用!")]]
-    int get_left_size_kb(){ return mp_left_size_kb; }   //获取内存池剩余大小
-    [[deprecated("内存池调试API已弃用!")]]
-    int get_list_size_byte(MEM_CAP index);      //获取指定内存池容量的字节大小
-    [[deprecated("内存池调试API已弃用!")]] 
-    void print_list_content(MEM_CAP index);    //用于打印指定内存池容量的内容
-    
 private:
     Mempool(); // 构造函数
     Mempool(const Mempool&) = delete; // 禁用拷贝构造函数
@@ -67,10 +101,27 @@ private:
 
     void mem_init(MEM_CAP size, int chunk_num); // 初始化内存
 
-    pool_t mp_pool; // 内存池映射表
+    // 从内存池中批量取出最多n个内存块放入list，不足时新申请内存块，返回取出的个数
+    int fetch_batch(int cls, ChunkList& list, int n);
+    // 从list头部取出n个内存块批量放回内存池
+    void release_batch(int cls, ChunkList& list, int n);
+
+    // 每种内存块的计数：前三个只在mp_mutex内写入，读取不加锁；合并复制的次数由各线程原子累加
+    struct ClassCounters {
+        alignas(64) atomic<int64_t> cc_total{ 0 }; // 已创建的内存块数
+        atomic<int64_t> cc_pooled{ 0 }; // mp_pool[i].count的副本
+        atomic<int64_t> cc_peak{ 0 }; // cc_total - cc_pooled的最大值
+        atomic<uint64_t> cc_fallback{ 0 }; // 新申请内存块的次数
+        atomic<uint64_t> cc_grow_copies{ 0 }; // 合并复制的次数
+    };
+
+    void update_pooled(int cls); // 在mp_mutex内调用，同步全局链表的个数和最大值
+
+    ChunkList mp_pool[MEM_CLASS_NUM]; // 内存池，下标为内存块种类，种类i的容量为mLow * 4^i
     uint64_t mp_total_size_kb; // 总内存大小（KB）
-    uint64_t mp_left_size_kb; // 剩余内存大小（KB）
     mutex mp_mutex; // 互斥锁
+    ClassCounters mp_counters[MEM_CLASS_NUM]; // 每种内存块的计数
+    atomic<uint64_t> mp_oversize{ 0 }; // 请求超过最大容量的次数
 };
 
 #endif
\ No newline at end of file
@@ -1,9 +1,58 @@
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <vector>
 
 #include "data_buf.h"
 #include "log.h"
 
+//大数据量经过多个chunk组成的链式缓冲区：OutputBuffer分小段写入后writev到socket，InputBuffer分多次readv读出，校验数据并统计耗时
+void test_chained(int total)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+        LOG_ERROR("socketpair failed\n");
+        return;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    std::vector<char> src(total);
+    for (int i = 0; i < total; i++) {
+        src[i] = 'a' + i % 26;
+    }
+
+    InputBuffer ib;
+    OutputBuffer ob;
+    const int piece = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int off = 0; off < total; off += piece) {
+        int n = total - off < piece ? total - off : piece;
+        ob.write2buf(src.data() + off, n);
+    }
+    while (ob.length() > 0 || ib.length() < total) {
+        if (ob.length() > 0) {
+            ob.write2fd(fds[0]);
+        }
+        if (ib.read_from_fd(fds[1]) == -1 && errno != EAGAIN) {
+            LOG_ERROR("read from socket failed\n");
+            break;
+        }
+    }
+    const char *data = ib.get_from_buf();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool ok = ib.length() == total && memcmp(data, src.data(), total) == 0;
+    LOG_INFO("chained buffer transfer %d bytes %s, cost %.2f ms\n", total, ok ? "ok" : "FAILED", ms);
+    assert(ok);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
 int main()
 {
     Logger::get_instance()->init(NULL);
@@ -50,6 +99,8 @@ int main()
 
     fclose(fp);
 
+    test_chained(2 * 1024 * 1024);
+
     return 0;
 }
 
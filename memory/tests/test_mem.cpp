@@ -1,36 +1,33 @@
 #include <vector>
 #include <memory>
+#include <thread>
+#include <chrono>
 #include <string.h>
 
 #include "mem_pool.h"
 #include "log.h"
+#include "test_check.h"
 
 using namespace std;
 vector<Chunk*> chunks;   //全局变量，存储了所有缓冲区
 
-//输出内存池的总大小
-void print_total_size()
+//输出内存池各种内存块的统计
+MempoolStats print_stats()
 {
-    int total_size = Mempool::get_instance().get_total_size_kb();
-    LOG_INFO("total size of mem pool is %dkb\n", total_size);
+    MempoolStats stats;
+    Mempool::get_instance().get_stats(stats);
+    stats.print(stdout);
+    return stats;
 }
 
-//输出内存池的剩余大小
-void print_left_size()
+//每种内存块的总数都等于使用中、全局链表中和线程缓存中的个数之和
+bool stats_consistent(const MempoolStats& stats)
 {
-    int left_size = Mempool::get_instance().get_left_size_kb();
-    LOG_INFO("left size of mem pool is %dkb\n", left_size);
-}
-
-//输出指定大小的内存池的容量
-void print_list_size()
-{
-    int list_size;
-    for(int index = mLow; index <= mUp; index = index * MEM_CAP_MULTI_POWER)
-    {
-        list_size = Mempool::get_instance().get_list_size_byte((MEM_CAP)index);
-        LOG_INFO("total size of pool's %dkb list is %dkb\n", index/1024, list_size/1024);
-    }  
+    bool ok = true;
+    for (const MempoolClassStats& cs : stats.ms_classes) {
+        ok &= cs.cs_total == cs.cs_in_use + cs.cs_pooled + cs.cs_cached && cs.cs_peak >= cs.cs_total - cs.cs_pooled;
+    }
+    return ok;
 }
 
 //打印所有大小的内存块中的数据
@@ -117,15 +114,56 @@ void retrieve_chunks(vector<Chunk*>& chunks)
     }
 }
 
-int main()
+//多线程分配回收压测：每个线程循环分配一批不同大小的chunk再全部回收，模拟缓冲区的申请和释放
+void bench_worker(int rounds, long long* ops)
+{
+    const int sizes[] = { m4K, m4K, m4K, m16K, m4K, m64K, m4K, m16K };
+    const int batch = sizeof(sizes) / sizeof(sizes[0]);
+    Chunk *held[batch];
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < batch; i++) {
+            held[i] = Mempool::get_instance().alloc_chunk(sizes[i]);
+        }
+        for (int i = 0; i < batch; i++) {
+            Mempool::get_instance().retrieve(held[i]);
+        }
+    }
+    *ops = (long long)rounds * batch * 2;
+}
+
+//统计1到32个线程下分配回收的总吞吐量
+void bench_alloc_retrieve(int rounds)
+{
+    printf("===================multi-thread alloc/retrieve bench, rounds per thread: %d\n", rounds);
+    for (int thread_num = 1; thread_num <= 32; thread_num *= 2) {
+        vector<thread> threads;
+        vector<long long> ops(thread_num, 0);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < thread_num; i++) {
+            threads.emplace_back(bench_worker, rounds, &ops[i]);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        long long total = 0;
+        for (auto n : ops) {
+            total += n;
+        }
+        printf("threads: %-3d ops: %-10lld ops/s: %-12.0f ns/op: %.1f\n", thread_num, total, total / secs, secs * 1e9 / total);
+    }
+}
+
+int main(int argc, char *argv[])
 {
     Logger::get_instance()->init(NULL);   //在终端输出
 
     //未分配前
     LOG_INFO("===================before alloc...\n");
-    print_total_size();
-    print_left_size();
-    print_list_size();
+    MempoolStats before = print_stats();
+    check(stats_consistent(before), "stats: total = in_use + pooled + cached");
+    check(before.ms_classes[0].cs_in_use == 0 && before.ms_classes[0].cs_total == before.ms_classes[0].cs_pooled,
+          "stats: nothing in use before alloc");
     //print_list_content();
 
     shared_ptr<Chunk> sp_chunk = make_shared<Chunk>(10);
@@ -147,23 +185,57 @@ int main()
     alloc_and_fill(sp_chunk, chunks, m4M, 30);
     LOG_INFO("alloc 30 chunks, chunk size: %dkb\n", m4M/1024);
 
-    //分配后的内存池
+    //分配后的内存池，16KB只预先创建了500个，多出的从堆上新申请
     LOG_INFO("===================after alloc...\n");
-    print_total_size();
-    print_left_size();
-    print_list_size();
+    MempoolStats allocated = print_stats();
+    check(stats_consistent(allocated), "stats: consistent after alloc");
+    const int expect_in_use[MEM_CLASS_NUM] = { 1000, 1000, 500, 30, 30, 30 };
+    bool ok = true;
+    for (int cls = 0; cls < MEM_CLASS_NUM; cls++) {
+        ok &= allocated.ms_classes[cls].cs_in_use == expect_in_use[cls]
+              && allocated.ms_classes[cls].cs_peak >= expect_in_use[cls];
+    }
+    check(ok, "stats: in_use and peak match allocations");
+    check(allocated.ms_classes[1].cs_fallback >= 500 && allocated.ms_classes[1].cs_total >= 1000,
+          "stats: fallback allocations counted");
+
+    check(Mempool::get_instance().alloc_chunk(mUp + 1) == nullptr, "alloc beyond 4MB fails");
+    Chunk *merged = Mempool::get_instance().alloc_chunk(m64K);
+    Mempool::get_instance().add_grow_copy(merged);
+    Mempool::get_instance().retrieve(merged);
+    MempoolStats counted = print_stats();
+    check(counted.ms_oversize == allocated.ms_oversize + 1, "stats: oversize failure counted");
+    check(counted.ms_classes[2].cs_grow_copies == allocated.ms_classes[2].cs_grow_copies + 1, "stats: grow copy counted");
     //print_list_content();
 
     //回收内存池
     LOG_INFO("===================start to retrieve...\n");
     retrieve_chunks(chunks);
 
-     //回收后的内存池
+     //回收后的内存池，内存块都在全局链表或本线程缓存中，最大值保持不变
     LOG_INFO("===================after retrieve...\n");
-    print_total_size();
-    print_left_size();
-    print_list_size();
+    MempoolStats retrieved = print_stats();
+    ok = stats_consistent(retrieved);
+    for (int cls = 0; cls < MEM_CLASS_NUM; cls++) {
+        ok &= retrieved.ms_classes[cls].cs_in_use == 0 && retrieved.ms_classes[cls].cs_peak == counted.ms_classes[cls].cs_peak;
+    }
+    check(ok, "stats: nothing in use after retrieve, peak kept");
     //print_list_content();
 
+    bench_alloc_retrieve(argc > 1 ? atoi(argv[1]) : 100000);
+
+    //压测线程退出时把线程缓存还回了内存池
+    MempoolStats after_bench = print_stats();
+    ok = stats_consistent(after_bench);
+    for (const MempoolClassStats& cs : after_bench.ms_classes) {
+        ok &= cs.cs_in_use == 0;
+    }
+    check(ok, "stats: consistent after multi-thread bench");
+
+    if (g_failed) {
+        printf("%d checks failed\n", g_failed);
+        return 1;
+    }
+    printf("all checks passed\n");
     return 0;
 }
\ No newline at end of file
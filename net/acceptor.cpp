@@ -17,12 +17,13 @@
 using namespace std;
 
 //参数分别为接受器所属服务器对象，所属事件循环（该循环用来处理连接事件），服务器对应的ip,端口号
-Acceptor::Acceptor(TcpServer* server, EventLoop* loop, const char *ip, uint16_t port)
+Acceptor::Acceptor(TcpServer* server, EventLoop* loop, const char *ip, uint16_t port, int loop_index)
     : ac_server(server),
       ac_loop(loop),
       ac_listening(false),
+      ac_loop_index(loop_index),
       ac_idle_fd(open("/dev/null", O_RDONLY | O_CLOEXEC)),
-      ac_listen_fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP))  //用于监听的文件描述符
+      ac_listen_fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP))  //用于监听的文件描述符，非阻塞，do_accept循环accept直到EAGAIN
 {
 LOG_INFO("create one acceptor, listen fd is %d\n", ac_listen_fd);
     assert(ac_listen_fd >= 0);
@@ -33,6 +34,11 @@ LOG_INFO("create one acceptor, listen fd is %d\n", ac_listen_fd);
     if (setsockopt(ac_listen_fd, SOL_SOCKET, SO_REUSEADDR, &op, sizeof(op)) < 0) {
         PR_ERROR("set listen socket SO_REUSEADDR failed!\n");
     }
+    //多个监听套接字绑定同一端口，由内核在它们之间分发新连接
+    if (ac_loop_index >= 0 && setsockopt(ac_listen_fd, SOL_SOCKET, SO_REUSEPORT, &op, sizeof(op)) < 0) {
+        PR_ERROR("set listen socket SO_REUSEPORT failed!\n");
+        exit(1);
+    }
     //服务器地址结构体
     memset(&ac_server_addr, 0, sizeof(ac_server_addr));
     ac_server_addr.sin_family = AF_INET;
@@ -61,8 +67,24 @@ LOG_INFO("acceptor execute listen, listen fd is %d\n", ac_listen_fd);
         exit(1);
     }
     ac_listening = true;
-    //监听文件的读事件的回调函数添加到所属的事件循环  （当监听文件描述符读事件发生，说明此时有连接，应该处理连接）
-    ac_loop->add_to_poller(ac_listen_fd, EPOLLIN, [this](){ this->do_accept(); }); 
+    //poller支持直接accept时（io_uring的multishot accept），由poller返回新连接的fd
+    bool direct_accept = ac_loop->add_acceptor_to_poller(ac_listen_fd, [this](int connfd) {
+        if (connfd < 0) {
+            //文件描述符耗尽时与do_accept一样用空闲fd拒绝一个连接，其他错误poller会稍后重试
+            if (connfd == -EMFILE || connfd == -ENFILE) {
+                this->drop_one_connection();
+            }
+            return;
+        }
+        struct sockaddr_in conn_addr;
+        socklen_t conn_addrlen = sizeof conn_addr;
+        getpeername(connfd, (struct sockaddr*)&conn_addr, &conn_addrlen);
+        this->new_connection(connfd, conn_addr, conn_addrlen);
+    });
+    if (!direct_accept) {
+        //监听文件的读事件的回调函数添加到所属的事件循环  （当监听文件描述符读事件发生，说明此时有连接，应该处理连接）
+        ac_loop->add_to_poller(ac_listen_fd, EPOLLIN, [this](){ this->do_accept(); }); 
+    }
 }
 
 //处理连接
@@ -80,13 +102,13 @@ void Acceptor::do_accept()
             }
             else if (errno == EMFILE) {
                 PR_WARN("accept fail, errno=EMFILE, use idle fd\n");
-                close(ac_idle_fd);
-                ac_idle_fd = accept(ac_listen_fd, NULL, NULL);
-                close(ac_idle_fd);
-                ac_idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                //监听队列已经为空时accept仍然返回EMFILE，此时停止，等待下一次可读事件
+                if (!drop_one_connection()) {
+                    break;
+                }
             }
             else if (errno == EAGAIN) {
-                PR_ERROR("accept fail, errno=EAGAIN, break\n");
+                PR_DEBUG("accept fail, errno=EAGAIN, break\n");
                 break;
             }
             else {
@@ -95,20 +117,38 @@ void Acceptor::do_accept()
             }
         }
         else {
-LOG_INFO("accepted one connection, sock fd is %d\n", connfd);
-            EventLoop* sub_loop = ac_server->get_next_loop(); //从服务器中分配事件循环
-            //给新连接设置回调函数（由所属服务器类决定具体的回调函数）
-            TcpConnSP conn = make_shared<TcpConnection>(ac_server, sub_loop, connfd, conn_addr, conn_addrlen);
-            conn->set_connected_cb(ac_server->ts_connected_cb);
-            conn->set_message_cb(ac_server->ts_message_cb);
-            conn->set_close_cb(ac_server->ts_close_cb);
-            //将该连接 连接建立后的回调函数以及 它的通信文件描述符读事件触发的回调函数添加到所属的事件循环中
-            conn->add_task();
-            
-            //服务器添加连接
-            lock_guard<mutex> lck(ac_server->ts_mutex);
-            ac_server->add_new_tcp_conn(conn);     
+LOG_DEBUG("accepted one connection, sock fd is %d\n", connfd);
+            new_connection(connfd, conn_addr, conn_addrlen);
         }
     }
 }
 
+//文件描述符耗尽时，先关闭空闲fd腾出一个位置，接受一个连接后立即关闭，再重新占住空闲fd
+//否则连接一直留在监听队列中，监听fd一直可读
+//返回是否拒绝了一个连接，监听队列为空时返回false
+bool Acceptor::drop_one_connection()
+{
+    close(ac_idle_fd);
+    int connfd = accept(ac_listen_fd, NULL, NULL);
+    if (connfd >= 0) {
+        close(connfd);
+    }
+    ac_idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return connfd >= 0;
+}
+
+//为新连接创建TcpConnection
+void Acceptor::new_connection(int connfd, struct sockaddr_in& conn_addr, socklen_t conn_addrlen)
+{
+    //SO_REUSEPORT模式下连接留在接受器所属的事件循环，建立连接不需要跨线程；否则从服务器中分配事件循环
+    int loop_index = ac_loop_index >= 0 ? ac_loop_index : ac_server->get_next_loop_index();
+    EventLoop* sub_loop = ac_server->get_loop(loop_index);
+    //给新连接设置回调函数（由所属服务器类决定具体的回调函数）
+    TcpConnSP conn = make_shared<TcpConnection>(ac_server, sub_loop, loop_index, connfd, conn_addr, conn_addrlen);
+    conn->set_connected_cb(ac_server->ts_connected_cb);
+    conn->set_message_cb(ac_server->ts_message_cb);
+    conn->set_close_cb(ac_server->ts_close_cb);
+    //将该连接加入服务器、连接建立后的回调函数以及它的通信文件描述符读事件触发的回调函数添加到所属的事件循环中
+    conn->add_task();
+}
+
@@ -14,12 +14,17 @@ class Acceptor
 {
 public:
     // 构造函数：传入TCP服务器、事件循环、IP地址和端口号
-    Acceptor(TcpServer* server, EventLoop* loop, const char *ip, uint16_t port);
+    // loop_index不小于0时为SO_REUSEPORT模式，loop是下标为loop_index的连接事件循环，多个接受器可以绑定同一端口，
+    // 由内核分发连接，新连接直接交给接受器所属的事件循环处理；小于0时新连接轮询分配给各连接事件循环
+    Acceptor(TcpServer* server, EventLoop* loop, const char *ip, uint16_t port, int loop_index = -1);
     ~Acceptor();  // 析构函数
 
     // 获取是否正在监听
     bool is_listenning() const { return ac_listening; }
 
+    // 获取接受器所属的事件循环
+    EventLoop* get_loop() const { return ac_loop; }
+
     // 开始监听
     void listen();
 
@@ -27,10 +32,17 @@ private:
     // 处理接受连接
     void do_accept();
 
+    // 文件描述符耗尽时用空闲fd接受并关闭一个连接，监听队列为空时返回false
+    bool drop_one_connection();
+
+    // 为新连接创建TcpConnection并交给服务器管理
+    void new_connection(int connfd, struct sockaddr_in& conn_addr, socklen_t conn_addrlen);
+
     TcpServer *ac_server;  // 指向所属的服务器对象
     int ac_listen_fd;  // 监听套接字文件描述符
     EventLoop *ac_loop;  // 指向所属的事件循环对象
     bool ac_listening;  // 监听状态
+    int ac_loop_index;  // SO_REUSEPORT模式下所属连接事件循环的下标，为-1时不使用SO_REUSEPORT
     int ac_idle_fd;  // 空闲套接字文件描述符
     sockaddr_in ac_server_addr;  // 服务器地址信息
 };
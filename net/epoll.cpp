@@ -2,81 +2,81 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "epoll.h"
+#include "loop_timer.h"
 #include "../log/log.h"
 
 using namespace std;
 
 const int EVENTSNUM = 4096;
-const int EPOLLWAIT_TIME = 20000;
 
 Epoll::Epoll() : ep_epoll_fd(epoll_create1(EPOLL_CLOEXEC)), ep_events(EVENTSNUM) {
     assert(ep_epoll_fd > 0);
 }
 
-Epoll::~Epoll() {}
+Epoll::~Epoll() {
+    close(ep_epoll_fd);
+}
 
 //添加事件以及回调函数到epoll
-void Epoll::epoll_add(int fd, int event, const EventCallback& cb) {
-    int final_events;
-    int op;
-
-    auto ret = ep_event_map.find(fd);   //查找判断该事件是已经存在
-    if (ret == ep_event_map.end()) {
-        final_events = event;    
-        op = EPOLL_CTL_ADD;
-    }
-    else {
-        final_events = ret->second.event | event;
-        op = EPOLL_CTL_MOD;
+void Epoll::add_event(int fd, int event, EventCallback&& cb) {
+    if (fd < 0) {
+        PR_ERROR("epoll add invalid fd %d\n", fd);
+        return;
     }
+    io_event &ev = ep_event_table[fd];
+    //该fd还没有注册时添加，已经注册时修改
+    int op = ev.event == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    int final_events = ev.event | event;
     
     //由传入事件类型确定其回调函数
     if (event & EPOLLIN) { 
-        ep_event_map[fd].read_callback = cb;  
+        ev.read_callback = move(cb);
     }
     else if (event & EPOLLOUT) {
-        ep_event_map[fd].write_callback = cb;
+        ev.write_callback = move(cb);
     }
     
-    ep_event_map[fd].event = final_events;
+    ev.event = final_events;
 
-    struct epoll_event ev;
-    ev.events = final_events;
-    ev.data.fd = fd;
+    struct epoll_event epev;
+    epev.events = final_events;
+    epev.data.fd = fd;
     //根据op操作类型对事件结构体进行相应操作
-    if (epoll_ctl(ep_epoll_fd, op, fd, &ev) == -1) {
+    if (epoll_ctl(ep_epoll_fd, op, fd, &epev) == -1) {
         PR_ERROR("epoll ctl error for fd %d\n", fd);
         return;
     }
-LOG_INFO("epoll add, fd is %d, event is %d\n", fd, final_events);
-    ep_listen_fds.insert(fd);
+LOG_DEBUG("epoll add, fd is %d, event is %d\n", fd, final_events);
 }
 
 //从epoll中删除特定事件
-void Epoll::epoll_del(int fd, int event) {
-
-    ep_event_map_iter ret; 
-    ret = ep_event_map.find(fd);
+void Epoll::del_event(int fd, int event) {
+    if (fd < 0) {
+        PR_ERROR("epoll del invalid fd %d\n", fd);
+        return;
+    }
+    io_event *ev = ep_event_table.find(fd);
     //没有该事件
-    if ( ret == ep_event_map.end()) {
+    if (ev == nullptr || ev->event == 0) {
         return ;
     }
 
-    int &target_event = ret->second.event; //获取该文件描述符在epoll中的事件类型
+    int &target_event = ev->event; //获取该文件描述符在epoll中的事件类型
 
     target_event = target_event & (~event);  //更新事件类型
-    if (target_event == 0) {
+    if ((target_event & ~EPOLLET) == 0) {    //只剩下EPOLLET标志位时也没有可监听的事件了
         //如果事件类型变为0,从epoll中删除该事件
-        this->epoll_del(fd);
+        this->del_event(fd);
     }
     else {
         //更新epoll中的事件
-        struct epoll_event ev;
-        ev.events = target_event;
-        ev.data.fd = fd;
-        if (epoll_ctl(ep_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        struct epoll_event epev;
+        epev.events = target_event;
+        epev.data.fd = fd;
+        if (epoll_ctl(ep_epoll_fd, EPOLL_CTL_MOD, fd, &epev) == -1) {
             PR_ERROR("epoll ctl error for fd %d\n", fd);
             return;
         }
@@ -84,20 +84,39 @@ void Epoll::epoll_del(int fd, int event) {
 }
 
 //从epoll中删除特定文件描述符的所有事件
-void Epoll::epoll_del(int fd) {
-
-    ep_event_map.erase(fd);
-
-    ep_listen_fds.erase(fd);
+void Epoll::del_event(int fd) {
+    if (fd < 0) {
+        PR_ERROR("epoll del invalid fd %d\n", fd);
+        return;
+    }
+    io_event *ev = ep_event_table.find(fd);
+    if (ev != nullptr) {
+        ev->event = 0;
+        ev->read_callback = nullptr;
+        ev->write_callback = nullptr;
+    }
 
     epoll_ctl(ep_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
 }
 
+//获取监听文件描述符集合，需要遍历整个表，只用于调试
+void Epoll::get_listen_fds(set<int> &fd_set) {
+    fd_set.clear();
+    for (int fd = 0; fd < ep_event_table.capacity(); fd++) {
+        io_event *ev = ep_event_table.find(fd);
+        if (ev != nullptr && ev->event != 0) {
+            fd_set.insert(fd);
+        }
+    }
+}
+
 //检测事件
-int Epoll::poll() {
+int Epoll::poll(int timeout_ms) {
     while (true) {
         int event_count =
-            epoll_wait(ep_epoll_fd, &*ep_events.begin(), ep_events.size(), EPOLLWAIT_TIME); //其中&*ep_events.begin()是传出参数, 这是结构体容器的地址, 里边存储了已就绪的文件描述符的信息
+            epoll_wait(ep_epoll_fd, &*ep_events.begin(), ep_events.size(), timeout_ms); //其中&*ep_events.begin()是传出参数, 这是结构体容器的地址, 里边存储了已就绪的文件描述符的信息
+        pl_wait_end_ns = monotonic_ns();
+        ep_poll_cnt.fetch_add(1, memory_order_relaxed);
         if (event_count < 0)
         {
             PR_ERROR("epoll wait return val <0! error no:%d, error str:%s\n", errno, strerror(errno));
@@ -112,23 +131,29 @@ int Epoll::poll() {
 //执行回调函数，参数为epoll_wait()的返回值，即检测到的已就绪的文件描述符个数
 inline void Epoll::execute_cbs(int event_count) {
     for (int i = 0; i < event_count; i++) {
-        //通过文件描述符找到哈希表中的迭代器
-        auto ev_ret = ep_event_map.find(ep_events[i].data.fd);
-        assert(ev_ret != ep_event_map.end());
-        
-        //通过迭代器找到就绪文件描述符的i0_event结构体
-        io_event *ev = &(ev_ret->second);
-        //根据检测到的事件类型调用对应的回调函数
-        if (ep_events[i].events & EPOLLIN) {
-LOG_INFO("execute read cb\n");
-            if(ev->read_callback) ev->read_callback();
+        int fd = ep_events[i].data.fd;
+        uint32_t revents = ep_events[i].events;
+        //以fd为下标直接找到就绪文件描述符的io_event结构体，表按页增长，回调中注册新fd不会使该指针失效
+        io_event *ev = ep_event_table.find(fd);
+        if (ev == nullptr || ev->event == 0) {
+            continue;  //同一批就绪事件中，前面的回调已经删除了该fd
         }
-        else if (ep_events[i].events & EPOLLOUT) {
-LOG_INFO("execute write cb\n");
-            if(ev->write_callback) ev->write_callback();
+
+        //根据检测到的事件类型调用对应的回调函数
+        if (revents & (EPOLLIN | EPOLLOUT)) {
+            if (revents & EPOLLIN) {
+LOG_DEBUG("execute read cb\n");
+                if(ev->read_callback) ev->read_callback();
+            }
+            //读写事件同时就绪时也要执行写回调，边沿触发模式下不会再次通知该写事件
+            //读回调可能已经关闭连接并从epoll中删除了该fd，此时写回调已被清空
+            if ((revents & EPOLLOUT) && ev->event != 0) {
+LOG_DEBUG("execute write cb\n");
+                if(ev->write_callback) ev->write_callback();
+            }
         }
         //既有读事件又有写事件
-        else if (ep_events[i].events & (EPOLLHUP|EPOLLERR)) {
+        else if (revents & (EPOLLHUP|EPOLLERR)) {
             if (ev->read_callback) {
                 ev->read_callback();
             }
@@ -136,8 +161,8 @@ LOG_INFO("execute write cb\n");
                 ev->write_callback();
             }
             else {
-                LOG_INFO("get error, delete fd %d from epoll\n", ep_events[i].data.fd);
-                epoll_del(ep_events[i].data.fd);
+                LOG_INFO("get error, delete fd %d from epoll\n", fd);
+                del_event(fd);
             }
         }
     }
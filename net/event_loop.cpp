@@ -5,12 +5,13 @@
 #include <unistd.h>
 
 #include "event_loop.h"
+#include "timing_wheel.h"
 #include "../log/pr.h"
 #include "../log/log.h"
 
 using namespace std;
 
-EventLoop::EventLoop() : el_epoller(new Epoll()) {
+EventLoop::EventLoop(PollerType poller_type) : el_poller(Poller::create(poller_type)) {
     // 创建用于事件通知的文件描述符（非阻塞、执行 exec 时关闭）
     el_evfd = { eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
     if(el_evfd < 0)
@@ -20,18 +21,71 @@ EventLoop::EventLoop() : el_epoller(new Epoll()) {
     }
     LOG_INFO("create one eventloop, event fd is %d\n", el_evfd);
 
-    // 将事件通知文件描述符添加到 Epoll 中
-    el_epoller->epoll_add(el_evfd, EPOLLIN /*| EPOLLET*/, [this](){ this->evfd_read(); });
+    // 将事件通知文件描述符添加到 Poller 中
+    el_poller->add_event(el_evfd, EPOLLIN /*| EPOLLET*/, [this](){ this->evfd_read(); });
+
+    el_timers = make_unique<LoopTimerQueue>(this);
 }
 
 EventLoop::~EventLoop() {
+    //时间轮析构时取消驱动它的定时器，需要在定时器队列和任务队列之前释放
+    el_timing_wheel.reset();
+    el_timers.reset();
     close(el_evfd);
+    //释放没有执行的任务
+    while (MpscNode* node = el_task_queue.pop()) {
+        ObjectCache<TaskNode>::destroy(static_cast<TaskNode*>(node));
+    }
+}
+
+TimerId EventLoop::run_after(int delay_ms, Task&& cb) {
+    return add_timer(static_cast<int64_t>(delay_ms) * 1000000, 0, move(cb));
+}
+
+TimerId EventLoop::run_every(int interval_ms, Task&& cb) {
+    int64_t interval_ns = static_cast<int64_t>(interval_ms > 0 ? interval_ms : 1) * 1000000;
+    return add_timer(interval_ns, interval_ns, move(cb));
+}
+
+//到期时间在调用时计算，转发到事件循环线程的延迟不会推迟定时器
+TimerId EventLoop::add_timer(int64_t delay_ns, int64_t interval_ns, Task&& cb) {
+    TimerId id = el_timers->next_id();
+    int64_t expire_ns = monotonic_ns() + (delay_ns > 0 ? delay_ns : 0);
+    if (is_in_loop_thread()) {
+        el_timers->add(id, expire_ns, interval_ns, move(cb));
+    }
+    else {
+        push_task([this, id, expire_ns, interval_ns, cb = move(cb)]() mutable {
+            el_timers->add(id, expire_ns, interval_ns, move(cb));
+        });
+    }
+    return id;
+}
+
+void EventLoop::cancel(TimerId id) {
+    if (id == 0) {
+        return;
+    }
+    if (is_in_loop_thread()) {
+        el_timers->cancel(id);
+    }
+    else {
+        push_task([this, id]() { el_timers->cancel(id); });
+    }
+}
+
+TimingWheel& EventLoop::get_timing_wheel() {
+    if (!el_timing_wheel) {
+        el_timing_wheel = make_unique<TimingWheel>(this);
+    }
+    return *el_timing_wheel;
 }
 
 // 唤醒事件循环
 void EventLoop::evfd_wakeup()
 {
     uint64_t one = 1;
+    el_metrics.add_wakeup();
     auto n = write(el_evfd, &one, sizeof one);
     if(n != sizeof one)
     {
@@ -53,42 +107,76 @@ void EventLoop::evfd_read()
 // 添加任务到事件循环
 void EventLoop::add_task(Task&& cb)
 {
-    LOG_INFO("eventloop, add one task\n");
+    LOG_DEBUG("eventloop, add one task\n");
     if (is_in_loop_thread())  //如果该函数调用在属于该事件循环的线程中，就直接执行处理
     {
         cb();
     }
     else
     {
-        lock_guard<mutex> lock(el_mutex);
-        el_task_funcs.emplace_back(move(cb));   //添加到待处理任务队列    
+        push_task(move(cb));   //添加到待处理任务队列
+    }
+}
+
+// 将任务加入待处理任务队列，使其在下一轮循环中执行
+void EventLoop::queue_task(Task&& cb)
+{
+    push_task(move(cb));
+}
+
+// 任务入队，只有事件循环阻塞在poll中并且还没有被唤醒过时才写event fd
+// 入队和读取el_sleeping都是seq_cst操作，与loop中先写el_sleeping再检查队列配合，
+// 保证要么这里看到事件循环在睡眠并唤醒它，要么事件循环在睡眠前看到这个任务
+// 事件循环线程自己入队时不需要唤醒，下一次poll前会检查到队列不为空
+void EventLoop::push_task(Task&& cb)
+{
+    el_task_queue.push(ObjectCache<TaskNode>::create(move(cb)));
+    el_metrics.add_task_queued();
+    if (!is_in_loop_thread() && el_sleeping.load(memory_order_seq_cst)
+        && !el_wakeup_pending.exchange(true, memory_order_acq_rel)) {
+        evfd_wakeup();
     }
-    //在添加任务后，如果当前线程不是事件循环线程或者已经有任务在处理唤醒事件循环线程，确保当任务添加完成后，能够及时地通知事件循环进行处理
-    if (!is_in_loop_thread() || el_dealing_task_funcs) { evfd_wakeup(); }
 }
 
 // 开始事件循环
+// 每轮循环分为三段计时：从上一轮结束到等待事件的系统调用返回为等待时间，之后到poll返回为执行回调的时间，
+// 最后是执行待处理任务的时间；每轮读三次单调时钟（vDSO，不进入内核），结果记录在el_metrics中
 void EventLoop::loop() {  //不断的从epoll中获取就绪的事件并处理，同时还会处理待处理的事件
     el_quit = false;
+    int64_t iteration_start = monotonic_ns();
     while (!el_quit) {
-        auto cnt = el_epoller->poll();  //检测epoll中就绪的文件描述符，并执行就绪事件相应的回调函数
-        LOG_INFO("eventloop, tid %lld, loop once, epoll event cnt %d\n", tid_to_ll(this_thread::get_id()), cnt);
-        execute_task_funcs();
+        //先声明将要睡眠再检查任务队列，队列中还有任务时不阻塞
+        el_sleeping.store(true, memory_order_seq_cst);
+        int timeout = el_task_queue.has_pending() ? 0 : POLLER_WAIT_TIME;
+        auto cnt = el_poller->poll(timeout);  //检测poller中就绪的文件描述符，并执行就绪事件相应的回调函数
+        el_sleeping.store(false, memory_order_seq_cst);
+        el_wakeup_pending.store(false, memory_order_release);
+        LOG_DEBUG("eventloop, tid %lld, loop once, epoll event cnt %d\n", tid_to_ll(this_thread::get_id()), cnt);
+        int64_t wait_end = el_poller->get_wait_end_ns();
+        int64_t callback_end = monotonic_ns();
+        uint64_t tasks = execute_task_funcs();
+        int64_t iteration_end = monotonic_ns();
+        el_metrics.record_iteration(wait_end - iteration_start, callback_end - wait_end, iteration_end - callback_end, cnt, tasks);
+        iteration_start = iteration_end;
     }
 }
 
-// 执行待处理任务
-void EventLoop::execute_task_funcs() {
-    std::vector<Task> functors;
-    el_dealing_task_funcs = true;
-
-    {
-        lock_guard<mutex> lock(el_mutex);
-        functors.swap(el_task_funcs); //从待处理任务队列中获取任务
+// 执行待处理任务，只执行开始时已经入队的任务数，执行过程中新加入的任务留到下一轮循环
+// 出队返回nullptr说明有生产者正在入队，剩下的任务留到下一轮，has_pending()为真时下一轮不阻塞
+uint64_t EventLoop::execute_task_funcs() {
+    size_t pending = el_task_queue.size();
+    uint64_t executed = 0;
+    while (executed < pending) {
+        MpscNode* node = el_task_queue.pop();
+        if (node == nullptr) {
+            break;
+        }
+        TaskNode* task_node = static_cast<TaskNode*>(node);
+        task_node->task(); //执行任务
+        ObjectCache<TaskNode>::destroy(task_node);
+        executed++;
     }
-
-    for (size_t i = 0; i < functors.size(); ++i) functors[i](); //执行任务
-    el_dealing_task_funcs = false;
+    return executed;
 }
 
 // 退出事件循环
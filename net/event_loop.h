@@ -3,58 +3,107 @@
 
 #include <functional>
 #include <memory>
-#include <vector>
-#include <mutex>
+#include <atomic>
 #include <thread>
 #include <sys/eventfd.h>
 
-#include "epoll.h"
+#include "poller.h"
+#include "mpsc_queue.h"
+#include "object_cache.h"
+#include "loop_timer.h"
+#include "loop_metrics.h"
 
 using namespace std;
 
+class TimingWheel;
+
 class EventLoop {
 public:
-    typedef std::function<void()> Task;
+    typedef InlineTask Task;  // 只能移动的任务类型，捕获不超过INLINE_TASK_CAPACITY字节的任务入队时不分配内存
 
-    EventLoop();
+    explicit EventLoop(PollerType poller_type = PollerType::Epoll);
 
     ~EventLoop();
 
     void loop();
     void quit();
 
+    // 在事件循环线程中调用时立即执行，否则加入待处理任务队列
+    // 任务队列是无锁的，只有事件循环阻塞在poll中时才写event fd唤醒
     void add_task(Task&& cb);
 
-    void add_to_poller(int fd, int event, const Epoll::EventCallback& cb) {
-        el_epoller->epoll_add(fd, event, cb);
+    // 总是将任务加入待处理任务队列，在下一轮循环中执行（即使在事件循环线程中调用也不会立即执行）
+    void queue_task(Task&& cb);
+
+    void add_to_poller(int fd, int event, Poller::EventCallback&& cb) {
+        el_poller->add_event(fd, event, move(cb));
     }
 
     void del_from_poller(int fd, int event) {
-        el_epoller->epoll_del(fd, event);
+        el_poller->del_event(fd, event);
     }
 
     void del_from_poller(int fd) {
-        el_epoller->epoll_del(fd);
+        el_poller->del_event(fd);
+    }
+
+    // 由poller直接完成监听fd上的accept，poller不支持时返回false
+    bool add_acceptor_to_poller(int listen_fd, Poller::AcceptCallback&& cb) {
+        return el_poller->add_acceptor(listen_fd, move(cb));
     }
 
+    uint64_t get_poll_cnt() const { return el_poller->get_poll_cnt(); }  // 获取等待事件的系统调用次数
+
+    const char* get_poller_name() const { return el_poller->name(); }  // 获取实际使用的poller后端名称
+
+    // 获取事件循环的运行指标（等待/回调/任务耗时、每次唤醒的事件数、任务队列深度等），可以在任意线程中调用，不停止事件循环
+    void get_metrics(LoopMetricsSnapshot& out) const { el_metrics.snapshot(out); }
+
+    // 获取等待中的定时器个数，可以在任意线程中调用
+    size_t get_timer_num() const { return el_timers->get_pending_num(); }
+
+    // delay_ms毫秒后在事件循环线程中执行一次cb，返回定时器id，可以在任意线程中调用
+    TimerId run_after(int delay_ms, Task&& cb);
+
+    // 每隔interval_ms毫秒在事件循环线程中执行一次cb，直到被取消，可以在任意线程中调用
+    TimerId run_every(int interval_ms, Task&& cb);
+
+    // 取消定时器，可以在任意线程中调用，在事件循环线程中调用时立即生效（包括在定时器自己的回调函数中）
+    void cancel(TimerId id);
+
+    // 获取事件循环的时间轮，第一次调用时创建，只能在事件循环线程中调用
+    TimingWheel& get_timing_wheel();
+
     // 判断当前线程是否是事件循环的线程
     bool is_in_loop_thread() const { return el_tid == this_thread::get_id(); }
     
 
 private:
-    shared_ptr<Epoll> el_epoller;  // Epoll 实例，用于事件管理
+    shared_ptr<Poller> el_poller;  // Poller 实例(epoll或io_uring)，用于事件管理
+    unique_ptr<LoopTimerQueue> el_timers;  // 由timerfd驱动的定时器队列，需要在poller之前、时间轮之后析构
+    unique_ptr<TimingWheel> el_timing_wheel;  // 时间轮，用于连接的空闲超时，需要在poller之前析构
     bool el_quit{ false };  // 事件循环是否退出标志
 
     const thread::id el_tid{ this_thread::get_id() };  // 事件循环所在线程的 ID
-    mutex el_mutex;  // 事件循环的互斥锁
+
+    // 任务队列中的节点，由ObjectCache回收复用，稳定状态下入队不分配内存
+    struct TaskNode : public MpscNode
+    {
+        explicit TaskNode(Task&& cb) : task(move(cb)) {}
+        Task task;
+    };
 
     int el_evfd;  // 用于事件唤醒的文件描述符
-    std::vector<Task> el_task_funcs;  // 待执行的任务列表，该任务队列可以用于对epoll实例中的文件描述符进行操作
-    bool el_dealing_task_funcs{ false };  // 任务处理中标志
+    MpscQueue el_task_queue;  // 待执行的任务队列，该任务队列可以用于对poller中的文件描述符进行操作
+    atomic<bool> el_sleeping{ false };  // 事件循环是否（即将）阻塞在poll中
+    atomic<bool> el_wakeup_pending{ false };  // 是否已经写过event fd且事件循环还没有醒来，用于合并唤醒
+    LoopMetrics el_metrics;  // 事件循环的运行指标
 
+    void push_task(Task&& cb);  // 任务入队，必要时唤醒事件循环
+    TimerId add_timer(int64_t delay_ns, int64_t interval_ns, Task&& cb);  // 加入定时器，不在事件循环线程中时转发到事件循环线程
     void evfd_wakeup();  // 唤醒事件循环
     void evfd_read();  // 读取事件循环的事件
-    void execute_task_funcs();  // 执行待处理任务
+    uint64_t execute_task_funcs();  // 执行待处理任务，返回执行的任务数
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef __FD_TABLE_H__
+#define __FD_TABLE_H__
+
+#include <memory>
+#include <vector>
+#include <assert.h>
+
+using namespace std;
+
+// 以文件描述符为下标的分页表
+// fd是从小到大分配的稠密整数，用下标直接定位元素，查找时没有哈希计算，插入时也没有节点分配
+// 按页增长，扩容时只移动页指针数组，已有元素的地址保持不变，
+// 因此在回调函数执行期间注册新的fd不会让正在执行的回调对象失效
+template <typename T, int PAGE_BITS = 10>
+class FdTable
+{
+public:
+    static const int PAGE_SIZE = 1 << PAGE_BITS;  // 每页的元素个数
+
+    // 查找fd对应的元素，所在页还没有分配时返回nullptr，不会分配内存
+    T* find(int fd)
+    {
+        assert(fd >= 0);
+        size_t page = static_cast<size_t>(fd) >> PAGE_BITS;
+        if (page >= ft_pages.size() || !ft_pages[page]) {
+            return nullptr;
+        }
+        return &ft_pages[page][fd & (PAGE_SIZE - 1)];
+    }
+
+    // 获取fd对应的元素，所在页还没有分配时分配该页
+    T& operator[](int fd)
+    {
+        assert(fd >= 0);
+        size_t page = static_cast<size_t>(fd) >> PAGE_BITS;
+        if (page >= ft_pages.size()) {
+            ft_pages.resize(page + 1);
+        }
+        if (!ft_pages[page]) {
+            ft_pages[page].reset(new T[PAGE_SIZE]());
+        }
+        return ft_pages[page][fd & (PAGE_SIZE - 1)];
+    }
+
+    // 当前表能容纳的fd上限（不包含）
+    int capacity() const { return static_cast<int>(ft_pages.size()) << PAGE_BITS; }
+
+private:
+    vector<unique_ptr<T[]>> ft_pages;  // 页指针数组
+};
+
+#endif
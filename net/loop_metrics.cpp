@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <math.h>
+
+#include "loop_metrics.h"
+
+uint64_t MetricHistogramSnapshot::bucket_upper(int index)
+{
+    if (index < METRIC_SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    int exp = index / METRIC_SUB_BUCKETS + METRIC_SUB_BUCKET_BITS - 1;
+    uint64_t sub = static_cast<uint64_t>(index % METRIC_SUB_BUCKETS) + METRIC_SUB_BUCKETS;
+    uint64_t width = uint64_t(1) << (exp - METRIC_SUB_BUCKET_BITS);
+    return (sub << (exp - METRIC_SUB_BUCKET_BITS)) + width - 1;
+}
+
+uint64_t MetricHistogramSnapshot::percentile(double p) const
+{
+    //快照中各个桶不是同一时刻的值，按桶计数之和计算，不使用hs_count
+    uint64_t total = 0;
+    for (uint64_t n : hs_buckets) {
+        total += n;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    p = min(max(p, 0.0), 100.0);
+    uint64_t target = max<uint64_t>(static_cast<uint64_t>(ceil(p / 100.0 * total)), 1);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        cumulative += hs_buckets[i];
+        if (cumulative >= target) {
+            return min(bucket_upper(i), hs_max);
+        }
+    }
+    return hs_max;
+}
+
+void MetricHistogramSnapshot::merge(const MetricHistogramSnapshot& other)
+{
+    hs_count += other.hs_count;
+    hs_sum += other.hs_sum;
+    hs_max = max(hs_max, other.hs_max);
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        hs_buckets[i] += other.hs_buckets[i];
+    }
+}
+
+void MetricHistogram::snapshot(MetricHistogramSnapshot& out) const
+{
+    out.hs_count = mh_count.load(memory_order_relaxed);
+    out.hs_sum = mh_sum.load(memory_order_relaxed);
+    out.hs_max = mh_max.load(memory_order_relaxed);
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        out.hs_buckets[i] = mh_buckets[i].load(memory_order_relaxed);
+    }
+}
+
+void LoopMetrics::record_iteration(int64_t wait_ns, int64_t callback_ns, int64_t task_ns, int events, uint64_t tasks)
+{
+    //时钟读数来自同一个单调时钟，差值不会为负，这里只是防御
+    uint64_t wait = wait_ns > 0 ? wait_ns : 0;
+    uint64_t callback = callback_ns > 0 ? callback_ns : 0;
+    uint64_t task = task_ns > 0 ? task_ns : 0;
+
+    metric_add(lm_iterations, 1);
+    metric_add(lm_events, events > 0 ? events : 0);
+    metric_add(lm_tasks, tasks);
+    metric_add(lm_wait_ns, wait);
+    metric_add(lm_busy_ns, callback + task);
+
+    lm_wait_hist.record(wait);
+    lm_callback_hist.record(callback);
+    lm_iteration_hist.record(callback + task);
+    lm_events_hist.record(events > 0 ? events : 0);
+    if (tasks > 0) {
+        lm_task_hist.record(task);
+        lm_depth_hist.record(tasks);
+    }
+}
+
+void LoopMetrics::snapshot(LoopMetricsSnapshot& out) const
+{
+    //各计数分别读取，入队数可能暂时小于执行数，pending_tasks()按0处理
+    out.ls_iterations = lm_iterations.load(memory_order_relaxed);
+    out.ls_events = lm_events.load(memory_order_relaxed);
+    out.ls_tasks = lm_tasks.load(memory_order_relaxed);
+    out.ls_tasks_queued = lm_tasks_queued.load(memory_order_relaxed);
+    out.ls_wakeups = lm_wakeups.load(memory_order_relaxed);
+    out.ls_wait_ns = lm_wait_ns.load(memory_order_relaxed);
+    out.ls_busy_ns = lm_busy_ns.load(memory_order_relaxed);
+    lm_wait_hist.snapshot(out.ls_wait_hist);
+    lm_callback_hist.snapshot(out.ls_callback_hist);
+    lm_task_hist.snapshot(out.ls_task_hist);
+    lm_iteration_hist.snapshot(out.ls_iteration_hist);
+    lm_events_hist.snapshot(out.ls_events_hist);
+    lm_depth_hist.snapshot(out.ls_depth_hist);
+}
+
+void LoopMetricsSnapshot::merge(const LoopMetricsSnapshot& other)
+{
+    ls_iterations += other.ls_iterations;
+    ls_events += other.ls_events;
+    ls_tasks += other.ls_tasks;
+    ls_tasks_queued += other.ls_tasks_queued;
+    ls_wakeups += other.ls_wakeups;
+    ls_wait_ns += other.ls_wait_ns;
+    ls_busy_ns += other.ls_busy_ns;
+    ls_wait_hist.merge(other.ls_wait_hist);
+    ls_callback_hist.merge(other.ls_callback_hist);
+    ls_task_hist.merge(other.ls_task_hist);
+    ls_iteration_hist.merge(other.ls_iteration_hist);
+    ls_events_hist.merge(other.ls_events_hist);
+    ls_depth_hist.merge(other.ls_depth_hist);
+}
+
+void LoopMetricsSnapshot::print(FILE* out) const
+{
+    fprintf(out, "iterations %llu, events %llu, tasks %llu (pending %llu), wakeups %llu, busy %.1f%%\n",
+            (unsigned long long)ls_iterations, (unsigned long long)ls_events, (unsigned long long)ls_tasks,
+            (unsigned long long)pending_tasks(), (unsigned long long)ls_wakeups, busy_ratio() * 100);
+
+    struct Row {
+        const char *name;
+        const MetricHistogramSnapshot *hist;
+        double scale;
+    };
+    const Row rows[] = {
+        { "wait(us)", &ls_wait_hist, 1000.0 },
+        { "callback(us)", &ls_callback_hist, 1000.0 },
+        { "task(us)", &ls_task_hist, 1000.0 },
+        { "iteration(us)", &ls_iteration_hist, 1000.0 },
+        { "events/wakeup", &ls_events_hist, 1.0 },
+        { "task depth", &ls_depth_hist, 1.0 },
+    };
+    for (const Row& row : rows) {
+        fprintf(out, "  %-14s mean %10.1f  p50 %10.1f  p99 %10.1f  max %10.1f\n", row.name,
+                row.hist->mean() / row.scale, row.hist->percentile(50) / row.scale,
+                row.hist->percentile(99) / row.scale, row.hist->hs_max / row.scale);
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef __LOOP_METRICS_H__
+#define __LOOP_METRICS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+using namespace std;
+
+const int METRIC_SUB_BUCKET_BITS = 2;  // 每个2的幂区间再等分为4个子桶，相对误差不超过25%
+const int METRIC_SUB_BUCKETS = 1 << METRIC_SUB_BUCKET_BITS;
+const int METRIC_BUCKETS = (64 - METRIC_SUB_BUCKET_BITS + 1) * METRIC_SUB_BUCKETS;  // 覆盖全部64位无符号整数
+
+// 单写者计数累加：只有一个线程写入时用relaxed的load+store代替fetch_add，没有带lock前缀的原子指令，其他线程读到的总是完整的值
+inline void metric_add(atomic<uint64_t>& counter, uint64_t n)
+{
+    counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// 直方图某一时刻的快照，普通整数，可以随意复制和合并
+struct MetricHistogramSnapshot {
+    uint64_t hs_count{ 0 };  // 记录的次数
+    uint64_t hs_sum{ 0 };  // 记录的值之和
+    uint64_t hs_max{ 0 };  // 记录的最大值
+    uint64_t hs_buckets[METRIC_BUCKETS]{};  // 每个桶的计数
+
+    double mean() const { return hs_count ? static_cast<double>(hs_sum) / hs_count : 0; }
+    uint64_t percentile(double p) const;  // 百分位数（0~100）所在桶的上界，不超过最大值
+    void merge(const MetricHistogramSnapshot& other);
+
+    static uint64_t bucket_upper(int index);  // 桶能表示的最大值
+};
+
+/*
+   单写者原子直方图：按2的幂分段、每段4个子桶（log-linear）
+   * 只由一个线程（所属事件循环）记录，计数用relaxed的load+store更新，没有带lock前缀的原子指令
+   * 任意线程可以随时读取快照，不需要停止事件循环；快照中不同桶之间不是同一时刻的值，但每个计数都是完整的
+*/
+class MetricHistogram
+{
+public:
+    void record(uint64_t value)
+    {
+        metric_add(mh_buckets[bucket_index(value)], 1);
+        metric_add(mh_count, 1);
+        metric_add(mh_sum, value);
+        if (value > mh_max.load(memory_order_relaxed)) {
+            mh_max.store(value, memory_order_relaxed);
+        }
+    }
+
+    void snapshot(MetricHistogramSnapshot& out) const;  // 可以在任意线程中调用
+
+    static int bucket_index(uint64_t value)
+    {
+        if (value < METRIC_SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        int exp = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>(value >> (exp - METRIC_SUB_BUCKET_BITS)) & (METRIC_SUB_BUCKETS - 1);
+        return (exp - METRIC_SUB_BUCKET_BITS + 1) * METRIC_SUB_BUCKETS + sub;
+    }
+
+private:
+    atomic<uint64_t> mh_count{ 0 };
+    atomic<uint64_t> mh_sum{ 0 };
+    atomic<uint64_t> mh_max{ 0 };
+    atomic<uint64_t> mh_buckets[METRIC_BUCKETS]{};
+};
+
+// 事件循环指标的快照
+struct LoopMetricsSnapshot {
+    uint64_t ls_iterations{ 0 };  // 循环次数
+    uint64_t ls_events{ 0 };  // 处理的就绪事件总数
+    uint64_t ls_tasks{ 0 };  // 执行的任务总数
+    uint64_t ls_tasks_queued{ 0 };  // 加入任务队列的任务总数
+    uint64_t ls_wakeups{ 0 };  // 写event fd唤醒事件循环的次数
+    uint64_t ls_wait_ns{ 0 };  // 阻塞在poll中的总时间
+    uint64_t ls_busy_ns{ 0 };  // 执行回调和任务的总时间
+
+    MetricHistogramSnapshot ls_wait_hist;  // 每次poll的等待时间(ns)
+    MetricHistogramSnapshot ls_callback_hist;  // 每轮执行就绪事件回调的时间(ns)
+    MetricHistogramSnapshot ls_task_hist;  // 每轮执行待处理任务的时间(ns)
+    MetricHistogramSnapshot ls_iteration_hist;  // 每轮的处理时间(ns)，即回调和任务时间之和，不包括等待
+    MetricHistogramSnapshot ls_events_hist;  // 每次唤醒的就绪事件数
+    MetricHistogramSnapshot ls_depth_hist;  // 每轮开始执行任务时队列中的任务数
+
+    uint64_t pending_tasks() const { return ls_tasks_queued > ls_tasks ? ls_tasks_queued - ls_tasks : 0; }  // 还没有执行的任务数
+    double busy_ratio() const  // 处理时间占总时间的比例，接近1说明该事件循环已经饱和
+    {
+        uint64_t total = ls_wait_ns + ls_busy_ns;
+        return total ? static_cast<double>(ls_busy_ns) / total : 0;
+    }
+
+    void merge(const LoopMetricsSnapshot& other);
+    void print(FILE* out) const;  // 输出计数和各直方图的p50/p99/最大值
+};
+
+/*
+   事件循环的运行指标，每个事件循环一个：
+   * 除了任务入队计数和唤醒次数（由投递任务的线程原子累加），其余都只由事件循环线程写入
+   * 任意线程可以通过snapshot读取，不加锁、不停止事件循环
+*/
+class LoopMetrics
+{
+public:
+    // 记录一轮循环，wait/callback/task为三个阶段的耗时，events为就绪事件数，tasks为执行的任务数
+    void record_iteration(int64_t wait_ns, int64_t callback_ns, int64_t task_ns, int events, uint64_t tasks);
+
+    void add_task_queued() { lm_tasks_queued.fetch_add(1, memory_order_relaxed); }  // 任意线程
+    void add_wakeup() { lm_wakeups.fetch_add(1, memory_order_relaxed); }  // 任意线程
+
+    void snapshot(LoopMetricsSnapshot& out) const;  // 可以在任意线程中调用
+
+private:
+    //由其他线程累加的计数单独占一个缓存行，不与事件循环线程频繁写的计数共享
+    alignas(64) atomic<uint64_t> lm_tasks_queued{ 0 };
+    atomic<uint64_t> lm_wakeups{ 0 };
+
+    alignas(64) atomic<uint64_t> lm_iterations{ 0 };
+    atomic<uint64_t> lm_events{ 0 };
+    atomic<uint64_t> lm_tasks{ 0 };
+    atomic<uint64_t> lm_wait_ns{ 0 };
+    atomic<uint64_t> lm_busy_ns{ 0 };
+
+    MetricHistogram lm_wait_hist;
+    MetricHistogram lm_callback_hist;
+    MetricHistogram lm_task_hist;
+    MetricHistogram lm_iteration_hist;
+    MetricHistogram lm_events_hist;
+    MetricHistogram lm_depth_hist;
+};
+
+#endif
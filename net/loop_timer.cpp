@@ -0,0 +1,156 @@
+#include <sys/timerfd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+
+#include "loop_timer.h"
+#include "event_loop.h"
+#include "../log/pr.h"
+#include "../log/log.h"
+
+using namespace std;
+
+int64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+LoopTimerQueue::LoopTimerQueue(EventLoop* loop)
+    : tq_loop(loop),
+      tq_timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+{
+    if (tq_timer_fd < 0) {
+        PR_ERROR("fail to create timer_fd, error no:%d, error str:%s\n", errno, strerror(errno));
+        exit(1);
+    }
+    tq_loop->add_to_poller(tq_timer_fd, EPOLLIN, [this](){ this->handle_read(); });
+    LOG_INFO("create one loop timer queue, timer fd is %d\n", tq_timer_fd);
+}
+
+LoopTimerQueue::~LoopTimerQueue()
+{
+    tq_loop->del_from_poller(tq_timer_fd);
+    close(tq_timer_fd);
+}
+
+void LoopTimerQueue::add(TimerId id, int64_t expire_ns, int64_t interval_ns, TimerCallback&& cb)
+{
+    LoopTimer& timer = tq_timers[id];
+    timer.lt_expire_ns = expire_ns;
+    timer.lt_interval_ns = interval_ns > 0 ? interval_ns : 0;
+    timer.lt_callback = move(cb);
+    tq_pending_num.store(tq_timers.size(), memory_order_relaxed);
+    push_entry(expire_ns, id);
+    if (tq_armed_ns == 0 || expire_ns < tq_armed_ns) {
+        reset_timerfd();
+    }
+}
+
+void LoopTimerQueue::cancel(TimerId id)
+{
+    if (tq_timers.erase(id) == 0) {
+        return;
+    }
+    tq_pending_num.store(tq_timers.size(), memory_order_relaxed);
+    //堆顶不会因为取消而提前，timerfd到期时再跳过过期条目；过期条目超过一半时重建堆
+    if (tq_heap.size() > 64 && tq_heap.size() > 2 * tq_timers.size()) {
+        compact();
+    }
+}
+
+void LoopTimerQueue::push_entry(int64_t expire_ns, TimerId id)
+{
+    tq_heap.push_back(HeapEntry{ expire_ns, id });
+    push_heap(tq_heap.begin(), tq_heap.end(), greater<HeapEntry>());
+}
+
+void LoopTimerQueue::pop_entry()
+{
+    pop_heap(tq_heap.begin(), tq_heap.end(), greater<HeapEntry>());
+    tq_heap.pop_back();
+}
+
+bool LoopTimerQueue::is_stale(const HeapEntry& entry) const
+{
+    auto it = tq_timers.find(entry.he_id);
+    return it == tq_timers.end() || it->second.lt_expire_ns != entry.he_expire_ns;
+}
+
+void LoopTimerQueue::compact()
+{
+    tq_heap.erase(remove_if(tq_heap.begin(), tq_heap.end(),
+                            [this](const HeapEntry& entry) { return is_stale(entry); }),
+                  tq_heap.end());
+    make_heap(tq_heap.begin(), tq_heap.end(), greater<HeapEntry>());
+}
+
+void LoopTimerQueue::handle_read()
+{
+    uint64_t expirations = 0;
+    if (read(tq_timer_fd, &expirations, sizeof expirations) != sizeof expirations && errno != EAGAIN) {
+        PR_ERROR("read timer_fd error, error no:%d, error str:%s\n", errno, strerror(errno));
+    }
+    tq_armed_ns = 0;
+
+    int64_t now = monotonic_ns();
+    while (!tq_heap.empty() && tq_heap.front().he_expire_ns <= now) {
+        HeapEntry entry = tq_heap.front();
+        pop_entry();
+        auto it = tq_timers.find(entry.he_id);
+        if (it == tq_timers.end() || it->second.lt_expire_ns != entry.he_expire_ns) {
+            continue;  //已经取消或者重新设置过的过期条目
+        }
+
+        LoopTimer& timer = it->second;
+        if (timer.lt_interval_ns == 0) {
+            //只执行一次的定时器先删除再执行，回调函数中可以加入新的定时器
+            TimerCallback cb = move(timer.lt_callback);
+            tq_timers.erase(it);
+            tq_pending_num.store(tq_timers.size(), memory_order_relaxed);
+            cb();
+            continue;
+        }
+
+        //周期定时器：回调函数移出后执行，回调中取消自己时不再放回
+        TimerCallback cb = move(timer.lt_callback);
+        int64_t next_expire = timer.lt_expire_ns + timer.lt_interval_ns;
+        cb();
+        it = tq_timers.find(entry.he_id);  //回调中加入定时器可能让哈希表重新分配
+        if (it != tq_timers.end()) {
+            it->second.lt_callback = move(cb);
+            it->second.lt_expire_ns = next_expire;
+            push_entry(next_expire, entry.he_id);
+        }
+    }
+    reset_timerfd();
+}
+
+void LoopTimerQueue::reset_timerfd()
+{
+    //跳过堆顶的过期条目，避免为已经取消的定时器唤醒
+    while (!tq_heap.empty() && is_stale(tq_heap.front())) {
+        pop_entry();
+    }
+    int64_t expire_ns = tq_heap.empty() ? 0 : tq_heap.front().he_expire_ns;
+    if (expire_ns == tq_armed_ns) {
+        return;
+    }
+    struct itimerspec its;
+    memset(&its, 0, sizeof its);
+    if (expire_ns > 0) {
+        //绝对时间，已经过去的时间点会立即到期
+        its.it_value.tv_sec = expire_ns / 1000000000LL;
+        its.it_value.tv_nsec = expire_ns % 1000000000LL;
+    }
+    if (timerfd_settime(tq_timer_fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0) {
+        PR_ERROR("timerfd_settime error, error no:%d, error str:%s\n", errno, strerror(errno));
+        return;
+    }
+    tq_armed_ns = expire_ns;
+}
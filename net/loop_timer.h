@@ -0,0 +1,84 @@
+#ifndef __LOOP_TIMER_H__
+#define __LOOP_TIMER_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "../threadpool/inline_task.h"
+
+using namespace std;
+
+class EventLoop;
+
+typedef uint64_t TimerId;  // 定时器id，0表示无效
+typedef InlineTask TimerCallback;  // 定时器回调函数类型
+
+// 获取CLOCK_MONOTONIC时间(ns)，与timerfd使用同一个时钟
+int64_t monotonic_ns();
+
+// 每个事件循环一个的定时器队列，由一个注册在poller中的timerfd驱动，回调函数在事件循环线程中执行
+// * 定时器按到期时间放在最小堆中，timerfd使用绝对时间设置为堆顶的到期时间，只有堆顶变化时才重新设置
+// * 取消时立即删除定时器并释放回调函数，堆中留下的过期条目在出堆时跳过，过期条目过多时重建堆
+// * 周期定时器按固定间隔计算下一次到期时间，事件循环繁忙错过的周期会依次补上
+// * 除了分配id之外只能在事件循环线程中调用
+class LoopTimerQueue
+{
+public:
+    explicit LoopTimerQueue(EventLoop* loop);
+
+    ~LoopTimerQueue();
+
+    LoopTimerQueue(const LoopTimerQueue&) = delete;
+    LoopTimerQueue& operator=(const LoopTimerQueue&) = delete;
+
+    // 分配定时器id，可以在任意线程中调用
+    TimerId next_id() { return tq_next_id.fetch_add(1, memory_order_relaxed); }
+
+    // 加入定时器，expire_ns为CLOCK_MONOTONIC的到期时间，interval_ns大于0时为周期定时器
+    void add(TimerId id, int64_t expire_ns, int64_t interval_ns, TimerCallback&& cb);
+
+    // 取消定时器，可以在定时器自己的回调函数中调用，定时器已经到期或者不存在时什么也不做
+    void cancel(TimerId id);
+
+    size_t size() const { return tq_timers.size(); }  // 等待中的定时器个数
+
+    size_t get_pending_num() const { return tq_pending_num.load(memory_order_relaxed); }  // 等待中的定时器个数，可跨线程读取
+
+private:
+    struct LoopTimer
+    {
+        int64_t lt_expire_ns;  // 到期时间
+        int64_t lt_interval_ns;  // 周期，0表示只执行一次
+        TimerCallback lt_callback;  // 回调函数，执行期间移出，执行完再放回
+    };
+
+    // 堆中的条目，与定时器当前的到期时间不一致或者定时器已经取消时为过期条目
+    struct HeapEntry
+    {
+        int64_t he_expire_ns;
+        TimerId he_id;
+        bool operator>(const HeapEntry& b) const
+        {
+            return he_expire_ns != b.he_expire_ns ? he_expire_ns > b.he_expire_ns : he_id > b.he_id;
+        }
+    };
+
+    void push_entry(int64_t expire_ns, TimerId id);  // 条目入堆
+    void pop_entry();  // 堆顶条目出堆
+    bool is_stale(const HeapEntry& entry) const;  // 是否为过期条目
+    void compact();  // 删除堆中所有过期条目
+    void handle_read();  // timerfd可读，执行到期的定时器
+    void reset_timerfd();  // 按堆顶的到期时间重新设置timerfd
+
+    EventLoop *tq_loop;  // 所属的事件循环
+    int tq_timer_fd;  // 驱动定时器的timerfd
+    int64_t tq_armed_ns{ 0 };  // timerfd当前设置的到期时间，0表示没有设置
+    atomic<TimerId> tq_next_id{ 1 };  // 下一个定时器id
+    unordered_map<TimerId, LoopTimer> tq_timers;  // 等待中的定时器
+    vector<HeapEntry> tq_heap;  // 按到期时间排列的最小堆
+    atomic<size_t> tq_pending_num{ 0 };  // tq_timers.size()的副本，只由事件循环线程写入，用于跨线程读取
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "metrics_exporter.h"
+#include "event_loop.h"
+#include "../log/pr.h"
+#include "../log/log.h"
+
+using namespace std;
+
+void MetricsText::header(const char* name, const char* type, const char* help)
+{
+    mt_buf += "# HELP ";
+    mt_buf += name;
+    mt_buf += ' ';
+    mt_buf += help;
+    mt_buf += "\n# TYPE ";
+    mt_buf += name;
+    mt_buf += ' ';
+    mt_buf += type;
+    mt_buf += '\n';
+}
+
+void MetricsText::append_name(const char* name, const char* labels)
+{
+    mt_buf += name;
+    if (labels != nullptr && labels[0] != '\0') {
+        mt_buf += '{';
+        mt_buf += labels;
+        mt_buf += '}';
+    }
+    mt_buf += ' ';
+}
+
+void MetricsText::sample(const char* name, const char* labels, uint64_t value)
+{
+    char num[32];
+    append_name(name, labels);
+    int n = snprintf(num, sizeof num, "%llu\n", (unsigned long long)value);
+    mt_buf.append(num, n);
+}
+
+void MetricsText::sample(const char* name, const char* labels, double value)
+{
+    char num[32];
+    append_name(name, labels);
+    int n = snprintf(num, sizeof num, "%.9g\n", value);
+    mt_buf.append(num, n);
+}
+
+MetricsExporter::MetricsExporter(EventLoop* loop, const char* ip, uint16_t port)
+    : me_loop(loop),
+      me_listen_fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP))
+{
+    if (me_listen_fd < 0) {
+        PR_ERROR("create metrics listen socket error, error str:%s\n", strerror(errno));
+        exit(1);
+    }
+    int op = 1;
+    if (setsockopt(me_listen_fd, SOL_SOCKET, SO_REUSEADDR, &op, sizeof(op)) < 0) {
+        PR_ERROR("set metrics socket SO_REUSEADDR failed!\n");
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    inet_aton(ip, &addr.sin_addr);
+    addr.sin_port = htons(port);
+LOG_INFO("metrics exporter bind, ip is %s, port is %d\n", ip, (int)port);
+    if (::bind(me_listen_fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        PR_ERROR("bind metrics port %d error!\n", (int)port);
+        exit(1);
+    }
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    for (auto& kv : me_clients) {
+        close(kv.first);
+    }
+    close(me_listen_fd);
+}
+
+void MetricsExporter::listen()
+{
+    if (::listen(me_listen_fd, 64) == -1) {
+        PR_ERROR("metrics listen error\n");
+        exit(1);
+    }
+    me_loop->add_to_poller(me_listen_fd, EPOLLIN, [this]() { this->do_accept(); });
+}
+
+void MetricsExporter::do_accept()
+{
+    while (true) {
+        int fd = accept4(me_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                PR_ERROR("metrics accept fail, error no:%d, error str:%s\n", errno, strerror(errno));
+            }
+            return;
+        }
+        me_clients[fd] = Client();
+        me_loop->add_to_poller(fd, EPOLLIN, [this, fd]() { this->do_read(fd); });
+    }
+}
+
+void MetricsExporter::do_read(int fd)
+{
+    auto it = me_clients.find(fd);
+    if (it == me_clients.end() || it->second.c_closing) {
+        return;
+    }
+    Client& client = it->second;
+    if (!client.c_out.empty()) {
+        //响应已经生成，忽略后续数据，只检查对端是否关闭
+        char discard[256];
+        ssize_t n = recv(fd, discard, sizeof discard, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close_client(fd);
+        }
+        return;
+    }
+
+    char buf[1024];
+    ssize_t n = recv(fd, buf, sizeof buf, 0);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            close_client(fd);
+        }
+        return;
+    }
+    if (n == 0) {
+        close_client(fd);
+        return;
+    }
+    client.c_in.append(buf, n);
+    if (client.c_in.find("\r\n\r\n") == string::npos) {
+        if (client.c_in.size() > METRICS_MAX_REQUEST) {
+            close_client(fd);
+        }
+        return;
+    }
+    respond(client);
+    do_write(fd);
+}
+
+void MetricsExporter::respond(Client& client)
+{
+    const char* status = "200 OK";
+    me_text.clear();
+    if (client.c_in.compare(0, 4, "GET ") == 0) {
+        for (auto& cb : me_collectors) {
+            cb(me_text);
+        }
+        me_scrape_cnt.fetch_add(1, memory_order_relaxed);
+    }
+    else {
+        status = "405 Method Not Allowed";
+    }
+
+    char head[160];
+    int n = snprintf(head, sizeof head,
+                     "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n"
+                     "Connection: close\r\n\r\n",
+                     status, me_text.str().size());
+    client.c_out.reserve(n + me_text.str().size());
+    client.c_out.assign(head, n);
+    client.c_out += me_text.str();
+    client.c_sent = 0;
+}
+
+void MetricsExporter::do_write(int fd)
+{
+    auto it = me_clients.find(fd);
+    if (it == me_clients.end() || it->second.c_closing) {
+        return;
+    }
+    Client& client = it->second;
+    while (client.c_sent < client.c_out.size()) {
+        ssize_t n = send(fd, client.c_out.data() + client.c_sent, client.c_out.size() - client.c_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            client.c_sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            //socket发送缓冲区满，等待可写后继续发送
+            if (!client.c_writing) {
+                client.c_writing = true;
+                me_loop->add_to_poller(fd, EPOLLOUT, [this, fd]() { this->do_write(fd); });
+            }
+            return;
+        }
+        close_client(fd);
+        return;
+    }
+    close_client(fd);
+}
+
+void MetricsExporter::close_client(int fd)
+{
+    auto it = me_clients.find(fd);
+    if (it == me_clients.end() || it->second.c_closing) {
+        return;
+    }
+    it->second.c_closing = true;
+    me_loop->queue_task([this, fd]() {
+        me_loop->del_from_poller(fd);
+        me_clients.erase(fd);
+        close(fd);
+    });
+}
@@ -0,0 +1,84 @@
+#ifndef __METRICS_EXPORTER_H__
+#define __METRICS_EXPORTER_H__
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class EventLoop;
+
+const int METRICS_MAX_REQUEST = 8192;  // 抓取请求头的最大长度(字节)，超过时关闭连接
+
+// Prometheus文本格式（text/plain; version=0.0.4）的输出缓冲，抓取之间复用，稳定后不再分配内存
+class MetricsText
+{
+public:
+    // 输出指标的HELP和TYPE行，每个指标名在它的样本之前调用一次
+    void header(const char* name, const char* type, const char* help);
+
+    // 输出一个样本，labels为不带花括号的标签列表（如 loop="0"），没有标签时为nullptr
+    void sample(const char* name, const char* labels, uint64_t value);
+    void sample(const char* name, const char* labels, double value);
+
+    const string& str() const { return mt_buf; }
+    void clear() { mt_buf.clear(); }
+
+private:
+    void append_name(const char* name, const char* labels);
+
+    string mt_buf;
+};
+
+/*
+   内置的指标监听端口：
+   * 在指定的事件循环（TcpServer的接受器事件循环）中监听单独的端口，不占用连接事件循环
+   * 每个抓取连接读到完整的请求头后，依次调用各个输出函数生成指标文本，响应写完后关闭连接
+   * 输出函数只读取各线程自己写入的原子计数，不加锁、不向其他事件循环投递任务，
+     一次抓取的开销只和事件循环个数有关，与连接数和请求量无关，可以在满负载时一直开着
+*/
+class MetricsExporter
+{
+public:
+    typedef function<void(MetricsText&)> Collector;  // 指标输出函数，在所属事件循环线程中调用
+
+    MetricsExporter(EventLoop* loop, const char* ip, uint16_t port);
+    ~MetricsExporter();
+
+    void add_collector(Collector cb) { me_collectors.push_back(move(cb)); }  // 添加输出函数，需要在listen()之前调用
+
+    void listen();  // 开始监听，只能在所属事件循环线程中调用
+
+    uint64_t get_scrape_cnt() const { return me_scrape_cnt.load(memory_order_relaxed); }  // 已响应的抓取次数，可跨线程读取
+
+private:
+    // 一个抓取连接
+    struct Client
+    {
+        string c_in;  // 已读取的请求
+        string c_out;  // 待发送的响应
+        size_t c_sent{ 0 };  // 响应已发送的字节数
+        bool c_writing{ false };  // 是否已经注册写事件
+        bool c_closing{ false };  // 是否已经准备关闭，关闭在下一轮循环中执行
+    };
+
+    void do_accept();  // 接受新的抓取连接
+    void do_read(int fd);  // 读取请求，请求头完整后生成响应
+    void do_write(int fd);  // 发送响应，发送完后关闭连接
+    void respond(Client& client);  // 生成响应
+    void close_client(int fd);  // 关闭连接，不能在该fd自己的回调中直接从poller删除，放到下一轮循环执行
+
+    EventLoop* me_loop;  // 所属的事件循环
+    int me_listen_fd;  // 监听套接字
+    MetricsText me_text;  // 复用的指标文本缓冲
+    vector<Collector> me_collectors;  // 指标输出函数
+    unordered_map<int, Client> me_clients;  // 抓取连接，只在所属事件循环线程中访问
+    atomic<uint64_t> me_scrape_cnt{ 0 };  // 已响应的抓取次数
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __MPSC_QUEUE_H__
+#define __MPSC_QUEUE_H__
+
+#include <stddef.h>
+#include <atomic>
+
+using namespace std;
+
+// 侵入式队列的节点，需要入队的对象继承该结构体
+struct MpscNode
+{
+    atomic<MpscNode*> next{ nullptr };
+};
+
+// 侵入式无锁多生产者单消费者队列（Vyukov MPSC队列）
+// * 入队只有一次原子交换和一次原子写，多个生产者之间没有锁，也不会互相重试
+// * 出队只能在唯一的消费者线程中调用
+// * 队列不管理节点内存，节点在出队之后由消费者负责释放
+class MpscQueue
+{
+public:
+    MpscQueue() : mq_head(&mq_stub), mq_tail(&mq_stub) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 入队，可以在任意线程中调用
+    void push(MpscNode* node)
+    {
+        mq_pushed.fetch_add(1, memory_order_relaxed);
+        link(node);
+    }
+
+    // 出队，只能在消费者线程中调用
+    // 队列为空，或者有生产者正在入队还没有连接好节点时返回nullptr
+    MpscNode* pop()
+    {
+        MpscNode* tail = mq_tail;
+        MpscNode* next = tail->next.load(memory_order_acquire);
+        if (tail == &mq_stub) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            mq_tail = next;
+            tail = next;
+            next = next->next.load(memory_order_acquire);
+        }
+        if (next) {
+            mq_tail = next;
+            mq_popped++;
+            return tail;
+        }
+        if (tail != mq_head.load(memory_order_acquire)) {
+            return nullptr;
+        }
+        //tail是最后一个节点，放回哨兵节点后才能把它取出
+        //检查之后生产者可能又入队了节点，哨兵会排在该节点之后，mq_head此时指向哨兵但队列不为空
+        link(&mq_stub);
+        next = tail->next.load(memory_order_acquire);
+        if (next) {
+            mq_tail = next;
+            mq_popped++;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    // 已经入队还没有出队的节点数，包括正在入队的节点，只能在消费者线程中调用
+    // 消费者可以据此只处理到某个时刻为止已经入队的节点
+    size_t size() const { return mq_pushed.load(memory_order_acquire) - mq_popped; }
+
+    // 队列中是否有节点（包括正在入队的节点），只能在消费者线程中调用
+    bool has_pending() const
+    {
+        //mq_tail不是哨兵节点时指向一个还没有出队的节点
+        return mq_tail != &mq_stub || mq_head.load(memory_order_seq_cst) != &mq_stub;
+    }
+
+private:
+    // 把节点接到队尾，哨兵节点也通过它放回队列，不计入入队数
+    void link(MpscNode* node)
+    {
+        node->next.store(nullptr, memory_order_relaxed);
+        MpscNode* prev = mq_head.exchange(node, memory_order_seq_cst);
+        //交换之后到写入next之前，消费者看到的队列是断开的，出队会返回nullptr
+        prev->next.store(node, memory_order_release);
+    }
+
+    atomic<MpscNode*> mq_head;  // 生产者端，指向最后入队的节点
+    atomic<size_t> mq_pushed{ 0 };  // 入队的节点数，和mq_head一样只被生产者修改，放在同一缓存行
+    MpscNode* mq_tail;  // 消费者端，指向下一个出队的节点
+    size_t mq_popped{ 0 };  // 出队的节点数，只在消费者线程中修改
+    MpscNode mq_stub;  // 哨兵节点
+};
+
+#endif
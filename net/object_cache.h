@@ -0,0 +1,165 @@
+#ifndef __OBJECT_CACHE_H__
+#define __OBJECT_CACHE_H__
+
+#include <new>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+// 定长对象的线程缓存，用于频繁在一个线程创建、在另一个线程销毁的小对象（如事件循环的任务节点）
+// * 每个线程有自己的空闲链表，创建和销毁都先访问本线程链表，不加锁
+// * 本线程链表过长时把一批节点交给全局链表，本线程链表为空时从全局链表取回一批，批量转移时才加锁
+// * 稳定状态下生产者线程取回的节点就是消费者线程归还的节点，创建和销毁都不调用malloc/free
+// * 全局链表有上限，超过上限的节点直接释放，线程退出时把剩余节点交给全局链表
+template <typename T>
+class ObjectCache
+{
+public:
+    static const int LOCAL_MAX = 256;      // 线程链表的最大节点数
+    static const int BATCH_SIZE = 128;     // 线程与全局链表之间每批转移的节点数
+    static const int GLOBAL_MAX_BATCHES = 512;  // 全局链表最多保存的批数
+
+    template <typename... Args>
+    static T* create(Args&&... args)
+    {
+        void* mem = alloc();
+        try {
+            return ::new (mem) T(forward<Args>(args)...);
+        }
+        catch (...) {
+            release(mem);
+            throw;
+        }
+    }
+
+    static void destroy(T* obj)
+    {
+        obj->~T();
+        release(obj);
+    }
+
+private:
+    // 空闲节点，复用对象所在的内存
+    struct FreeNode
+    {
+        FreeNode* next;        // 同一批中的下一个节点
+        FreeNode* next_batch;  // 只在每批的第一个节点中有效，指向全局链表中的下一批
+    };
+
+    static const size_t SLOT_SIZE = sizeof(T) > sizeof(FreeNode) ? sizeof(T) : sizeof(FreeNode);
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "ObjectCache does not support over-aligned types");
+
+    struct Global
+    {
+        mutex g_lock;
+        FreeNode* g_batches = nullptr;  // 每批BATCH_SIZE个节点
+        int g_batch_cnt = 0;
+
+        ~Global()
+        {
+            while (g_batches) {
+                FreeNode* batch = g_batches;
+                g_batches = batch->next_batch;
+                free_list(batch);
+            }
+        }
+    };
+
+    struct Local
+    {
+        FreeNode* l_head = nullptr;
+        int l_cnt = 0;
+
+        ~Local()
+        {
+            //线程退出，剩余节点按批交给全局链表
+            while (l_cnt > 0) {
+                flush(*this, l_cnt < BATCH_SIZE ? l_cnt : BATCH_SIZE);
+            }
+        }
+    };
+
+    static Global& global()
+    {
+        static Global g;
+        return g;
+    }
+
+    static Local& local()
+    {
+        static thread_local Local l;
+        return l;
+    }
+
+    static void free_list(FreeNode* node)
+    {
+        while (node) {
+            FreeNode* next = node->next;
+            ::operator delete(node);
+            node = next;
+        }
+    }
+
+    static void* alloc()
+    {
+        Local& l = local();
+        if (!l.l_head) {
+            Global& g = global();
+            lock_guard<mutex> lock{ g.g_lock };
+            if (g.g_batches) {
+                l.l_head = g.g_batches;
+                g.g_batches = l.l_head->next_batch;
+                g.g_batch_cnt--;
+                l.l_cnt = BATCH_SIZE;
+            }
+        }
+        if (!l.l_head) {
+            return ::operator new(SLOT_SIZE);
+        }
+        FreeNode* node = l.l_head;
+        l.l_head = node->next;
+        l.l_cnt--;
+        return node;
+    }
+
+    static void release(void* mem)
+    {
+        Local& l = local();
+        FreeNode* node = static_cast<FreeNode*>(mem);
+        node->next = l.l_head;
+        l.l_head = node;
+        l.l_cnt++;
+        if (l.l_cnt >= LOCAL_MAX) {
+            flush(l, BATCH_SIZE);
+        }
+    }
+
+    // 从线程链表头部取出cnt个节点作为一批交给全局链表，全局链表已满时直接释放
+    static void flush(Local& l, int cnt)
+    {
+        FreeNode* batch = l.l_head;
+        FreeNode* last = batch;
+        for (int i = 1; i < cnt; i++) {
+            last = last->next;
+        }
+        l.l_head = last->next;
+        l.l_cnt -= cnt;
+        last->next = nullptr;
+
+        if (cnt == BATCH_SIZE) {
+            Global& g = global();
+            lock_guard<mutex> lock{ g.g_lock };
+            if (g.g_batch_cnt < GLOBAL_MAX_BATCHES) {
+                batch->next_batch = g.g_batches;
+                g.g_batches = batch;
+                g.g_batch_cnt++;
+                return;
+            }
+        }
+        free_list(batch);  //不足一批的节点（只在线程退出时出现）直接释放
+    }
+};
+
+#endif
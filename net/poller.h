@@ -0,0 +1,64 @@
+#ifndef __POLLER_H__
+#define __POLLER_H__
+
+#include <sys/epoll.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+
+#include "../threadpool/inline_task.h"
+
+using namespace std;
+
+const int POLLER_WAIT_TIME = 20000;  // 等待事件的默认超时时间(ms)
+
+// 事件循环使用的io多路复用后端类型
+enum class PollerType {
+    Epoll,    // epoll
+    IoUring,  // io_uring的poll/accept请求，只提供就绪通知，读写仍是普通系统调用；内核不支持时自动回退到epoll
+};
+
+// io多路复用后端的抽象接口，EventLoop通过该接口注册fd的事件和回调函数
+// 事件类型统一使用EPOLLIN/EPOLLOUT/EPOLLET等epoll的宏表示
+class Poller {
+public:
+    typedef InlineFunction<void()> EventCallback;  // 事件回调函数类型定义，只能移动，小的回调对象不分配内存
+    typedef InlineFunction<void(int)> AcceptCallback;  // 新连接回调函数类型定义，参数为连接的文件描述符，accept失败时为负的错误码
+
+    struct io_event
+    {
+        int event{ 0 };  // 监听的事件类型，为0表示该fd没有注册到poller中
+        EventCallback read_callback;  // 读事件回调函数
+        EventCallback write_callback;  // 写事件回调函数
+    };
+
+    virtual ~Poller() {}
+
+    virtual void add_event(int fd, int event, EventCallback&& cb) = 0;  // 添加事件
+
+    virtual void del_event(int fd, int event) = 0;  // 删除特定事件
+
+    virtual void del_event(int fd) = 0;  // 删除特定文件描述符的所有事件
+
+    // 最多等待timeout_ms毫秒，并执行就绪事件的回调函数，返回处理的事件个数；timeout_ms为0时不阻塞
+    virtual int poll(int timeout_ms) = 0;
+
+    virtual uint64_t get_poll_cnt() const = 0;  // 获取等待事件的系统调用次数，可跨线程读取
+
+    virtual const char* name() const = 0;  // 后端名称
+
+    // 最近一次poll中等待事件的系统调用返回的时间(CLOCK_MONOTONIC, ns)，用于把poll的耗时分为等待和执行回调两部分
+    int64_t get_wait_end_ns() const { return pl_wait_end_ns; }
+
+    // 由后端直接完成监听fd上的accept，每得到一个新连接调用一次cb；accept失败时以-errno调用cb，后端等待一段时间后再继续accept
+    // 返回false表示后端不支持，调用者需要自己注册读事件并调用accept
+    virtual bool add_acceptor(int /*listen_fd*/, AcceptCallback&& /*cb*/) { return false; }
+
+    // 创建指定类型的后端，io_uring不可用时回退到epoll
+    static shared_ptr<Poller> create(PollerType type);
+
+protected:
+    int64_t pl_wait_end_ns{ 0 };  // 只在事件循环线程中读写
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+// 槽位表，插入时返回槽位下标，之后按下标O(1)删除
+// * 删除只清空槽位并把下标放入空闲列表，插入时优先复用空闲槽位，元素不需要移动
+// * 只能在一个线程中修改和遍历，元素个数可以在其他线程中读取
+// T需要可以默认构造，并且可以和T()比较判断槽位是否为空（如shared_ptr）
+template <typename T>
+class SlotMap
+{
+public:
+    // 插入元素，返回所在槽位的下标
+    uint32_t insert(const T& value)
+    {
+        uint32_t slot;
+        if (!sm_free.empty()) {
+            slot = sm_free.back();
+            sm_free.pop_back();
+            sm_slots[slot] = value;
+        }
+        else {
+            slot = static_cast<uint32_t>(sm_slots.size());
+            sm_slots.emplace_back(value);
+        }
+        sm_size.fetch_add(1, memory_order_relaxed);
+        return slot;
+    }
+
+    // 删除槽位中的元素
+    void erase(uint32_t slot)
+    {
+        if (slot >= sm_slots.size() || sm_slots[slot] == T()) {
+            return;
+        }
+        sm_slots[slot] = T();
+        sm_free.push_back(slot);
+        sm_size.fetch_sub(1, memory_order_relaxed);
+    }
+
+    // 遍历所有元素，回调函数中可以插入和删除元素，新插入的元素可能会被遍历到
+    template <typename F>
+    void for_each(F&& f)
+    {
+        for (size_t i = 0; i < sm_slots.size(); i++) {
+            if (sm_slots[i] == T()) {
+                continue;
+            }
+            T value = sm_slots[i];  //回调中可能删除该元素或者让数组扩容，先复制一份
+            f(value);
+        }
+    }
+
+    size_t size() const { return sm_size.load(memory_order_relaxed); }  // 元素个数，可以跨线程读取
+
+private:
+    vector<T> sm_slots;  // 槽位数组
+    vector<uint32_t> sm_free;  // 空闲槽位的下标
+    atomic<size_t> sm_size{ 0 };  // 元素个数
+};
+
+#endif
@@ -1,7 +1,10 @@
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
@@ -13,26 +16,53 @@
 
 using namespace std;
 
-TcpConnection::TcpConnection(TcpServer *server, EventLoop* loop, int sockfd, struct sockaddr_in& addr, socklen_t& len) {
+// 边沿触发模式下每个连接每次事件最多读/写的次数，避免一个数据量大的连接饿死同一事件循环中的其他连接
+const int ET_MAX_READS_PER_EVENT = 16;
+const int ET_MAX_WRITES_PER_EVENT = 16;
+
+TcpConnection::TcpConnection(TcpServer *server, EventLoop* loop, int loop_index, int sockfd, struct sockaddr_in& addr, socklen_t& len) {
     tc_server = server;
     tc_peer_addr = addr;
     tc_peer_addrlen = len;
     tc_loop = loop;
+    tc_loop_index = loop_index;
+    tc_stats = server->ts_conn_stats[loop_index].get();
     tc_fd = sockfd;
+    tc_edge_triggered = server->ts_edge_triggered;
 
     set_sockfd(tc_fd);
 }
 
 //用于建立连接后，将连接建立的回调函数和以及该通信文件读事件触发的回调函数添加到事件循环中
+//poller和连接表只能在所属事件循环的线程中操作，所以读事件的注册和加入连接表也放在任务中执行
 void TcpConnection::add_task() {
-LOG_INFO("tcp connection add connected task to poller, conn fd is %d\n", tc_fd);
-    tc_loop->add_task([shared_this=shared_from_this()](){ shared_this->connected(); });  //连接成功事件加入事件循环
-LOG_INFO("tcp connection add do read to poller, conn fd is %d\n", tc_fd);
-    tc_loop->add_to_poller(tc_fd, EPOLLIN, [shared_this=shared_from_this()](){ shared_this->do_read(); }); //该通信连接读事件加入对应epoll实例中
+LOG_DEBUG("tcp connection add connected task to loop, conn fd is %d\n", tc_fd);
+    tc_loop->add_task([shared_this=shared_from_this()](){
+        shared_this->tc_server->add_new_tcp_conn(shared_this);  //服务器添加连接
+        int event = shared_this->tc_edge_triggered ? (EPOLLIN | EPOLLET) : EPOLLIN;
+        shared_this->tc_loop->add_to_poller(shared_this->tc_fd, event, [shared_this](){ shared_this->do_read(); }); //该通信连接读事件加入对应poller中
+        shared_this->update_idle_timeout(shared_this->tc_server->ts_tcp_conn_timout_ms);  //开始空闲超时计时
+        shared_this->connected();  //执行连接成功回调
+    });
+}
+
+//空闲超时节点在时间轮中时，连接一定还在服务器的连接列表中，回调里可以安全地获取shared_ptr
+void TcpConnection::update_idle_timeout(int timeout_ms) {
+    if (tc_fd == -1 || timeout_ms <= 0) {
+        return;
+    }
+    if (!tc_idle_node.wn_callback) {
+        tc_idle_node.wn_callback = [this]() {
+            LOG_INFO("tcp conn timeout!\n");
+            auto shared_this = shared_from_this();
+            shared_this->active_close();
+        };
+    }
+    tc_loop->get_timing_wheel().add(&tc_idle_node, timeout_ms);
 }
 
 TcpConnection::~TcpConnection() {
-    LOG_INFO("TcpConnection descontructed, fd is %d\n", tc_fd);
+    LOG_DEBUG("TcpConnection descontructed, fd is %d\n", tc_fd);
 
 }
 
@@ -45,16 +75,41 @@ void TcpConnection::set_sockfd(int& fd) {
 }
 
 void TcpConnection::do_read() {
-    //从通信文件中读数据到输入缓冲区
-    int ret = tc_ibuf.read_from_fd(tc_fd); 
-    if (ret == -1) {
-        PR_ERROR("read data from socket error\n");
-        this->do_close();
-        return;
+    int read_cnt = 0;
+    int total = 0;
+    //水平触发模式下每次事件只读一次；边沿触发模式下循环读取直到EAGAIN，或达到单次事件的读取上限
+    while (true) {
+        //从通信文件中读数据到输入缓冲区
+        int ret = tc_ibuf.read_from_fd(tc_fd); 
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;  //内核缓冲区中的数据已经读完
+            }
+            PR_ERROR("read data from socket error\n");
+            this->do_close();
+            return;
+        }
+        else if (ret == 0) {
+            LOG_INFO("connection closed by peer\n");
+            this->do_close();
+            return;
+        }
+        total += ret;
+        metric_add(tc_stats->cs_bytes_in, ret);
+
+        if (!tc_edge_triggered) {
+            break;
+        }
+        if (++read_cnt >= ET_MAX_READS_PER_EVENT) {
+            //边沿触发不会再次通知剩余的数据，交给下一轮循环继续读取
+            tc_loop->queue_task([shared_this=shared_from_this()](){
+                if (shared_this->tc_fd != -1) shared_this->do_read();
+            });
+            break;
+        }
     }
-    else if (ret == 0) {
-        LOG_INFO("connection closed by peer\n");
-        this->do_close();
+
+    if (total == 0) {
         return;
     }
      
@@ -66,8 +121,13 @@ void TcpConnection::do_read() {
 
 //将数据发送到输出缓冲区,并在必要时将写事件添加到事件循环或 epoll 实例中，以便在后续的事件循环中进行数据发送操作
 bool TcpConnection::send(const char *data, int len) {
+    if (tc_fd == -1) {
+        //连接已经关闭（例如回调或业务线程回复一个刚关闭的连接），丢弃数据
+        LOG_INFO("send to closed connection, %d bytes dropped\n", len);
+        return false;
+    }
     bool should_activate_epollout = false; 
-    if(tc_obuf.length() == 0) {
+    if(!has_pending_output()) {
         should_activate_epollout = true;
     }
     int ret = tc_obuf.write2buf(data, len); 
@@ -83,10 +143,85 @@ bool TcpConnection::send(const char *data, int len) {
     return true;
 }
 
-//将数据从输出缓冲区发送到socket
+//将文件区域加入发送队列，记录输出缓冲区中排在它前面的字节数
+bool TcpConnection::send_file(int fd, off_t offset, size_t len) {
+    if (tc_fd == -1) {
+        LOG_INFO("send file to closed connection, %zu bytes dropped\n", len);
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+    bool should_activate_epollout = !has_pending_output();
+
+    FileRegion region;
+    region.fd = dup(fd);
+    if (region.fd == -1) {
+        PR_ERROR("dup file fd %d error, error str:%s\n", fd, strerror(errno));
+        return false;
+    }
+    region.offset = offset;
+    region.remain = len;
+    region.buf_before = tc_obuf.length();
+    for (auto& r : tc_file_regions) {
+        region.buf_before -= r.buf_before;
+    }
+    tc_file_regions.push_back(region);
+
+    if (should_activate_epollout) {
+        tc_loop->add_to_poller(tc_fd, EPOLLOUT, [this](){ this->do_write(); });   //写事件添加到epoll中
+    }
+    return true;
+}
+
+//使用sendfile发送文件区域
+int TcpConnection::send_file_region(FileRegion& region) {
+    ssize_t ret;
+    do {
+        ret = sendfile(tc_fd, region.fd, &region.offset, region.remain);  //sendfile会更新offset
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret == -1) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    if (ret == 0) {
+        //文件比请求发送的长度短，已经无法发送完整的数据
+        PR_ERROR("sendfile reach end of file, %zu bytes not sent\n", region.remain);
+        return -1;
+    }
+    region.remain -= ret;
+    return static_cast<int>(ret);
+}
+
+void TcpConnection::clear_file_regions() {
+    for (auto& region : tc_file_regions) {
+        close(region.fd);
+    }
+    tc_file_regions.clear();
+}
+
+//将数据从输出缓冲区和文件区域按顺序发送到socket
 void TcpConnection::do_write() {
-    while (tc_obuf.length()) {
-        int ret= tc_obuf.write2fd(tc_fd);
+    int write_cnt = 0;
+    while (has_pending_output()) {
+        int ret;
+        if (!tc_file_regions.empty() && tc_file_regions.front().buf_before == 0) {
+            //排在文件区域前面的缓冲区数据已经发送完，发送文件区域
+            FileRegion& region = tc_file_regions.front();
+            ret = send_file_region(region);
+            if (ret > 0 && region.remain == 0) {
+                close(region.fd);
+                tc_file_regions.pop_front();
+            }
+        }
+        else {
+            //有文件区域时只发送排在它前面的缓冲区数据
+            int limit = tc_file_regions.empty() ? -1 : tc_file_regions.front().buf_before;
+            ret = tc_obuf.write2fd(tc_fd, limit);
+            if (ret > 0 && !tc_file_regions.empty()) {
+                tc_file_regions.front().buf_before -= ret;
+            }
+        }
         if (ret == -1) {
             PR_ERROR("write2fd error, close conn!\n");
             this->do_close();
@@ -95,25 +230,54 @@ void TcpConnection::do_write() {
         if (ret == 0) {
             break;
         }
+        metric_add(tc_stats->cs_bytes_out, ret);
+        if (tc_edge_triggered && ++write_cnt >= ET_MAX_WRITES_PER_EVENT && has_pending_output()) {
+            //达到单次事件的写入上限，剩余数据交给下一轮循环继续发送
+            tc_loop->queue_task([shared_this=shared_from_this()](){
+                if (shared_this->tc_fd != -1) shared_this->do_write();
+            });
+            return;
+        }
     }
 
-    if (tc_obuf.length() == 0) {
+    if (!has_pending_output()) {
         tc_loop->del_from_poller(tc_fd, EPOLLOUT);
+        if (tc_close_after_write) {
+            this->do_close();
+        }
     }
 
     return;    
 }
 
+void TcpConnection::close_after_write() {
+    if (tc_fd == -1) {
+        return;
+    }
+    if (!has_pending_output()) {
+        this->do_close();
+        return;
+    }
+    tc_close_after_write = true;
+}
+
 //端开通信连接
 void TcpConnection::do_close() {
+    if (tc_fd == -1) {
+        return;  //连接已经关闭
+    }
     if (tc_close_cb) {
         tc_close_cb();
     }
 
     tc_loop->del_from_poller(tc_fd);  //取出事件循环
+    if (tc_idle_node.is_linked()) {
+        tc_loop->get_timing_wheel().remove(&tc_idle_node);  //取消空闲超时
+    }
     //清空输入输出缓冲区
     tc_ibuf.clear(); 
     tc_obuf.clear();
+    clear_file_regions();
 
     int fd = tc_fd;
     tc_fd = -1;
@@ -126,7 +290,7 @@ void TcpConnection::do_close() {
 void TcpConnection::connected() {
     //连接建立的回调函数存在则直接调用
     if(tc_connected_cb) {
-        LOG_INFO("execute connected callback, conn fd is %d\n", tc_fd);
+        LOG_DEBUG("execute connected callback, conn fd is %d\n", tc_fd);
         tc_connected_cb(shared_from_this());   
     }
     else {
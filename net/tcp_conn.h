@@ -3,11 +3,14 @@
 
 #include <memory>
 #include <any>
+#include <deque>
+#include <sys/types.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <functional>
 
 #include "../memory/data_buf.h"
+#include "timing_wheel.h"
 
 using namespace std;
 
@@ -17,6 +20,7 @@ typedef shared_ptr<TcpConnection> TcpConnSP;  // TcpConnection 类的共享指
 
 class EventLoop;
 class TcpServer;  // 声明服务器类
+struct ConnLoopStats;
 
 class TcpConnection : public enable_shared_from_this<TcpConnection> {
 public:
@@ -24,10 +28,15 @@ public:
     typedef function<void()> CloseCallback;  // 连接关闭的回调函数类型
     typedef function<void(const TcpConnSP&, InputBuffer*)> MessageCallback;  // 收到消息的回调函数类型
 
-    TcpConnection(TcpServer *server, EventLoop* loop, int sockfd, struct sockaddr_in& addr, socklen_t& len);  // 构造函数
+    // 构造函数，loop_index为所属事件循环在服务器连接事件循环列表中的下标
+    TcpConnection(TcpServer *server, EventLoop* loop, int loop_index, int sockfd, struct sockaddr_in& addr, socklen_t& len);
     ~TcpConnection();  // 析构函数
 
     EventLoop* getLoop() const { return tc_loop; }  // 获取所属的事件循环
+    int get_loop_index() const { return tc_loop_index; }  // 获取所属事件循环的下标
+
+    void set_slot(uint32_t slot) { tc_slot = slot; }  // 设置在所属事件循环连接表中的槽位
+    uint32_t get_slot() const { return tc_slot; }  // 获取在所属事件循环连接表中的槽位
 
     void add_task();  // 向事件循环添加任务
 
@@ -37,7 +46,11 @@ public:
     const char* get_peer_addr() { return inet_ntoa(tc_peer_addr.sin_addr);} // 获取对端地址
     auto get_fd() { return tc_fd; }  // 获取socket文件描述符
 
-    bool send(const char *data, int len);  // 发送数据
+    bool send(const char *data, int len);  // 发送数据，连接已经关闭时丢弃数据并返回false
+
+    // 发送文件fd中从offset开始的len字节，使用sendfile从内核直接发送，不经过用户态缓冲区
+    // 与send发送的数据按调用顺序发送；内部会dup文件描述符，调用后可以立即关闭fd；连接已经关闭时返回false
+    bool send_file(int fd, off_t offset, size_t len);
 
     void set_connected_cb(const ConnectionCallback& cb) { tc_connected_cb = cb; }  // 设置连接建立时的回调函数
     void set_message_cb(const MessageCallback& cb) { tc_message_cb = cb; }  // 设置消息到达时的回调函数
@@ -46,26 +59,53 @@ public:
     void connected();  // 连接建立处理
     void active_close() { do_close(); }  // 主动发起关闭连接请求
 
-    void set_timer_id(int id) {tc_timer_id = id; }  // 设置定时器ID
-    int get_timer_id() { return tc_timer_id; }  // 获取定时器ID
+    // 等待输出缓冲区和文件区域发送完后再关闭连接，没有待发送的数据时立即关闭
+    // 用于发送完最后一个响应后关闭的协议（如HTTP的Connection: close）
+    void close_after_write();
+
+    bool is_closing() const { return tc_fd == -1 || tc_close_after_write; }  // 连接是否已经关闭或者正在等待关闭
+
+    // 刷新空闲超时时间，timeout_ms毫秒内没有新消息则关闭连接，只能在所属事件循环线程中调用
+    void update_idle_timeout(int timeout_ms);
+
+    bool is_edge_triggered() const { return tc_edge_triggered; }  // 是否使用epoll边沿触发模式
 
 private:
+    // 等待发送的文件区域
+    struct FileRegion
+    {
+        int fd;  // dup得到的文件描述符，发送完成或连接关闭时关闭
+        off_t offset;  // 下一次发送的文件偏移
+        size_t remain;  // 剩余的字节数
+        int buf_before;  // 输出缓冲区中需要在该区域之前发送的字节数（不包括之前的区域之前的字节）
+    };
+
     inline void set_sockfd(int& fd);  // 设置socket文件描述符
+    bool has_pending_output() const { return tc_obuf.length() > 0 || !tc_file_regions.empty(); }  // 是否还有待发送的数据
+    int send_file_region(FileRegion& region);  // 使用sendfile发送文件区域，返回发送的字节数，EAGAIN时返回0
+    void clear_file_regions();  // 关闭并清空所有等待发送的文件区域
     void do_read();  // 读取数据处理
     void do_write();  // 写数据处理
     void do_close();  // 关闭连接处理
 
     TcpServer* tc_server;  // 指向所属的服务器对象
     EventLoop* tc_loop;    // 指向所属的事件循环对象
+    int tc_loop_index;     // 所属事件循环的下标，也是所属连接表的下标
+    ConnLoopStats* tc_stats;  // 所属事件循环的连接统计
+    uint32_t tc_slot{ 0 };  // 在所属连接表中的槽位
     int tc_fd;             // 连接的socket文件描述符
-    int tc_timer_id{ -1 };  // 定时器ID，默认为-1
+    bool tc_edge_triggered{ false };  // 是否使用epoll边沿触发模式(EPOLLET)，由所属服务器决定
+    bool tc_close_after_write{ false };  // 待发送的数据发送完后关闭连接
 
     struct sockaddr_in tc_peer_addr;  // 对端地址信息
     socklen_t tc_peer_addrlen;  // 对端地址结构体长度
 
     OutputBuffer tc_obuf;  // 输出缓冲区
+    deque<FileRegion> tc_file_regions;  // 等待发送的文件区域，和输出缓冲区中的数据按顺序交错发送
     InputBuffer tc_ibuf;  // 输入缓冲区
 
+    WheelNode tc_idle_node;  // 所属事件循环时间轮中的空闲超时节点
+
     any tc_context;  // 连接的上下文信息，可以存储任意类型的数据
 
     ConnectionCallback tc_connected_cb;  // 连接建立时的回调函数
@@ -8,8 +8,10 @@
 #include "acceptor.h"
 #include "tcp_server.h"
 #include "event_loop.h"
+#include "metrics_exporter.h"
+#include "../memory/mem_pool.h"
 
-TcpServer::TcpServer(EventLoop* loop, const char *ip, uint16_t port) {    
+TcpServer::TcpServer(EventLoop* loop, const char *ip, uint16_t port, PollerType poller_type) : ts_poller_type(poller_type) {    
 
     if (signal(SIGHUP, SIG_IGN) == SIG_ERR) {       // SIGHUP: when terminal closing
         PR_ERROR("ignore SIGHUP signal error\n");
@@ -29,13 +31,11 @@ TcpServer::TcpServer(EventLoop* loop, const char *ip, uint16_t port) {
                             ts_msg_cb(conn, ibuf);//调用用户定义的消息到达回调函数
                         }
                     };
-    ts_acceptor = make_unique<Acceptor>(this, loop, ip, port); 
 }
 
 void TcpServer::start() {
     if (!ts_started) //未启动
     {
-        ts_timer.run(); //启动定时器
         ts_started = true;  //设置状态为已经启动
 LOG_INFO("tcp server create thread pool, thread num is %d\n", ts_thread_num);
         ts_thread_pool = make_unique<Threadpool>(ts_thread_num); //创建指定大小线程池，并交给独占指针管理
@@ -46,40 +46,243 @@ LOG_INFO("tcp server create thread pool, thread num is %d\n", ts_thread_num);
 
         for(int i=0; i<ts_thread_num; i++)
         {
-            ts_conn_loops.emplace_back(new EventLoop());
-            EventLoop* ev = ts_conn_loops[i];
 LOG_INFO("tcp server add loop_task to thread pool\n");
-            //将事件循环放在线程池的任务队列中，由线程自动处理
-            ts_thread_pool->post_task([&ev]() { ev->loop(); });  //将每个事件循环的循环处理函数添加到线程池的任务队列中
+            //事件循环在线程池的线程中创建并运行，这样事件循环记录的线程id就是实际执行循环的线程
+            promise<EventLoop*> loop_promise;
+            future<EventLoop*> loop_future = loop_promise.get_future();
+            ts_thread_pool->execute([&loop_promise, this]() {
+                EventLoop* ev = new EventLoop(ts_poller_type);
+                loop_promise.set_value(ev);
+                ev->loop();
+            });
+            ts_conn_loops.emplace_back(loop_future.get());  //等待事件循环创建完成
+            ts_conn_maps.emplace_back(make_unique<SlotMap<TcpConnSP>>());
+            ts_conn_stats.emplace_back(make_unique<ConnLoopStats>());
+        }
+LOG_INFO("tcp server conn loops use %s\n", ts_conn_loops.empty() ? "none" : ts_conn_loops[0]->get_poller_name());
+
+        //SO_REUSEPORT模式下每个连接事件循环创建一个接受器，否则只在接受器事件循环中创建一个
+        if (ts_reuse_port && !ts_conn_loops.empty()) {
+            for (size_t i = 0; i < ts_conn_loops.size(); i++) {
+                ts_acceptors.emplace_back(make_unique<Acceptor>(this, ts_conn_loops[i], ip, port, (int)i));
+            }
+        }
+        else {
+            ts_acceptors.emplace_back(make_unique<Acceptor>(this, ts_acceptor_loop, ip, port));
+        }
+
+        if (ts_metrics_port != 0) {
+            ts_metrics = make_unique<MetricsExporter>(ts_acceptor_loop, ip, ts_metrics_port);
+            ts_metrics->add_collector([this](MetricsText& out) { collect_metrics(out); });
+            for (auto& cb : ts_metrics_collectors) {
+                ts_metrics->add_collector(cb);
+            }
+            MetricsExporter* exporter = ts_metrics.get();
+            ts_acceptor_loop->add_task([exporter]() { exporter->listen(); });
         }
     }
 
-    if (!ts_acceptor->is_listenning())
+    for (auto& acceptor : ts_acceptors)
     {
+        if (!acceptor->is_listenning()) {
 LOG_INFO("tcp server add listen task to accpetor eventloop\n");
-        ts_acceptor_loop->add_task([this](){ this->ts_acceptor->listen(); }); //将监听任务添加到接受器所在事件循环
+            Acceptor* ac = acceptor.get();
+            ac->get_loop()->add_task([ac](){ ac->listen(); }); //将监听任务添加到接受器所在事件循环
+        }
     }
 }
 
 EventLoop* TcpServer::get_next_loop() {
+    int index = get_next_loop_index();
+    return index < 0 ? nullptr : ts_conn_loops[index];
+}
+
+int TcpServer::get_next_loop_index() {
     int size= ts_conn_loops.size(); 
-    if(size==0) { return nullptr; }
+    if(size==0) { return -1; }
 
     ++ts_next_loop;
     ts_next_loop = ts_next_loop % size; //成环不断循环
-    return ts_conn_loops[ts_next_loop]; 
+    return ts_next_loop; 
+}
+
+uint64_t TcpServer::get_poll_cnt() const {
+    uint64_t cnt = 0;
+    for (auto loop : ts_conn_loops) {
+        cnt += loop->get_poll_cnt();
+    }
+    return cnt;
 }
 
-//删除指定连接
+void TcpServer::get_loop_metrics(int index, LoopMetricsSnapshot& out) const {
+    out = LoopMetricsSnapshot();
+    if (index >= 0) {
+        if (index < static_cast<int>(ts_conn_loops.size())) {
+            ts_conn_loops[index]->get_metrics(out);
+        }
+        return;
+    }
+    LoopMetricsSnapshot one;
+    for (auto loop : ts_conn_loops) {
+        loop->get_metrics(one);
+        out.merge(one);
+    }
+}
+
+//添加新的TCP连接，空闲超时由连接所属事件循环的时间轮处理
+void TcpServer::add_new_tcp_conn(const TcpConnSP& tcp_conn) { 
+    uint32_t slot = ts_conn_maps[tcp_conn->get_loop_index()]->insert(tcp_conn); //加入所属事件循环的连接表
+    tcp_conn->set_slot(slot);
+    metric_add(ts_conn_stats[tcp_conn->get_loop_index()]->cs_accepted, 1);
+}
+
+//删除指定连接，按槽位下标O(1)删除
 void TcpServer::do_clean(const TcpConnSP& tcp_conn) {
-    lock_guard<mutex> lck(mutex);
-    for(auto i=ts_tcp_connections.begin(), e=ts_tcp_connections.end(); i!=e; ++i) {
-        if(tcp_conn==*i) {
 LOG_INFO("tcpserver do clean, erase tcp_conn\n");
-            ts_tcp_connections.erase(i);
-            break;
+    ts_conn_maps[tcp_conn->get_loop_index()]->erase(tcp_conn->get_slot());
+    metric_add(ts_conn_stats[tcp_conn->get_loop_index()]->cs_closed, 1);
+}
+
+//在每个连接事件循环中遍历自己的连接表
+void TcpServer::for_each_conn(const function<void(const TcpConnSP&)>& cb) {
+    for (size_t i = 0; i < ts_conn_loops.size(); i++) {
+        SlotMap<TcpConnSP>* conn_map = ts_conn_maps[i].get();
+        ts_conn_loops[i]->add_task([conn_map, cb]() {
+            conn_map->for_each(cb);
+        });
+    }
+}
+
+//连接表只能在各自的事件循环线程中访问，这里用接受和关闭的计数相减
+size_t TcpServer::get_conn_num() const {
+    size_t num = 0;
+    for (auto& stats : ts_conn_stats) {
+        num += stats->cs_accepted.load(memory_order_relaxed) - stats->cs_closed.load(memory_order_relaxed);
+    }
+    return num;
+}
+
+//每个连接事件循环一组带loop标签的样本，全部来自各线程自己写入的计数，不加锁
+void TcpServer::collect_metrics(MetricsText& out) const {
+    int loop_num = static_cast<int>(ts_conn_loops.size());
+    char label[32];
+
+    out.header("reactor_connections", "gauge", "Open connections per connection loop.");
+    for (int i = 0; i < loop_num; i++) {
+        snprintf(label, sizeof label, "loop=\"%d\"", i);
+        const ConnLoopStats& st = *ts_conn_stats[i];
+        out.sample("reactor_connections", label,
+                   st.cs_accepted.load(memory_order_relaxed) - st.cs_closed.load(memory_order_relaxed));
+    }
+    struct Counter {
+        const char *name;
+        const char *help;
+        atomic<uint64_t> ConnLoopStats::*field;
+    };
+    const Counter counters[] = {
+        { "reactor_accepted_connections_total", "Connections accepted into each connection loop.", &ConnLoopStats::cs_accepted },
+        { "reactor_closed_connections_total", "Connections closed in each connection loop.", &ConnLoopStats::cs_closed },
+        { "reactor_received_bytes_total", "Bytes read from client sockets.", &ConnLoopStats::cs_bytes_in },
+        { "reactor_sent_bytes_total", "Bytes written to client sockets, including sendfile.", &ConnLoopStats::cs_bytes_out },
+    };
+    for (const Counter& c : counters) {
+        out.header(c.name, "counter", c.help);
+        for (int i = 0; i < loop_num; i++) {
+            snprintf(label, sizeof label, "loop=\"%d\"", i);
+            out.sample(c.name, label, ((*ts_conn_stats[i]).*c.field).load(memory_order_relaxed));
+        }
+    }
+
+    //事件循环的运行指标，接受器事件循环的标签为acceptor
+    vector<pair<string, const EventLoop*>> loops;
+    loops.emplace_back("acceptor", ts_acceptor_loop);
+    for (int i = 0; i < loop_num; i++) {
+        loops.emplace_back(to_string(i), ts_conn_loops[i]);
+    }
+    vector<LoopMetricsSnapshot> snaps(loops.size());
+    for (size_t i = 0; i < loops.size(); i++) {
+        loops[i].second->get_metrics(snaps[i]);
+    }
+    struct LoopSample {
+        const char *name;
+        const char *type;
+        const char *help;
+        double (*value)(const LoopMetricsSnapshot&, const EventLoop*);
+    };
+    const LoopSample loop_samples[] = {
+        { "reactor_loop_iterations_total", "counter", "Event loop iterations.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return (double)s.ls_iterations; } },
+        { "reactor_loop_events_total", "counter", "Ready events handled.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return (double)s.ls_events; } },
+        { "reactor_loop_wait_seconds_total", "counter", "Time blocked waiting for events.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return s.ls_wait_ns / 1e9; } },
+        { "reactor_loop_busy_seconds_total", "counter", "Time spent in callbacks and queued tasks.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return s.ls_busy_ns / 1e9; } },
+        { "reactor_loop_tasks_total", "counter", "Queued tasks executed.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return (double)s.ls_tasks; } },
+        { "reactor_loop_pending_tasks", "gauge", "Tasks queued but not yet executed.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return (double)s.pending_tasks(); } },
+        { "reactor_loop_wakeups_total", "counter", "Eventfd writes to wake the loop.",
+          [](const LoopMetricsSnapshot& s, const EventLoop*) { return (double)s.ls_wakeups; } },
+        { "reactor_timers_pending", "gauge", "Timers waiting to fire.",
+          [](const LoopMetricsSnapshot&, const EventLoop* loop) { return (double)loop->get_timer_num(); } },
+    };
+    for (const LoopSample& ls : loop_samples) {
+        out.header(ls.name, ls.type, ls.help);
+        for (size_t i = 0; i < loops.size(); i++) {
+            snprintf(label, sizeof label, "loop=\"%s\"", loops[i].first.c_str());
+            out.sample(ls.name, label, ls.value(snaps[i], loops[i].second));
+        }
+    }
+
+    //内存池：各种内存块的统计快照，只读取原子计数，不加内存池的锁
+    MempoolStats mem;
+    Mempool::get_instance().get_stats(mem);
+    char cls_label[64];
+    out.header("reactor_mempool_chunks", "gauge", "Mempool chunks by size class and state.");
+    for (const MempoolClassStats& cs : mem.ms_classes) {
+        const pair<const char*, int64_t> states[] = {
+            { "in_use", cs.cs_in_use }, { "pooled", cs.cs_pooled }, { "cached", cs.cs_cached },
+        };
+        for (auto& state : states) {
+            snprintf(cls_label, sizeof cls_label, "size=\"%d\",state=\"%s\"", cs.cs_size, state.first);
+            out.sample("reactor_mempool_chunks", cls_label, static_cast<uint64_t>(state.second));
         }
     }
+    struct MemSample {
+        const char *name;
+        const char *type;
+        const char *help;
+        uint64_t (*value)(const MempoolClassStats&);
+    };
+    const MemSample mem_samples[] = {
+        { "reactor_mempool_chunks_created", "gauge", "Chunks created, preallocated plus fallback.",
+          [](const MempoolClassStats& cs) { return (uint64_t)cs.cs_total; } },
+        { "reactor_mempool_chunks_peak", "gauge", "High-water mark of chunks outside the global pool (in use or cached).",
+          [](const MempoolClassStats& cs) { return (uint64_t)cs.cs_peak; } },
+        { "reactor_mempool_fallback_allocs_total", "counter", "Chunks newly allocated because the pool was empty.",
+          [](const MempoolClassStats& cs) { return cs.cs_fallback; } },
+        { "reactor_mempool_grow_copies_total", "counter", "Buffer merges copied into a chunk of this size.",
+          [](const MempoolClassStats& cs) { return cs.cs_grow_copies; } },
+    };
+    for (const MemSample& ms : mem_samples) {
+        out.header(ms.name, ms.type, ms.help);
+        for (const MempoolClassStats& cs : mem.ms_classes) {
+            snprintf(cls_label, sizeof cls_label, "size=\"%d\"", cs.cs_size);
+            out.sample(ms.name, cls_label, ms.value(cs));
+        }
+    }
+    out.header("reactor_mempool_oversize_failures_total", "counter", "Allocations larger than the biggest chunk size.");
+    out.sample("reactor_mempool_oversize_failures_total", nullptr, mem.ms_oversize);
+
+    if (ts_thread_pool) {
+        out.header("reactor_threadpool_pending_tasks", "gauge", "Tasks waiting in the server thread pool.");
+        out.sample("reactor_threadpool_pending_tasks", nullptr, static_cast<uint64_t>(ts_thread_pool->pending_task_cnt()));
+    }
+
+    //丢弃计数是一个原子变量，抓取时不获取日志对象的锁
+    out.header("reactor_log_dropped_total", "counter", "Async log records dropped (ring full with drop-when-full enabled, or record too long).");
+    out.sample("reactor_log_dropped_total", nullptr, static_cast<uint64_t>(Logger::get_instance()->get_dropped_count()));
 }
 
 TcpServer::~TcpServer() {
@@ -4,15 +4,27 @@
 #include <netinet/in.h>
 #include <vector>
 #include <chrono>
-#include <mutex>
+#include <functional>
 
 #include "tcp_conn.h"
-#include "../timer/timer.h"
+#include "poller.h"
+#include "loop_metrics.h"
+#include "slot_map.h"
 #include "../log/log.h"
 
 class EventLoop;
 class Threadpool;
 class Acceptor;
+class MetricsExporter;
+class MetricsText;
+
+// 每个连接事件循环一份的连接统计，只由该事件循环线程用metric_add写入，任意线程可以读取
+struct ConnLoopStats {
+    alignas(64) atomic<uint64_t> cs_accepted{ 0 };  // 加入该事件循环的连接数
+    atomic<uint64_t> cs_closed{ 0 };  // 关闭的连接数
+    atomic<uint64_t> cs_bytes_in{ 0 };  // 从socket读取的字节数
+    atomic<uint64_t> cs_bytes_out{ 0 };  // 写入socket的字节数（包括sendfile）
+};
 
 // 前向声明TcpConnection类，以便于声明友元关系
 class TcpConnection;
@@ -28,8 +40,8 @@ public:
     friend class Acceptor;
     friend class TcpConnection;
 
-    // 构造函数
-    TcpServer(EventLoop* loop, const char *ip, uint16_t port); 
+    // 构造函数，poller_type为连接事件循环使用的io多路复用后端，io_uring不可用时自动回退到epoll
+    TcpServer(EventLoop* loop, const char *ip, uint16_t port, PollerType poller_type = PollerType::Epoll); 
 
     // 析构函数
     ~TcpServer();
@@ -40,12 +52,53 @@ public:
     // 获取下一个事件循环对象
     EventLoop* get_next_loop();
 
+    // 轮询获取下一个事件循环的下标
+    int get_next_loop_index();
+
+    // 获取下标对应的事件循环对象
+    EventLoop* get_loop(int index) { return ts_conn_loops[index]; }
+
     // 启动服务器
     void start();
 
-    // 执行清理
+    // 执行清理，从连接所属事件循环的连接表中删除，只能在连接所属事件循环线程中调用
     void do_clean(const TcpConnSP& tcp_conn);
 
+    // 对所有连接执行cb，用于广播或关闭所有连接
+    // cb在各连接所属的事件循环线程中执行，不同事件循环的连接会并发执行，函数返回时cb不一定已经执行完
+    void for_each_conn(const function<void(const TcpConnSP&)>& cb);
+
+    // 获取当前的连接总数，由各连接事件循环的统计计数得到，可以在任意线程中调用
+    size_t get_conn_num() const;
+
+    // 获取第index个连接事件循环的连接统计，start()之后有效
+    const ConnLoopStats& get_conn_stats(int index) const { return *ts_conn_stats[index]; }
+
+    // 设置是否使用SO_REUSEPORT多接受器模式，需要在start()之前调用
+    // 开启后每个连接事件循环拥有一个绑定同一端口的监听套接字，在本循环中accept并处理连接，
+    // 不再由接受器事件循环统一accept后轮询分发
+    void set_reuse_port(bool on) { ts_reuse_port = on; }
+
+    // 设置连接socket是否使用epoll边沿触发模式，需要在start()之前调用
+    void set_edge_triggered(bool on) { ts_edge_triggered = on; }
+
+    // 获取所有连接事件循环epoll_wait的调用总次数
+    uint64_t get_poll_cnt() const;
+
+    // 获取连接事件循环的个数，start()之后有效
+    int get_conn_loop_num() const { return static_cast<int>(ts_conn_loops.size()); }
+
+    // 获取第index个连接事件循环的运行指标，index为-1时返回所有连接事件循环合并后的指标，可以在任意线程中调用
+    void get_loop_metrics(int index, LoopMetricsSnapshot& out) const;
+
+    // 开启内置的指标监听端口，需要在start()之前调用
+    // 在接受器事件循环中监听ip:port，对任意HTTP GET请求返回Prometheus文本格式的指标：
+    // 连接数、接受的连接数、收发字节数、各事件循环的运行指标和定时器数、内存池各种内存块的个数、线程池任务数、日志丢弃数
+    void set_metrics_port(uint16_t port) { ts_metrics_port = port; }
+
+    // 添加应用自己的指标，每次抓取时在接受器事件循环线程中调用cb输出，需要在start()之前调用
+    void add_metrics_collector(function<void(MetricsText&)> cb) { ts_metrics_collectors.push_back(move(cb)); }
+
     // 设置TCP连接超时时间
     void set_tcp_conn_timeout_ms(int ms) { ts_tcp_conn_timout_ms = ms; }
 
@@ -59,43 +112,41 @@ public:
     void set_close_cb(const CloseCallback& cb) { ts_close_cb = cb; }
 
 private:
-    // 添加新的TCP连接
-    void add_new_tcp_conn(const TcpConnSP& tcp_conn) { 
-        //添加一个在设定的连接超时时间后的定时任务，用于处理超时连接
-        // 使用定时器
-        auto timer_id = ts_timer.run_after(ts_tcp_conn_timout_ms, false, [tcp_conn]{
-            LOG_INFO("tcp conn timeout!\n"); //返回连接任务ID
-            tcp_conn->active_close();
-        });
-        tcp_conn->set_timer_id(timer_id);
-        
-        ts_tcp_connections.emplace_back(tcp_conn); //加入连接对象列表
-    }
+    // 添加新的TCP连接到所属事件循环的连接表，只能在连接所属事件循环线程中调用
+    void add_new_tcp_conn(const TcpConnSP& tcp_conn);
 
-    // 更新连接超时时间
+    // 输出服务器自身的指标，在指标监听端口被抓取时调用
+    void collect_metrics(MetricsText& out) const;
+
+    // 更新连接超时时间，在连接所属事件循环的时间轮中刷新，不加锁也不分配内存
     void update_conn_timeout_time(const TcpConnSP& tcp_conn) {
-        ts_timer.cancel(tcp_conn->get_timer_id());  //定时器任务队列中取消该超时处理
-        do_clean(tcp_conn);   //从连接列表中删除
-        add_new_tcp_conn(tcp_conn); //再重新添加
+        tcp_conn->update_idle_timeout(ts_tcp_conn_timout_ms);
     }
 
     const char *ip;  // IP地址
     uint16_t port;  // 端口号
-    unique_ptr<Acceptor> ts_acceptor;  // 接受器对象
+    vector<unique_ptr<Acceptor>> ts_acceptors;  // 接受器对象，SO_REUSEPORT模式下每个连接事件循环一个
 
     EventLoop *ts_acceptor_loop;  // 接受器所属的事件循环
     vector<EventLoop*> ts_conn_loops;  // 连接事件循环对象列表
     unique_ptr<Threadpool> ts_thread_pool;  // 线程池对象
     int ts_thread_num{ 1 };  // 工作线程数量
     int ts_next_loop{ -1 };  // 下一个事件循环的索引
+    PollerType ts_poller_type;  // 连接事件循环使用的poller类型
+
+    int ts_tcp_conn_timout_ms { 60000 };  // TCP连接超时时间，默认为60000毫秒，不大于0时不剔除空闲连接
 
-    Timer ts_timer;  // 计时器对象
-    int ts_tcp_conn_timout_ms { 60000 };  // TCP连接超时时间，默认为60000毫秒
+    // 连接表，与ts_conn_loops一一对应，每个连接事件循环只在自己的线程中修改自己的连接表，不需要加锁
+    vector<unique_ptr<SlotMap<TcpConnSP>>> ts_conn_maps;
+    vector<unique_ptr<ConnLoopStats>> ts_conn_stats;  // 连接统计，与ts_conn_loops一一对应
 
-    mutex ts_mutex;  // 互斥量
-    vector<TcpConnSP> ts_tcp_connections;  // TCP连接列表
+    uint16_t ts_metrics_port{ 0 };  // 指标监听端口，0表示不开启
+    unique_ptr<MetricsExporter> ts_metrics;  // 指标监听，在接受器事件循环中处理请求
+    vector<function<void(MetricsText&)>> ts_metrics_collectors;  // 应用添加的指标输出函数
 
-    bool ts_started;  // 服务器是否已启动标志
+    bool ts_started{ false };  // 服务器是否已启动标志
+    bool ts_reuse_port{ false };  // 是否使用SO_REUSEPORT多接受器模式
+    bool ts_edge_triggered{ false };  // 连接socket是否使用边沿触发模式，默认为水平触发
 
     ConnectionCallback ts_connected_cb;  // 连接建立回调函数
     MessageCallback ts_msg_cb;  // 消息到达回调函数（创建服务器自定义的函数）
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "epoll.h"
+#include "fd_table.h"
+
+using namespace std;
+
+// 对比epoll就绪事件分发时，以fd为下标的FdTable和原先的unordered_map查找io_event并执行回调的开销
+// 用法: ./dispatch_bench [rounds]
+
+const int READY_BATCH = 64;   // 每次epoll_wait返回的就绪事件数
+
+long long g_cb_cnt = 0;
+
+//生成模拟的就绪fd序列，fd在已注册的范围内随机分布
+vector<int> make_ready_fds(int fd_num, int total)
+{
+    mt19937 mt(12345);
+    uniform_int_distribution<int> dist(0, fd_num - 1);
+    vector<int> fds(total);
+    for (auto& fd : fds) {
+        fd = dist(mt);
+    }
+    return fds;
+}
+
+template <typename Lookup>
+double run_dispatch(const vector<int>& ready_fds, int rounds, Lookup lookup)
+{
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < ready_fds.size(); i += READY_BATCH) {
+            for (size_t j = i; j < i + READY_BATCH && j < ready_fds.size(); j++) {
+                Epoll::io_event *ev = lookup(ready_fds[j]);
+                if (ev->event & EPOLLIN) {
+                    ev->read_callback();
+                }
+            }
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration<double, nano>(end - start).count();
+    return ns / (static_cast<double>(ready_fds.size()) * rounds);
+}
+
+void bench(int fd_num, int rounds)
+{
+    unordered_map<int, Epoll::io_event> ev_map;
+    FdTable<Epoll::io_event> ev_table;
+    for (int fd = 0; fd < fd_num; fd++) {
+        auto cb = [](){ g_cb_cnt++; };
+        ev_map[fd].event = EPOLLIN;
+        ev_map[fd].read_callback = cb;
+        ev_table[fd].event = EPOLLIN;
+        ev_table[fd].read_callback = cb;
+    }
+
+    vector<int> ready_fds = make_ready_fds(fd_num, 1 << 20);
+    double map_ns = run_dispatch(ready_fds, rounds, [&ev_map](int fd) {
+        auto it = ev_map.find(fd);
+        return &it->second;
+    });
+    double table_ns = run_dispatch(ready_fds, rounds, [&ev_table](int fd) {
+        return ev_table.find(fd);
+    });
+    printf("registered fds: %-7d unordered_map: %6.2f ns/event   fd table: %6.2f ns/event   speedup: %.2fx\n",
+           fd_num, map_ns, table_ns, map_ns / table_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    bench(10000, rounds);
+    bench(100000, rounds);
+    printf("callbacks executed: %lld\n", g_cb_cnt);
+    return 0;
+}
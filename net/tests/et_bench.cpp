@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// 对比水平触发(LT)和边沿触发(ET)两种模式下echo服务的吞吐量以及每个请求消耗的epoll_wait次数
+// 用法: ./et_bench [conn_num] [msg_size] [seconds] [loop_num]
+
+const char *g_ip = "127.0.0.1";
+
+//echo消息回调，收到多少数据就原样发回多少
+void bench_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    int len = ibuf->length();
+    conn->send(ibuf->get_from_buf(), len);
+    ibuf->pop(len);
+    ibuf->adjust();
+}
+
+//客户端线程：发送msg_size字节，等待全部回显后再发送下一个请求，直到停止标志被设置
+void bench_client(uint16_t port, int msg_size, atomic<bool>* stop, atomic<long long>* req_cnt)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton(g_ip, &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        PR_ERROR("connect to %s:%d failed\n", g_ip, (int)port);
+        close(fd);
+        return;
+    }
+    int op = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
+
+    vector<char> wbuf(msg_size, 'x');
+    vector<char> rbuf(msg_size);
+    while (!stop->load()) {
+        int sent = 0;
+        while (sent < msg_size) {
+            int n = write(fd, wbuf.data() + sent, msg_size - sent);
+            if (n <= 0) { close(fd); return; }
+            sent += n;
+        }
+        int recvd = 0;
+        while (recvd < msg_size) {
+            int n = read(fd, rbuf.data() + recvd, msg_size - recvd);
+            if (n <= 0) { close(fd); return; }
+            recvd += n;
+        }
+        req_cnt->fetch_add(1);
+    }
+    close(fd);
+}
+
+//对指定服务器压测seconds秒，输出吞吐量和epoll_wait次数
+void run_bench(const char *mode, TcpServer& server, uint16_t port, int conn_num, int msg_size, int seconds)
+{
+    atomic<bool> stop{ false };
+    atomic<long long> req_cnt{ 0 };
+    uint64_t poll_before = server.get_poll_cnt();
+
+    vector<thread> clients;
+    for (int i = 0; i < conn_num; i++) {
+        clients.emplace_back(bench_client, port, msg_size, &stop, &req_cnt);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    uint64_t polls = server.get_poll_cnt() - poll_before;
+    long long reqs = req_cnt.load();
+    printf("%-4s reqs: %-10lld req/s: %-12.1f epoll_wait: %-10llu epoll_wait/req: %.3f\n",
+           mode, reqs, (double)reqs / seconds, (unsigned long long)polls,
+           reqs ? (double)polls / reqs : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int conn_num = argc > 1 ? atoi(argv[1]) : 4;
+    int msg_size = argc > 2 ? atoi(argv[2]) : 64 * 1024;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int loop_num = argc > 4 ? atoi(argv[4]) : 2;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    EventLoop base_loop;
+    TcpServer lt_server(&base_loop, g_ip, 9001);
+    TcpServer et_server(&base_loop, g_ip, 9002);
+    et_server.set_edge_triggered(true);
+    for (TcpServer* server : { &lt_server, &et_server }) {
+        server->set_message_cb(bench_message_cb);
+        server->set_thread_num(loop_num);
+        server->start();
+    }
+    thread base_thread([&base_loop]() { base_loop.loop(); });
+
+    printf("conn_num: %d, msg_size: %d bytes, seconds: %d, loop_num: %d\n", conn_num, msg_size, seconds, loop_num);
+    run_bench("LT", lt_server, 9001, conn_num, msg_size, seconds);
+    run_bench("ET", et_server, 9002, conn_num, msg_size, seconds);
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
@@ -1,60 +1,91 @@
-#include "tcp_server.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../http/http_server.h"
 #include "event_loop.h"
 #include "pr.h"
 #include "log.h"
 
-class EchoServer
+// 在HttpServer上实现的压测用http服务器，每个请求都回复固定的页面
+// 请求由HttpServer增量解析，不完整的请求等待后续数据，流水线请求逐个回复
+class BenchServer
 {
 public:
-    EchoServer(EventLoop* loop, const char *ip, uint16_t port) :
-            es_loop(loop), es_server(loop, ip, port) 
+    BenchServer(EventLoop* loop, const char *ip, uint16_t port) :
+            bs_loop(loop), bs_server(loop, ip, port) 
     {
-        es_server.set_connected_cb([this](const TcpConnSP& conn){ this->echo_conneted_cb(conn); });
-        es_server.set_message_cb([this](const TcpConnSP& conn, InputBuffer* ibuf){ this->echo_message_cb(conn, ibuf); });
-        es_server.set_close_cb([this](){ this->echo_close_cb(); });
+        bs_server.set_request_cb([this](const HttpRequest& req, HttpResponse& resp){ this->on_request(req, resp); });
+        bs_server.get_tcp_server().set_connected_cb([this](const TcpConnSP& conn){ this->on_connected(conn); });
     };
 
-    ~EchoServer() {};
+    ~BenchServer() {};
+
+    void start(int thread_num) { bs_server.get_tcp_server().set_thread_num(thread_num); bs_server.start(); }
 
-    void start(int thread_num) { es_server.set_thread_num(thread_num); es_server.start(); }
+    void set_tcp_cn_timeout_ms(int ms) { bs_server.get_tcp_server().set_tcp_conn_timeout_ms(ms); }
 
-    void set_tcp_cn_timeout_ms(int ms) { es_server.set_tcp_conn_timeout_ms(ms); }
+    void set_metrics_port(uint16_t port) { bs_server.get_tcp_server().set_metrics_port(port); }
+
+    // 静态文件模式：每个请求都使用sendfile回复该文件的内容
+    bool set_static_file(const char *path) {
+        bs_file_fd = open(path, O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (bs_file_fd < 0 || fstat(bs_file_fd, &st) < 0) {
+            PR_ERROR("open static file %s failed\n", path);
+            return false;
+        }
+        bs_file_size = st.st_size;
+        return true;
+    }
 
 private:
-    void echo_conneted_cb(const TcpConnSP& conn) {
+    void on_connected(const TcpConnSP& conn) {
         PR_INFO("one connected! peer addr is %s, local socket fd is %d\n", conn->get_peer_addr(), conn->get_fd());
     }
 
-    void echo_message_cb(const TcpConnSP& conn, InputBuffer* ibuf) {
-        
-        const char *msg = ibuf->get_from_buf();
-        string msg_str(msg, msg+ibuf->length());
-        ibuf->pop(ibuf->length());
-        ibuf->adjust();
-    
-        PR_INFO("socket fd %d recv message:%s", conn->get_fd(), msg_str.c_str());
-
-        string return_msg("HTTP/1.1 200 OK\r\n\r\n"
-                "<html><head><title>my title</title><body>Hello World!</body></head></html>");
+    void on_request(const HttpRequest& req, HttpResponse& resp) {
+        LOG_DEBUG("http request: %.*s %.*s\n", (int)req.rq_method.size(), req.rq_method.data(),
+                  (int)req.rq_target.size(), req.rq_target.data());
 
-        conn->send(return_msg.c_str(), return_msg.length());
+        if (bs_file_fd >= 0) {
+            //头部从输出缓冲区发送，文件内容使用sendfile发送，不经过用户态
+            resp.set_file(bs_file_fd, 0, bs_file_size);
+            return;
+        }
+        resp.set_body("<html><head><title>my title</title><body>Hello World!</body></head></html>");
     }
 
-    void echo_close_cb() { PR_INFO("one connection closed in echo server!\n"); }
-
-    TcpServer es_server;
-    EventLoop *es_loop;
+    EventLoop *bs_loop;
+    HttpServer bs_server;
+    int bs_file_fd{ -1 };  // 静态文件模式下回复的文件
+    size_t bs_file_size{ 0 };
 };
 
 
-int main()
+// 用法: ./http_for_bench [ip] [port] [thread_num] [static_file] [metrics_port]
+// 指定static_file时进入静态文件模式，每个请求都回复该文件的内容，static_file为-时不使用
+// 指定metrics_port时在该端口提供Prometheus格式的指标
+int main(int argc, char *argv[])
 {   
     Logger::get_instance()->init(NULL);
 
+    const char *ip = argc > 1 ? argv[1] : "192.168.58.128";
+    uint16_t port = argc > 2 ? atoi(argv[2]) : 8889;
+    int thread_num = argc > 3 ? atoi(argv[3]) : 16;
+
     EventLoop base_loop;
-    EchoServer server(&base_loop, "192.168.58.128", 8889);
+    BenchServer server(&base_loop, ip, port);
+    if (argc > 4 && strcmp(argv[4], "-") != 0 && !server.set_static_file(argv[4])) {
+        return 1;
+    }
+    if (argc > 5) {
+        server.set_metrics_port(atoi(argv[5]));
+    }
     server.set_tcp_cn_timeout_ms(8000);
-    server.start(16);
+    server.start(thread_num);
     base_loop.loop();
     
     return 0;
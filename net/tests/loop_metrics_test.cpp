@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 测试事件循环的运行指标：
+// * 直方图：桶的上下界连续，相对误差不超过25%，百分位数和合并
+// * 回调和任务中的耗时分别记录在回调和任务的直方图中，等待时间覆盖空闲时间
+// * 其他线程投递的任务数、唤醒次数和每轮执行的任务数
+// * 事件循环运行时在其他线程中反复读取快照
+// 用法: ./loop_metrics_test
+
+void test_histogram()
+{
+    //每个桶的下界是前一个桶的上界加1，且桶内的值都映射到该桶
+    bool ok = MetricHistogramSnapshot::bucket_upper(METRIC_BUCKETS - 1) == UINT64_MAX;
+    for (int i = 1; i < METRIC_BUCKETS; i++) {
+        uint64_t lower = MetricHistogramSnapshot::bucket_upper(i - 1) + 1;
+        uint64_t upper = MetricHistogramSnapshot::bucket_upper(i);
+        ok &= MetricHistogram::bucket_index(lower) == i && MetricHistogram::bucket_index(upper) == i;
+    }
+    check(ok, "histogram: buckets contiguous over 64 bits");
+
+    mt19937_64 mt(7);
+    ok = true;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t v = mt() >> (mt() % 64);
+        uint64_t upper = MetricHistogramSnapshot::bucket_upper(MetricHistogram::bucket_index(v));
+        ok &= upper >= v && (upper - v) <= v / 4 + 1;
+    }
+    check(ok, "histogram: bucket upper bound within 25%");
+
+    MetricHistogram a, b;
+    for (uint64_t v = 1; v <= 1000; v++) {
+        (v % 2 ? a : b).record(v);
+    }
+    MetricHistogramSnapshot sa, sb;
+    a.snapshot(sa);
+    b.snapshot(sb);
+    sa.merge(sb);
+    uint64_t p50 = sa.percentile(50);
+    uint64_t p99 = sa.percentile(99);
+    printf("1..1000: p50 %llu, p99 %llu, max %llu, mean %.1f\n", (unsigned long long)p50,
+           (unsigned long long)p99, (unsigned long long)sa.hs_max, sa.mean());
+    check(sa.hs_count == 1000 && sa.hs_max == 1000 && sa.mean() == 500.5, "histogram: merged count, max and mean exact");
+    check(p50 >= 500 && p50 <= 625 && p99 >= 990 && sa.percentile(100) == 1000, "histogram: percentiles");
+}
+
+// 在事件循环线程中执行fn并等待完成
+template <typename F>
+void run_in_loop(EventLoop* loop, F&& fn)
+{
+    atomic<bool> done{ false };
+    loop->add_task([&fn, &done]() {
+        fn();
+        done.store(true);
+    });
+    while (!done.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+void test_phases(EventLoop* loop)
+{
+    LoopMetricsSnapshot before, after;
+    loop->get_metrics(before);
+
+    //任务中停顿20ms
+    run_in_loop(loop, []() { this_thread::sleep_for(chrono::milliseconds(20)); });
+
+    //管道可读时在回调中停顿10ms
+    int fds[2];
+    if (pipe(fds) != 0) {
+        check(false, "pipe");
+        return;
+    }
+    atomic<bool> fired{ false };
+    run_in_loop(loop, [&]() {
+        loop->add_to_poller(fds[0], EPOLLIN, [&, fd = fds[0]]() {
+            char c;
+            if (read(fd, &c, 1) == 1) {
+                this_thread::sleep_for(chrono::milliseconds(10));
+                fired = true;
+            }
+        });
+    });
+    //空闲50ms，这段时间应该计入等待时间
+    this_thread::sleep_for(chrono::milliseconds(50));
+    if (write(fds[1], "x", 1) != 1) {
+        check(false, "write pipe");
+    }
+    while (!fired.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    run_in_loop(loop, [&]() { loop->del_from_poller(fds[0]); });
+    close(fds[0]);
+    close(fds[1]);
+
+    loop->get_metrics(after);
+    after.print(stdout);
+    check(after.ls_task_hist.hs_max >= 20000000, "task time recorded in task histogram");
+    check(after.ls_callback_hist.hs_max >= 10000000 && after.ls_callback_hist.hs_max < 20000000,
+          "callback time recorded in callback histogram");
+    check(after.ls_wait_hist.hs_max >= 40000000, "idle time recorded as wait");
+    check(after.ls_events > before.ls_events && after.ls_events_hist.hs_max >= 1, "ready events counted");
+    check(after.ls_busy_ns >= 30000000 && after.busy_ratio() > 0 && after.busy_ratio() < 1, "busy time and ratio");
+}
+
+void test_tasks(EventLoop* loop)
+{
+    const int n = 10000;
+    LoopMetricsSnapshot before, after;
+    loop->get_metrics(before);
+
+    //先让事件循环忙10ms，期间投递的任务在下一轮一起执行
+    atomic<int> count{ 0 };
+    loop->add_task([]() { this_thread::sleep_for(chrono::milliseconds(10)); });
+    for (int i = 0; i < n; i++) {
+        loop->add_task([&count]() { count++; });
+    }
+    while (count.load() < n) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    loop->get_metrics(after);
+    printf("tasks: queued %llu, executed %llu, wakeups %llu, depth p99 %llu max %llu\n",
+           (unsigned long long)(after.ls_tasks_queued - before.ls_tasks_queued),
+           (unsigned long long)(after.ls_tasks - before.ls_tasks),
+           (unsigned long long)(after.ls_wakeups - before.ls_wakeups),
+           (unsigned long long)after.ls_depth_hist.percentile(99), (unsigned long long)after.ls_depth_hist.hs_max);
+    check(after.ls_tasks_queued - before.ls_tasks_queued == n + 1, "queued tasks counted");
+    check(after.ls_tasks - before.ls_tasks >= n + 1 && after.pending_tasks() == 0, "executed tasks counted, none pending");
+    check(after.ls_wakeups > before.ls_wakeups && after.ls_wakeups - before.ls_wakeups <= n / 10,
+          "wakeups counted and coalesced");
+    check(after.ls_depth_hist.hs_max >= 100, "task queue depth recorded");
+}
+
+// 事件循环运行时反复读取快照，计数只增不减
+void test_concurrent_read(EventLoop* loop)
+{
+    atomic<bool> stop{ false };
+    thread producer([&]() {
+        while (!stop.load()) {
+            loop->add_task([]() {});
+        }
+    });
+    bool ok = true;
+    LoopMetricsSnapshot last, cur;
+    loop->get_metrics(last);
+    for (int i = 0; i < 2000; i++) {
+        loop->get_metrics(cur);
+        ok &= cur.ls_iterations >= last.ls_iterations && cur.ls_tasks >= last.ls_tasks
+              && cur.ls_tasks_queued >= last.ls_tasks_queued && cur.ls_busy_ns >= last.ls_busy_ns;
+        last = cur;
+    }
+    stop = true;
+    producer.join();
+    check(ok && last.ls_iterations > 0, "snapshots while loop running are monotonic");
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    test_histogram();
+
+    EventLoop* loop = nullptr;
+    atomic<bool> ready{ false };
+    thread loop_thread([&]() {
+        EventLoop el;
+        loop = &el;
+        ready = true;
+        el.loop();
+    });
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    test_phases(loop);
+    test_tasks(loop);
+    test_concurrent_read(loop);
+
+    loop->add_task([loop]() { loop->quit(); });
+    loop_thread.join();
+
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
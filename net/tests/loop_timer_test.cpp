@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 测试事件循环的timerfd定时器：
+// * run_after在事件循环线程中按时执行，run_every按周期执行
+// * 到期前取消、在周期定时器自己的回调函数中取消
+// * 在其他线程中加入和取消定时器
+// * 加入和取消的吞吐：在事件循环线程中加入大量定时器后全部取消
+// 用法: ./loop_timer_test [timer_num]
+
+static long long now_us()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 在事件循环线程中执行fn并等待完成
+template <typename F>
+void run_in_loop(EventLoop* loop, F&& fn)
+{
+    atomic<bool> done{ false };
+    loop->add_task([&fn, &done]() {
+        fn();
+        done.store(true);
+    });
+    while (!done.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+void test_run_after(EventLoop* loop)
+{
+    atomic<bool> in_loop{ false };
+    atomic<long long> late_us{ -1 };
+    long long expect = 0;
+    run_in_loop(loop, [&]() {
+        expect = now_us() + 50000;
+        loop->run_after(50, [&, loop]() {
+            in_loop = loop->is_in_loop_thread();
+            late_us = now_us() - expect;
+        });
+    });
+    this_thread::sleep_for(chrono::milliseconds(150));
+    printf("run_after(50ms) lateness: %lld us\n", late_us.load());
+    check(late_us.load() >= 0 && late_us.load() < 50000, "run_after fires on time, never early");
+    check(in_loop.load(), "run_after callback runs in loop thread");
+}
+
+void test_run_every(EventLoop* loop)
+{
+    atomic<int> count{ 0 };
+    TimerId id = 0;
+    run_in_loop(loop, [&]() {
+        id = loop->run_every(10, [&count]() { count++; });
+    });
+    this_thread::sleep_for(chrono::milliseconds(205));
+    run_in_loop(loop, [&]() { loop->cancel(id); });
+    int fired = count.load();
+    this_thread::sleep_for(chrono::milliseconds(50));
+    printf("run_every(10ms) for 205ms fired %d times\n", fired);
+    check(fired >= 18 && fired <= 21, "run_every fires once per period");
+    check(count.load() == fired, "run_every stops after cancel");
+}
+
+void test_cancel(EventLoop* loop)
+{
+    atomic<int> fired{ 0 };
+    run_in_loop(loop, [&]() {
+        TimerId id = loop->run_after(20, [&fired]() { fired++; });
+        loop->cancel(id);
+        loop->cancel(id);   //重复取消什么也不做
+    });
+
+    //在周期定时器自己的回调函数中取消
+    atomic<int> self_count{ 0 };
+    TimerId self_id = 0;
+    run_in_loop(loop, [&]() {
+        self_id = loop->run_every(5, [&, loop]() {
+            if (++self_count == 3) {
+                loop->cancel(self_id);
+            }
+        });
+    });
+    this_thread::sleep_for(chrono::milliseconds(100));
+    check(fired.load() == 0, "cancel before expiration");
+    check(self_count.load() == 3, "cancel inside own periodic callback");
+}
+
+void test_cross_thread(EventLoop* loop)
+{
+    atomic<int> fired{ 0 };
+    atomic<int> in_loop{ 0 };
+    const int threads = 4;
+    const int per_thread = 100;
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, loop]() {
+            for (int i = 0; i < per_thread; i++) {
+                TimerId id = loop->run_after(10 + i % 10, [&, loop]() {
+                    fired++;
+                    in_loop += loop->is_in_loop_thread();
+                });
+                if (i % 2) {
+                    loop->cancel(id);  //其他线程中取消，与加入按顺序在事件循环线程中执行
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    check(fired.load() == threads * per_thread / 2, "cross-thread add and cancel");
+    check(in_loop.load() == fired.load(), "cross-thread timers run in loop thread");
+}
+
+void bench_add_cancel(EventLoop* loop, int timer_num)
+{
+    double add_ns = 0;
+    double cancel_ns = 0;
+    run_in_loop(loop, [&]() {
+        vector<TimerId> ids(timer_num);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < timer_num; i++) {
+            ids[i] = loop->run_after(60000 + i % 1000, []() {});
+        }
+        add_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / timer_num;
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < timer_num; i++) {
+            loop->cancel(ids[i]);
+        }
+        cancel_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / timer_num;
+    });
+    printf("%d timers in loop thread: run_after %.1f ns/op, cancel %.1f ns/op\n", timer_num, add_ns, cancel_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    int timer_num = argc > 1 ? atoi(argv[1]) : 100000;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    EventLoop* loop = nullptr;
+    atomic<bool> ready{ false };
+    thread loop_thread([&]() {
+        EventLoop el;
+        loop = &el;
+        ready = true;
+        el.loop();
+    });
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    test_run_after(loop);
+    test_run_every(loop);
+    test_cancel(loop);
+    test_cross_thread(loop);
+    bench_add_cancel(loop, timer_num);
+
+    loop->add_task([loop]() { loop->quit(); });
+    loop_thread.join();
+
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
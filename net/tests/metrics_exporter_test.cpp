@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "metrics_exporter.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 测试TcpServer内置的指标监听端口：
+// * 输出符合Prometheus文本格式：每个指标先有HELP和TYPE，样本值都是数字
+// * 连接数、接受的连接数、收发字节数与客户端实际的连接和数据一致
+// * 包含事件循环、定时器、内存池、线程池和日志的指标，应用添加的指标
+// * 非GET请求返回405，大量连续抓取不泄漏连接
+// 用法: ./metrics_exporter_test
+
+static int connect_to(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 发送请求并读取到连接关闭为止
+static string http_get(uint16_t port, const char* request)
+{
+    int fd = connect_to(port);
+    if (fd < 0) {
+        return "";
+    }
+    if (write(fd, request, strlen(request)) < 0) {
+        close(fd);
+        return "";
+    }
+    string resp;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof buf)) > 0) {
+        resp.append(buf, n);
+    }
+    close(fd);
+    return resp;
+}
+
+// 解析指标文本，key为带标签的样本名；检查每个样本之前都有对应的HELP和TYPE
+static bool parse_metrics(const string& body, map<string, double>& samples)
+{
+    set<string> typed;
+    set<string> helped;
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t end = body.find('\n', pos);
+        if (end == string::npos) {
+            return false;  //每行都以换行结束
+        }
+        string line = body.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.compare(0, 7, "# HELP ") == 0) {
+            helped.insert(line.substr(7, line.find(' ', 7) - 7));
+            continue;
+        }
+        if (line.compare(0, 7, "# TYPE ") == 0) {
+            size_t sp = line.find(' ', 7);
+            string type = line.substr(sp + 1);
+            if (type != "counter" && type != "gauge") {
+                return false;
+            }
+            typed.insert(line.substr(7, sp - 7));
+            continue;
+        }
+        size_t sp = line.rfind(' ');
+        string key = line.substr(0, sp);
+        string name = key.substr(0, key.find('{'));
+        char *num_end = nullptr;
+        double value = strtod(line.c_str() + sp + 1, &num_end);
+        if (*num_end != '\0' || !typed.count(name) || !helped.count(name)) {
+            return false;
+        }
+        samples[key] = value;
+    }
+    return true;
+}
+
+static double sum_of(const map<string, double>& samples, const string& name)
+{
+    double sum = 0;
+    for (auto& kv : samples) {
+        if (kv.first == name || kv.first.compare(0, name.size() + 1, name + "{") == 0) {
+            sum += kv.second;
+        }
+    }
+    return sum;
+}
+
+static bool scrape(uint16_t port, map<string, double>& samples)
+{
+    string resp = http_get(port, "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    size_t body = resp.find("\r\n\r\n");
+    if (resp.compare(0, 15, "HTTP/1.1 200 OK") != 0 || body == string::npos) {
+        return false;
+    }
+    samples.clear();
+    return parse_metrics(resp.substr(body + 4), samples);
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+    pr_level = PR_LEVEL_ERROR;
+
+    uint16_t port = 18961;
+    uint16_t metrics_port = 18962;
+    atomic<bool> ready{ false };
+    thread server_thread([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, "127.0.0.1", port);
+        server.set_thread_num(2);
+        server.set_message_cb([](const TcpConnSP& conn, InputBuffer* ibuf) {
+            conn->send(ibuf->get_from_buf(), ibuf->length());
+            ibuf->pop(ibuf->length());
+            ibuf->adjust();
+        });
+        server.set_metrics_port(metrics_port);
+        server.add_metrics_collector([](MetricsText& out) {
+            out.header("app_requests_total", "counter", "Requests handled by the application.");
+            out.sample("app_requests_total", "route=\"/\"", (uint64_t)42);
+        });
+        server.start();
+        ready = true;
+        loop.loop();
+    });
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    map<string, double> before;
+    check(scrape(metrics_port, before), "scrape returns valid Prometheus text");
+    check(sum_of(before, "reactor_connections") == 0 && before.count("reactor_connections{loop=\"1\"}"),
+          "no connections, one sample per loop");
+
+    //5个客户端各回显1000字节，然后关闭其中2个
+    const int clients = 5;
+    const int bytes = 1000;
+    vector<int> fds;
+    string data(bytes, 'm');
+    bool echoed = true;
+    for (int i = 0; i < clients; i++) {
+        int fd = connect_to(port);
+        fds.push_back(fd);
+        echoed &= fd >= 0 && write(fd, data.data(), data.size()) == bytes;
+        int got = 0;
+        char buf[bytes];
+        while (echoed && got < bytes) {
+            ssize_t n = read(fd, buf, sizeof buf);
+            if (n <= 0) {
+                echoed = false;
+                break;
+            }
+            got += n;
+        }
+    }
+    check(echoed, "echo clients connected");
+    close(fds[0]);
+    close(fds[1]);
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    map<string, double> after;
+    check(scrape(metrics_port, after), "scrape after traffic");
+    check(sum_of(after, "reactor_connections") == clients - 2, "open connections counted");
+    check(sum_of(after, "reactor_accepted_connections_total") - sum_of(before, "reactor_accepted_connections_total") == clients,
+          "accepted connections counted");
+    check(sum_of(after, "reactor_closed_connections_total") == 2, "closed connections counted");
+    check(sum_of(after, "reactor_received_bytes_total") == clients * bytes
+          && sum_of(after, "reactor_sent_bytes_total") == clients * bytes, "bytes in and out counted");
+    check(after.count("reactor_loop_iterations_total{loop=\"acceptor\"}")
+          && sum_of(after, "reactor_loop_events_total") > 0 && after.count("reactor_timers_pending{loop=\"0\"}"),
+          "loop metrics and timer counts present");
+    check(sum_of(after, "reactor_timers_pending") >= 2, "idle timeout timers counted");
+    check(after.count("reactor_mempool_chunks{size=\"4096\",state=\"in_use\"}")
+          && after["reactor_mempool_chunks_created{size=\"4096\"}"] >= after["reactor_mempool_chunks{size=\"4096\",state=\"pooled\"}"]
+          && after.count("reactor_mempool_oversize_failures_total"),
+          "mempool per-class chunks present");
+    check(after.count("reactor_threadpool_pending_tasks") && after.count("reactor_log_dropped_total"),
+          "threadpool and logger metrics present");
+    check(after["app_requests_total{route=\"/\"}"] == 42, "application collector included");
+
+    string resp = http_get(metrics_port, "POST /metrics HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    check(resp.compare(0, 12, "HTTP/1.1 405") == 0, "non-GET request rejected");
+
+    //连续抓取，服务器端的抓取连接都会关闭
+    bool ok = true;
+    auto start = chrono::steady_clock::now();
+    const int scrapes = 500;
+    for (int i = 0; i < scrapes && ok; i++) {
+        ok = scrape(metrics_port, after);
+    }
+    double us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / (double)scrapes;
+    printf("scrape round trip: %.1f us, %zu samples\n", us, after.size());
+    check(ok, "repeated scrapes succeed");
+    int fd = connect_to(metrics_port);
+    check(fd >= 0, "metrics listener still accepting");
+    close(fd);
+
+    for (size_t i = 2; i < fds.size(); i++) {
+        close(fds[i]);
+    }
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+    }
+    else {
+        printf("all checks passed\n");
+    }
+    //服务器的事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(g_failed ? 1 : 0);
+}
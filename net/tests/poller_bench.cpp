@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// 对比epoll和io_uring两种poller后端下echo服务和http_for_bench风格http服务的吞吐量
+// 两种后端只是就绪通知的方式不同，每个请求的读写系统调用相同
+// 用法: ./poller_bench [conn_num] [seconds] [loop_num]
+
+const char *g_ip = "127.0.0.1";
+const string g_http_request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+const string g_http_response = "HTTP/1.1 200 OK\r\n\r\n"
+        "<html><head><title>my title</title><body>Hello World!</body></head></html>";
+const int g_echo_size = 512;
+
+//echo消息回调
+void echo_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    int len = ibuf->length();
+    conn->send(ibuf->get_from_buf(), len);
+    ibuf->pop(len);
+    ibuf->adjust();
+}
+
+//与http_for_bench相同的消息回调，收到数据后回复固定的http响应
+void http_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    ibuf->pop(ibuf->length());
+    ibuf->adjust();
+    conn->send(g_http_response.c_str(), g_http_response.length());
+}
+
+//客户端线程：发送请求，读取resp_len字节的响应后发送下一个请求
+void bench_client(uint16_t port, const string* request, int resp_len, atomic<bool>* stop, atomic<long long>* req_cnt)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton(g_ip, &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        PR_ERROR("connect to %s:%d failed\n", g_ip, (int)port);
+        close(fd);
+        return;
+    }
+    int op = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
+
+    vector<char> rbuf(resp_len);
+    while (!stop->load()) {
+        if (write(fd, request->data(), request->size()) != (ssize_t)request->size()) {
+            break;
+        }
+        int recvd = 0;
+        while (recvd < resp_len) {
+            int n = read(fd, rbuf.data() + recvd, resp_len - recvd);
+            if (n <= 0) { close(fd); return; }
+            recvd += n;
+        }
+        req_cnt->fetch_add(1);
+    }
+    close(fd);
+}
+
+void run_bench(const char *name, TcpServer& server, uint16_t port, const string& request, int resp_len,
+               int conn_num, int seconds)
+{
+    atomic<bool> stop{ false };
+    atomic<long long> req_cnt{ 0 };
+    uint64_t poll_before = server.get_poll_cnt();
+
+    vector<thread> clients;
+    for (int i = 0; i < conn_num; i++) {
+        clients.emplace_back(bench_client, port, &request, resp_len, &stop, &req_cnt);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    uint64_t polls = server.get_poll_cnt() - poll_before;
+    long long reqs = req_cnt.load();
+    printf("%-16s reqs: %-10lld req/s: %-12.1f poll calls: %-10llu poll calls/req: %.3f\n",
+           name, reqs, (double)reqs / seconds, (unsigned long long)polls,
+           reqs ? (double)polls / reqs : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int conn_num = argc > 1 ? atoi(argv[1]) : 4;
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    int loop_num = argc > 3 ? atoi(argv[3]) : 2;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    EventLoop base_loop;
+    TcpServer epoll_echo(&base_loop, g_ip, 9011, PollerType::Epoll);
+    TcpServer uring_echo(&base_loop, g_ip, 9012, PollerType::IoUring);
+    TcpServer epoll_http(&base_loop, g_ip, 9013, PollerType::Epoll);
+    TcpServer uring_http(&base_loop, g_ip, 9014, PollerType::IoUring);
+    epoll_echo.set_message_cb(echo_message_cb);
+    uring_echo.set_message_cb(echo_message_cb);
+    epoll_http.set_message_cb(http_message_cb);
+    uring_http.set_message_cb(http_message_cb);
+    for (TcpServer* server : { &epoll_echo, &uring_echo, &epoll_http, &uring_http }) {
+        server->set_thread_num(loop_num);
+        server->start();
+    }
+    thread base_thread([&base_loop]() { base_loop.loop(); });
+
+    string echo_request(g_echo_size, 'x');
+    printf("conn_num: %d, seconds: %d, loop_num: %d, echo msg size: %d bytes\n", conn_num, seconds, loop_num, g_echo_size);
+    run_bench("echo/epoll", epoll_echo, 9011, echo_request, g_echo_size, conn_num, seconds);
+    run_bench("echo/io_uring", uring_echo, 9012, echo_request, g_echo_size, conn_num, seconds);
+    run_bench("http/epoll", epoll_http, 9013, g_http_request, g_http_response.length(), conn_num, seconds);
+    run_bench("http/io_uring", uring_http, 9014, g_http_request, g_http_response.length(), conn_num, seconds);
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
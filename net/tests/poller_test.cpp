@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "poller.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 测试两种poller后端的触发方式与epoll一致：
+// * 水平触发：每次回调只读1字节，数据没有读完时下一次poll仍然通知，读完后不再通知
+// * 边沿触发(EPOLLET)：没有新数据时只通知一次
+// * 增删写事件后读事件的触发方式不变
+// * 负数fd（已经关闭的连接）注册和删除事件时被拒绝，不访问事件表
+// * 水平触发的连接（TcpServer默认）每次可读事件只读一次，事件循环暂停时一次到达的256KB数据
+//   在没有写事件变化的情况下（收齐之前不回复）也能全部读到
+// * 文件描述符耗尽时，等待accept的连接被空闲fd逐个拒绝，监听的事件循环不空转
+// 用法: ./poller_test
+
+// 向pipe写入4字节，每次读事件只读1字节，返回poll次数内的读事件次数
+static int count_reads(Poller* poller, int event, int polls)
+{
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK) != 0) {
+        return -1;
+    }
+    int calls = 0;
+    poller->add_event(fds[0], event, [&calls, fd = fds[0]]() {
+        char c;
+        if (read(fd, &c, 1) == 1) {
+            calls++;
+        }
+    });
+    if (write(fds[1], "abcd", 4) != 4) {
+        calls = -1;
+    }
+    for (int i = 0; i < polls; i++) {
+        poller->poll(10);
+    }
+    poller->del_event(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+    return calls;
+}
+
+static void test_trigger(PollerType type)
+{
+    shared_ptr<Poller> poller = Poller::create(type);
+    string name = poller->name();
+    if (type == PollerType::IoUring && name != "io_uring") {
+        printf("io_uring is not supported, skip\n");
+        return;
+    }
+
+    check(count_reads(poller.get(), EPOLLIN, 8) == 4, (name + ": level triggered reads until drained").c_str());
+    check(count_reads(poller.get(), EPOLLIN | EPOLLET, 8) == 1, (name + ": edge triggered notifies once").c_str());
+
+    //读事件注册后增删写事件
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) != 0) {
+        check(false, "socketpair");
+        return;
+    }
+    int reads = 0;
+    int writes = 0;
+    poller->add_event(sv[0], EPOLLIN, [&reads, fd = sv[0]]() {
+        char c;
+        if (read(fd, &c, 1) == 1) {
+            reads++;
+        }
+    });
+    poller->add_event(sv[0], EPOLLOUT, [&writes]() { writes++; });
+    poller->poll(10);
+    poller->del_event(sv[0], EPOLLOUT);
+    int writes_before = writes;
+    if (write(sv[1], "xyz", 3) != 3) {
+        check(false, "write socketpair");
+    }
+    for (int i = 0; i < 8; i++) {
+        poller->poll(10);
+    }
+    check(writes_before > 0 && writes == writes_before, (name + ": write event added and removed").c_str());
+    check(reads == 3, (name + ": level triggered after event update").c_str());
+    poller->del_event(sv[0]);
+    close(sv[0]);
+    close(sv[1]);
+
+    //负数fd的回调不会被调用，之后注册的fd照常通知
+    int neg_calls = 0;
+    int pipe_calls = 0;
+    int pfds[2];
+    if (pipe2(pfds, O_NONBLOCK) != 0) {
+        check(false, "pipe");
+        return;
+    }
+    poller->add_event(-1, EPOLLOUT, [&neg_calls]() { neg_calls++; });
+    poller->add_event(pfds[1], EPOLLOUT, [&pipe_calls]() { pipe_calls++; });
+    poller->poll(10);
+    poller->del_event(-1, EPOLLOUT);
+    poller->del_event(-1);
+    poller->del_event(pfds[1]);
+    close(pfds[0]);
+    close(pfds[1]);
+    check(neg_calls == 0 && pipe_calls == 1, (name + ": negative fd rejected").c_str());
+
+    //没有就绪的fd时poll阻塞到超时，先处理掉前面删除fd时取消请求产生的cqe
+    poller->poll(0);
+    poller->poll(0);
+    auto start = chrono::steady_clock::now();
+    int cnt = poller->poll(50);
+    auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    check(cnt == 0 && ms >= 40, (name + ": idle poll blocks until timeout").c_str());
+}
+
+const size_t BURST_SIZE = 256 * 1024;
+
+// 事件循环暂停时发送256KB数据，恢复后一次可读事件读不完，水平触发需要继续通知才能全部读到
+// 服务器收齐之后才回复，中间不修改写事件，不会因为修改事件而重新检查到可读
+static void test_burst(PollerType type, uint16_t port)
+{
+    atomic<bool> ready{ false };
+    TcpServer* echo_server = nullptr;
+    thread server_thread([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, "127.0.0.1", port, type);
+        server.set_thread_num(1);
+        server.set_message_cb([](const TcpConnSP& conn, InputBuffer* ibuf) {
+            if ((size_t)ibuf->length() >= BURST_SIZE) {
+                ibuf->pop(ibuf->length());
+                ibuf->adjust();
+                conn->send("done", 4);
+            }
+        });
+        server.start();
+        echo_server = &server;
+        ready = true;
+        loop.loop();
+    });
+    server_thread.detach();
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        check(false, "connect echo server");
+        close(fd);
+        return;
+    }
+    struct timeval tv = { 3, 0 };  //回显停住时读超时失败，而不是一直阻塞
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    int bufsize = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    this_thread::sleep_for(chrono::milliseconds(50));  //等待连接注册到连接事件循环
+
+    //连接事件循环暂停200ms，期间数据全部写入socket缓冲区
+    echo_server->get_loop(0)->add_task([]() { this_thread::sleep_for(chrono::milliseconds(200)); });
+    this_thread::sleep_for(chrono::milliseconds(20));
+    string data(BURST_SIZE, 'e');
+    bool ok = send(fd, data.data(), data.size(), MSG_DONTWAIT) == (ssize_t)data.size();
+
+    char reply[8];
+    ok = ok && recv(fd, reply, sizeof reply, MSG_WAITALL) == 4 && memcmp(reply, "done", 4) == 0;
+    close(fd);
+    string what = string(type == PollerType::IoUring ? "io_uring" : "epoll") + ": level triggered read of a 256KB burst";
+    check(ok, what.c_str());
+}
+
+const int EMFILE_CLIENTS = 8;
+const rlim_t EMFILE_NOFILE = 512;
+
+// 把进程的文件描述符上限降到EMFILE_NOFILE，服务器启动后用dup占满剩余的fd，服务器accept时得到EMFILE
+// io_uring的accept在提交时读取上限，所以先降低上限再启动服务器
+// 每个客户端都应该被关闭（读到EOF），期间接受器所在事件循环的等待次数应该很少
+static void test_accept_emfile(PollerType type, uint16_t port)
+{
+    struct rlimit old_limit;
+    getrlimit(RLIMIT_NOFILE, &old_limit);
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = EMFILE_NOFILE;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    atomic<bool> ready{ false };
+    EventLoop* accept_loop = nullptr;
+    thread server_thread([&]() {
+        EventLoop loop(type);
+        TcpServer server(&loop, "127.0.0.1", port, type);
+        server.set_thread_num(1);
+        server.start();
+        accept_loop = &loop;
+        ready = true;
+        loop.loop();
+    });
+    server_thread.detach();
+    while (!ready.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::milliseconds(20));
+
+    //先创建客户端socket，占满fd之后connect不需要新的fd
+    int fds[EMFILE_CLIENTS];
+    for (int i = 0; i < EMFILE_CLIENTS; i++) {
+        fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+    }
+    vector<int> fillers;
+    int filler;
+    while ((filler = dup(0)) >= 0) {
+        fillers.push_back(filler);
+    }
+
+    uint64_t polls_before = accept_loop->get_poll_cnt();
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton("127.0.0.1", &addr.sin_addr);
+    int closed = 0;
+    for (int i = 0; i < EMFILE_CLIENTS; i++) {
+        if (connect(fds[i], (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            continue;
+        }
+        struct timeval tv = { 2, 0 };
+        setsockopt(fds[i], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char c;
+        if (recv(fds[i], &c, 1, 0) == 0) {
+            closed++;
+        }
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    uint64_t polls = accept_loop->get_poll_cnt() - polls_before;
+
+    for (int fd : fillers) {
+        close(fd);
+    }
+    for (int i = 0; i < EMFILE_CLIENTS; i++) {
+        close(fds[i]);
+    }
+    setrlimit(RLIMIT_NOFILE, &old_limit);
+
+    string name = accept_loop->get_poller_name();
+    check(closed == EMFILE_CLIENTS, (name + ": connections dropped on EMFILE").c_str());
+    check(polls < 200, (name + ": no busy loop on EMFILE").c_str());
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+    pr_level = PR_LEVEL_ERROR;
+
+    test_trigger(PollerType::Epoll);
+    test_trigger(PollerType::IoUring);
+    test_burst(PollerType::Epoll, 18971);
+    test_burst(PollerType::IoUring, 18972);
+    test_accept_emfile(PollerType::Epoll, 18973);
+    test_accept_emfile(PollerType::IoUring, 18974);
+
+    if (g_failed) {
+        PR_ERROR("%d checks failed\n", g_failed);
+    }
+    else {
+        printf("all checks passed\n");
+    }
+    //服务器的事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(g_failed ? 1 : 0);
+}
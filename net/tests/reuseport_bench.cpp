@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// 对比单接受器轮询分发和SO_REUSEPORT多接受器两种模式下短连接的建立速率
+// 每个客户端循环执行：建立连接、发送一个http请求、读取响应、关闭连接（webbench风格）
+// 用法: ./reuseport_bench [client_num] [seconds] [loop_num]
+
+const char *g_ip = "127.0.0.1";
+const string g_http_request = "GET / HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+const string g_http_response = "HTTP/1.1 200 OK\r\n\r\n"
+        "<html><head><title>my title</title><body>Hello World!</body></head></html>";
+
+//与http_for_bench相同的消息回调，收到数据后回复固定的http响应
+void http_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    ibuf->pop(ibuf->length());
+    ibuf->adjust();
+    conn->send(g_http_response.c_str(), g_http_response.length());
+}
+
+//客户端线程：每个请求使用一个新连接
+void bench_client(uint16_t port, atomic<bool>* stop, atomic<long long>* conn_cnt)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton(g_ip, &addr.sin_addr);
+
+    int resp_len = g_http_response.length();
+    vector<char> rbuf(resp_len);
+    while (!stop->load()) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            PR_ERROR("connect to %s:%d failed\n", g_ip, (int)port);
+            close(fd);
+            return;
+        }
+        if (write(fd, g_http_request.data(), g_http_request.size()) != (ssize_t)g_http_request.size()) {
+            close(fd);
+            break;
+        }
+        int recvd = 0;
+        while (recvd < resp_len) {
+            int n = read(fd, rbuf.data() + recvd, resp_len - recvd);
+            if (n <= 0) { break; }
+            recvd += n;
+        }
+        close(fd);
+        if (recvd == resp_len) {
+            conn_cnt->fetch_add(1);
+        }
+    }
+}
+
+void run_bench(const char *name, TcpServer& server, uint16_t port, int client_num, int seconds)
+{
+    atomic<bool> stop{ false };
+    atomic<long long> conn_cnt{ 0 };
+    uint64_t poll_before = server.get_poll_cnt();
+
+    vector<thread> clients;
+    for (int i = 0; i < client_num; i++) {
+        clients.emplace_back(bench_client, port, &stop, &conn_cnt);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    uint64_t polls = server.get_poll_cnt() - poll_before;
+    long long conns = conn_cnt.load();
+    printf("%-12s conns: %-10lld conn/s: %-12.1f conn loop poll calls/conn: %.3f\n",
+           name, conns, (double)conns / seconds, conns ? (double)polls / conns : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int client_num = argc > 1 ? atoi(argv[1]) : 4;
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    int loop_num = argc > 3 ? atoi(argv[3]) : 2;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    EventLoop base_loop;
+    TcpServer single_server(&base_loop, g_ip, 9021);
+    TcpServer reuse_server(&base_loop, g_ip, 9022);
+    reuse_server.set_reuse_port(true);
+    for (TcpServer* server : { &single_server, &reuse_server }) {
+        server->set_message_cb(http_message_cb);
+        server->set_thread_num(loop_num);
+        server->start();
+    }
+    thread base_thread([&base_loop]() { base_loop.loop(); });
+    this_thread::sleep_for(chrono::milliseconds(100));  //等待各事件循环开始监听
+
+    printf("client_num: %d, seconds: %d, loop_num: %d\n", client_num, seconds, loop_num);
+    run_bench("single", single_server, 9021, client_num, seconds);
+    run_bench("reuseport", reuse_server, 9022, client_num, seconds);
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
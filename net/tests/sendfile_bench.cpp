@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server.h"
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// 对比静态文件的两种发送方式的吞吐量
+// * send：文件内容读到内存，每个响应复制到输出缓冲区再write
+// * send_file：每个响应使用sendfile从内核直接发送
+// 响应由send发送的头部、文件内容、send发送的尾部组成，第一个响应会校验数据的顺序和内容
+// 用法: ./sendfile_bench [file_kb] [conn_num] [seconds] [loop_num]
+
+const char *g_ip = "127.0.0.1";
+const string g_request = "GET /file HTTP/1.1\r\n\r\n";
+const string g_trailer = "<end>";
+int g_file_fd = -1;
+int g_file_size = 0;
+string g_file_content;
+string g_header;
+
+void copy_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    ibuf->pop(ibuf->length());
+    ibuf->adjust();
+    conn->send(g_header.c_str(), g_header.length());
+    conn->send(g_file_content.c_str(), g_file_size);
+    conn->send(g_trailer.c_str(), g_trailer.length());
+}
+
+void sendfile_message_cb(const TcpConnSP& conn, InputBuffer* ibuf)
+{
+    ibuf->pop(ibuf->length());
+    ibuf->adjust();
+    conn->send(g_header.c_str(), g_header.length());
+    conn->send_file(g_file_fd, 0, g_file_size);
+    conn->send(g_trailer.c_str(), g_trailer.length());
+}
+
+//客户端线程：发送请求，读取完整响应后发送下一个请求
+void bench_client(uint16_t port, atomic<bool>* stop, atomic<long long>* req_cnt, atomic<bool>* verified)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_aton(g_ip, &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        PR_ERROR("connect to %s:%d failed\n", g_ip, (int)port);
+        close(fd);
+        return;
+    }
+    int op = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &op, sizeof(op));
+
+    int resp_len = g_header.length() + g_file_size + g_trailer.length();
+    vector<char> rbuf(resp_len);
+    while (!stop->load()) {
+        if (write(fd, g_request.data(), g_request.size()) != (ssize_t)g_request.size()) {
+            break;
+        }
+        int recvd = 0;
+        while (recvd < resp_len) {
+            int n = read(fd, rbuf.data() + recvd, resp_len - recvd);
+            if (n <= 0) { close(fd); return; }
+            recvd += n;
+        }
+        if (!verified->exchange(true)) {
+            string expect = g_header + g_file_content + g_trailer;
+            if (memcmp(rbuf.data(), expect.data(), resp_len) != 0) {
+                PR_ERROR("response content mismatch on port %d\n", (int)port);
+                exit(1);
+            }
+        }
+        req_cnt->fetch_add(1);
+    }
+    close(fd);
+}
+
+void run_bench(const char *name, uint16_t port, int conn_num, int seconds)
+{
+    atomic<bool> stop{ false };
+    atomic<bool> verified{ false };
+    atomic<long long> req_cnt{ 0 };
+
+    vector<thread> clients;
+    for (int i = 0; i < conn_num; i++) {
+        clients.emplace_back(bench_client, port, &stop, &req_cnt, &verified);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+
+    long long reqs = req_cnt.load();
+    printf("%-10s reqs: %-8lld req/s: %-10.1f MB/s: %.1f\n", name, reqs, (double)reqs / seconds,
+           (double)reqs * g_file_size / seconds / (1024 * 1024));
+}
+
+int main(int argc, char *argv[])
+{
+    int file_kb = argc > 1 ? atoi(argv[1]) : 1024;
+    int conn_num = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    int loop_num = argc > 4 ? atoi(argv[4]) : 2;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    //生成测试文件，打开后立即删除，进程退出时自动释放
+    char path[] = "/tmp/sendfile_bench_XXXXXX";
+    g_file_fd = mkstemp(path);
+    unlink(path);
+    g_file_size = file_kb * 1024;
+    g_file_content.resize(g_file_size);
+    for (int i = 0; i < g_file_size; i++) {
+        g_file_content[i] = 'a' + i % 26;
+    }
+    if (write(g_file_fd, g_file_content.data(), g_file_size) != g_file_size) {
+        PR_ERROR("write bench file failed\n");
+        return 1;
+    }
+    g_header = "HTTP/1.1 200 OK\r\nContent-Length: " + to_string(g_file_size + g_trailer.length()) + "\r\n\r\n";
+
+    EventLoop base_loop;
+    TcpServer copy_server(&base_loop, g_ip, 9031);
+    TcpServer sendfile_server(&base_loop, g_ip, 9032);
+    copy_server.set_message_cb(copy_message_cb);
+    sendfile_server.set_message_cb(sendfile_message_cb);
+    for (TcpServer* server : { &copy_server, &sendfile_server }) {
+        server->set_thread_num(loop_num);
+        server->start();
+    }
+    thread base_thread([&base_loop]() { base_loop.loop(); });
+
+    printf("file size: %d KB, conn_num: %d, seconds: %d, loop_num: %d\n", file_kb, conn_num, seconds, loop_num);
+    run_bench("send", 9031, conn_num, seconds);
+    run_bench("send_file", 9032, conn_num, seconds);
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
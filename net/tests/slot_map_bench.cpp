@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "slot_map.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// 对比连接列表的两种实现在不同连接数下删除并重新加入一个连接的耗时
+// * vector：原来的实现，线性查找后从中间删除，再加到末尾
+// * slot map：按槽位下标删除，插入复用空闲槽位
+// 用法: ./slot_map_bench [op_num]
+
+typedef shared_ptr<int> Conn;
+
+double bench_vector(int conn_num, int op_num)
+{
+    vector<Conn> conns;
+    vector<Conn> conn_list;
+    for (int i = 0; i < conn_num; i++) {
+        conns.emplace_back(make_shared<int>(i));
+        conn_list.emplace_back(conns[i]);
+    }
+
+    mt19937 rng(1);
+    auto start = steady_clock::now();
+    for (int n = 0; n < op_num; n++) {
+        const Conn& conn = conns[rng() % conn_num];
+        for (auto it = conn_list.begin(); it != conn_list.end(); ++it) {
+            if (*it == conn) {
+                conn_list.erase(it);
+                break;
+            }
+        }
+        conn_list.emplace_back(conn);
+    }
+    return duration<double, nano>(steady_clock::now() - start).count() / op_num;
+}
+
+double bench_slot_map(int conn_num, int op_num)
+{
+    vector<Conn> conns;
+    vector<uint32_t> slots;
+    SlotMap<Conn> conn_map;
+    for (int i = 0; i < conn_num; i++) {
+        conns.emplace_back(make_shared<int>(i));
+        slots.emplace_back(conn_map.insert(conns[i]));
+    }
+
+    mt19937 rng(1);
+    auto start = steady_clock::now();
+    for (int n = 0; n < op_num; n++) {
+        int i = rng() % conn_num;
+        conn_map.erase(slots[i]);
+        slots[i] = conn_map.insert(conns[i]);
+    }
+    return duration<double, nano>(steady_clock::now() - start).count() / op_num;
+}
+
+int main(int argc, char *argv[])
+{
+    int op_num = argc > 1 ? atoi(argv[1]) : 20000;
+
+    for (int conn_num : { 1000, 10000, 50000 }) {
+        double vector_ns = bench_vector(conn_num, op_num);
+        double map_ns = bench_slot_map(conn_num, op_num * 50);
+        printf("conns: %-6d vector: %-10.1f ns/op  slot map: %-6.1f ns/op  speedup: %.0fx\n",
+               conn_num, vector_ns, map_ns, vector_ns / map_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "event_loop.h"
+#include "object_cache.h"
+#include "threadpool.h"
+#include "pr.h"
+#include "log.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 统计投递任务时的内存分配次数：替换全局operator new，分别测试InlineTask、EventLoop跨线程投递和Threadpool::execute，
+// 预热之后的稳定状态下每个任务的分配次数应该为0
+// 用法: ./task_alloc_test [tasks_per_round]
+
+static atomic<long long> g_alloc_cnt{ 0 };
+
+void* operator new(size_t size)
+{
+    g_alloc_cnt.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    g_alloc_cnt.fetch_add(1, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+const int WARMUP_ROUNDS = 20;   // 预热轮数，让任务节点缓存和队列容量达到稳定状态
+const int MEASURE_ROUNDS = 50;  // 统计轮数
+
+void report(const char* name, long long allocs, long long tasks, long long expect_max)
+{
+    bool ok = allocs <= expect_max;
+    printf("%-36s tasks: %-9lld allocs: %-7lld allocs/task: %.4f  %s\n", name, tasks, allocs,
+           static_cast<double>(allocs) / tasks, ok ? "ok" : "FAILED");
+    if (!ok) {
+        g_failed++;
+    }
+}
+
+// 任务捕获的内容与TcpConnection投递的任务相当：一个shared_ptr加上少量参数
+void test_inline_task(int task_num)
+{
+    auto counter = make_shared<long long>(0);
+    auto owned = make_unique<int>(1);
+    long long before = g_alloc_cnt.load();
+    for (int i = 0; i < task_num; i++) {
+        InlineTask task([counter, i]() { *counter += i; });
+        InlineTask moved = move(task);
+        moved();
+    }
+    //只能移动的捕获
+    InlineTask unique_task([owned = move(owned), counter]() { *counter += *owned; });
+    InlineTask unique_moved = move(unique_task);
+    unique_moved();
+    report("InlineTask construct/move/invoke", g_alloc_cnt.load() - before, task_num + 1, 0);
+
+    //超过内联容量的可调用对象退化为堆上保存，每个任务分配一次
+    struct Big { char data[128]; };
+    Big big{};
+    before = g_alloc_cnt.load();
+    InlineTask big_task([big, counter]() { *counter += big.data[0]; });
+    InlineTask big_moved = move(big_task);
+    big_moved();
+    report("InlineTask oversized (heap fallback)", g_alloc_cnt.load() - before, 1, 1);
+}
+
+// 外部线程向事件循环投递任务，每轮投递task_num个并等待执行完，与连接线程向事件循环投递任务的方式相同
+// 节点缓存需要的节点数取决于同时在途的任务数，以及事件循环线程链表中暂存的节点数（不超过LOCAL_MAX）。
+// 预热时先让事件循环阻塞，投递task_num + LOCAL_MAX个任务后再放开，使缓存一次增长到稳定状态的大小，
+// 之后无论线程如何调度，每轮开始时生产者可取回的节点都不少于task_num
+void test_event_loop(int task_num)
+{
+    promise<EventLoop*> loop_promise;
+    thread loop_thread([&loop_promise]() {
+        EventLoop* loop = new EventLoop();
+        loop_promise.set_value(loop);
+        loop->loop();
+        delete loop;
+    });
+    EventLoop* loop = loop_promise.get_future().get();
+
+    auto counter = make_shared<atomic<long long>>(0);
+    long long before = 0;
+    long long expect = 0;
+    thread producer([&]() {
+        for (int round = 0; round < WARMUP_ROUNDS + MEASURE_ROUNDS; round++) {
+            if (round == WARMUP_ROUNDS) {
+                before = g_alloc_cnt.load();
+            }
+            int num = task_num;
+            atomic<bool> hold{ false };
+            if (round < WARMUP_ROUNDS) {
+                num += ObjectCache<int>::LOCAL_MAX;
+                hold = true;
+                loop->add_task([&hold]() {
+                    while (hold.load()) {
+                        this_thread::yield();
+                    }
+                });
+            }
+            for (int i = 0; i < num; i++) {
+                loop->add_task([counter, step = 1]() { counter->fetch_add(step, memory_order_relaxed); });
+            }
+            hold = false;
+            expect += num;
+            while (counter->load(memory_order_relaxed) < expect) {
+                this_thread::yield();
+            }
+        }
+    });
+    producer.join();
+    long long allocs = g_alloc_cnt.load() - before;
+    report("EventLoop::add_task (cross thread)", allocs, static_cast<long long>(task_num) * MEASURE_ROUNDS, 0);
+
+    loop->quit();
+    loop_thread.join();
+}
+
+// 外部线程向线程池提交任务
+void test_threadpool(int task_num)
+{
+    Threadpool pool(2);
+    auto counter = make_shared<atomic<long long>>(0);
+    long long before = 0;
+    long long expect = 0;
+    for (int round = 0; round < WARMUP_ROUNDS + MEASURE_ROUNDS; round++) {
+        if (round == WARMUP_ROUNDS) {
+            before = g_alloc_cnt.load();
+        }
+        for (int i = 0; i < task_num; i++) {
+            pool.execute([counter, step = 1]() { counter->fetch_add(step, memory_order_relaxed); });
+        }
+        expect += task_num;
+        while (counter->load(memory_order_relaxed) < expect) {
+            this_thread::yield();
+        }
+    }
+    long long allocs = g_alloc_cnt.load() - before;
+    report("Threadpool::execute", allocs, static_cast<long long>(task_num) * MEASURE_ROUNDS, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int task_num = argc > 1 ? atoi(argv[1]) : 1000;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    printf("sizeof(InlineTask): %zu  inline capacity: %d\n", sizeof(InlineTask), INLINE_TASK_CAPACITY);
+    test_inline_task(task_num * MEASURE_ROUNDS);
+    test_event_loop(task_num);
+    test_threadpool(task_num);
+
+    if (g_failed) {
+        PR_ERROR("task alloc test failed\n");
+        return 1;
+    }
+    printf("task alloc test passed\n");
+    return 0;
+}
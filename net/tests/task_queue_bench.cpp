@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// 多个生产者线程向同一个事件循环投递任务，统计任务吞吐量和add_task入队延迟
+// 用法: ./task_queue_bench [tasks_per_producer] [max_producer_num]
+
+//生产者线程：投递task_num个任务，记录每次add_task的耗时(ns)
+void producer(EventLoop* loop, int task_num, atomic<long long>* done, vector<long long>* latency)
+{
+    latency->reserve(task_num);
+    for (int i = 0; i < task_num; i++) {
+        auto start = steady_clock::now();
+        loop->add_task([done]() {
+            //任务只在事件循环线程中执行，只有一个写者
+            done->store(done->load(memory_order_relaxed) + 1, memory_order_relaxed);
+        });
+        latency->push_back(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    }
+}
+
+void run_bench(EventLoop* loop, int producer_num, int task_num)
+{
+    atomic<long long> done{ 0 };
+    long long total = (long long)producer_num * task_num;
+    vector<vector<long long>> latency(producer_num);
+
+    auto start = steady_clock::now();
+    vector<thread> producers;
+    for (int i = 0; i < producer_num; i++) {
+        producers.emplace_back(producer, loop, task_num, &done, &latency[i]);
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    while (done.load(memory_order_relaxed) < total) {
+        this_thread::yield();
+    }
+    double secs = duration<double>(steady_clock::now() - start).count();
+
+    vector<long long> all;
+    all.reserve(total);
+    for (auto& l : latency) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    sort(all.begin(), all.end());
+    printf("producers: %-3d tasks: %-10lld tasks/s: %-12.0f enqueue p50: %-6lld ns  p99: %-8lld ns  max: %lld ns\n",
+           producer_num, total, total / secs, all[total / 2], all[total * 99 / 100], all.back());
+}
+
+int main(int argc, char *argv[])
+{
+    int task_num = argc > 1 ? atoi(argv[1]) : 200000;
+    int max_producer_num = argc > 2 ? atoi(argv[2]) : 8;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    //事件循环在自己的线程中创建，保证事件循环记录的线程id正确
+    promise<EventLoop*> loop_promise;
+    thread loop_thread([&loop_promise]() {
+        EventLoop* loop = new EventLoop();
+        loop_promise.set_value(loop);
+        loop->loop();
+    });
+    EventLoop* loop = loop_promise.get_future().get();
+
+    for (int n = 1; n <= max_producer_num; n *= 2) {
+        run_bench(loop, n, task_num);
+    }
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
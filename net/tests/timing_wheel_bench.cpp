@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "timing_wheel.h"
+#include "../../timer/timer.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// 对比连接空闲超时刷新的两种实现在不同连接数下每次刷新的耗时
+// * timer：原来的实现，取消全局Timer中的任务、在连接列表中查找删除再加入、向Timer添加新任务
+// * wheel：事件循环的时间轮，把节点移动到新到期tick对应的槽
+// 最后检查时间轮中的节点能否按时到期，包括延长和缩短超时时间的节点
+// 用法: ./timing_wheel_bench [refresh_num]
+
+const int g_timeout_ms = 60000;
+
+//原来的刷新方式
+double bench_timer(int conn_num, int refresh_num)
+{
+    Timer timer;
+    timer.run();
+    vector<shared_ptr<int>> conns;
+    vector<shared_ptr<int>> conn_list;
+    vector<int> timer_ids(conn_num);
+    for (int i = 0; i < conn_num; i++) {
+        conns.emplace_back(make_shared<int>(i));
+        conn_list.emplace_back(conns[i]);
+        timer_ids[i] = timer.run_after(g_timeout_ms, false, []{});
+    }
+
+    mt19937 rng(1);
+    auto start = steady_clock::now();
+    for (int n = 0; n < refresh_num; n++) {
+        int i = rng() % conn_num;
+        timer.cancel(timer_ids[i]);
+        for (auto it = conn_list.begin(); it != conn_list.end(); ++it) {
+            if (*it == conns[i]) {
+                conn_list.erase(it);
+                break;
+            }
+        }
+        conn_list.emplace_back(conns[i]);
+        timer_ids[i] = timer.run_after(g_timeout_ms, false, []{});
+    }
+    return duration<double, nano>(steady_clock::now() - start).count() / refresh_num;
+}
+
+//时间轮的刷新方式，时间轮只能在事件循环线程中使用，这里事件循环在当前线程创建但不运行
+double bench_wheel(int conn_num, int refresh_num)
+{
+    EventLoop loop;
+    TimingWheel& wheel = loop.get_timing_wheel();
+    vector<WheelNode> nodes(conn_num);
+    for (auto& node : nodes) {
+        node.wn_callback = []{};
+        wheel.add(&node, g_timeout_ms);
+    }
+
+    mt19937 rng(1);
+    auto start = steady_clock::now();
+    for (int n = 0; n < refresh_num; n++) {
+        wheel.add(&nodes[rng() % conn_num], g_timeout_ms);
+    }
+    double ns = duration<double, nano>(steady_clock::now() - start).count() / refresh_num;
+    for (auto& node : nodes) {
+        wheel.remove(&node);
+    }
+    return ns;
+}
+
+//在运行的事件循环中加入一批节点，检查到期回调是否按时执行
+void check_expire(int node_num, int timeout_ms)
+{
+    promise<EventLoop*> loop_promise;
+    thread loop_thread([&loop_promise]() {
+        EventLoop* loop = new EventLoop();
+        loop_promise.set_value(loop);
+        loop->loop();
+    });
+    EventLoop* loop = loop_promise.get_future().get();
+
+    vector<WheelNode> nodes(node_num);
+    vector<WheelNode> short_nodes(node_num);
+    atomic<int> fired{ 0 };
+    atomic<long long> last_ms{ 0 };
+    atomic<int> short_fired{ 0 };
+    atomic<long long> short_last_ms{ 0 };
+    auto start = steady_clock::now();
+    loop->add_task([&]() {
+        for (auto& node : nodes) {
+            node.wn_callback = [&]() {
+                fired.fetch_add(1);
+                last_ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+            };
+            loop->get_timing_wheel().add(&node, timeout_ms);
+        }
+        //先加入较长的超时时间，再缩短为timeout_ms/4，它们应该在timeout_ms/4左右到期
+        for (auto& node : short_nodes) {
+            node.wn_callback = [&]() {
+                short_fired.fetch_add(1);
+                short_last_ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+            };
+            loop->get_timing_wheel().add(&node, timeout_ms * 2);
+            loop->get_timing_wheel().add(&node, timeout_ms / 4);
+        }
+    });
+    //刷新一半节点，它们应该晚timeout_ms/2到期
+    this_thread::sleep_for(milliseconds(timeout_ms / 2));
+    loop->add_task([&]() {
+        for (int i = 0; i < node_num / 2; i++) {
+            loop->get_timing_wheel().add(&nodes[i], timeout_ms);
+        }
+    });
+    this_thread::sleep_for(milliseconds(timeout_ms * 3 / 2 + 500));
+    printf("expire check: %d/%d nodes fired, last one after %lld ms (expected about %d ms)\n",
+           fired.load(), node_num, last_ms.load(), timeout_ms * 3 / 2);
+    printf("shortened:    %d/%d nodes fired, last one after %lld ms (expected about %d ms)\n",
+           short_fired.load(), node_num, short_last_ms.load(), timeout_ms / 4);
+    loop_thread.detach();
+}
+
+int main(int argc, char *argv[])
+{
+    int refresh_num = argc > 1 ? atoi(argv[1]) : 20000;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);  //压测时关闭info日志
+
+    for (int conn_num : { 1000, 10000, 100000 }) {
+        double timer_ns = bench_timer(conn_num, refresh_num);
+        double wheel_ns = bench_wheel(conn_num, refresh_num * 50);
+        printf("conns: %-7d timer refresh: %-10.1f ns/op  wheel refresh: %-6.1f ns/op  speedup: %.0fx\n",
+               conn_num, timer_ns, wheel_ns, timer_ns / wheel_ns);
+    }
+    check_expire(1000, 1000);
+
+    //事件循环线程不会退出，直接结束进程
+    fflush(stdout);
+    _exit(0);
+}
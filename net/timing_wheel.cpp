@@ -0,0 +1,127 @@
+#include <stdlib.h>
+
+#include "timing_wheel.h"
+#include "event_loop.h"
+#include "../log/pr.h"
+#include "../log/log.h"
+
+using namespace std;
+
+TimingWheel::TimingWheel(EventLoop* loop, int tick_ms, int slot_num)
+    : tw_loop(loop),
+      tw_tick_ms(tick_ms > 0 ? tick_ms : 1)
+{
+    //槽个数向上取整到2的幂，用位与代替取模
+    uint64_t slots = 1;
+    while (slots < static_cast<uint64_t>(slot_num)) {
+        slots <<= 1;
+    }
+    tw_mask = slots - 1;
+    tw_slots.resize(slots);
+    for (auto& head : tw_slots) {
+        head.wn_prev = &head;
+        head.wn_next = &head;
+    }
+    LOG_INFO("create one timing wheel, tick is %d ms, slot num is %d\n", tw_tick_ms, (int)slots);
+}
+
+TimingWheel::~TimingWheel()
+{
+    set_ticking(false);
+}
+
+void TimingWheel::link(WheelNode* head, WheelNode* node)
+{
+    node->wn_prev = head->wn_prev;
+    node->wn_next = head;
+    head->wn_prev->wn_next = node;
+    head->wn_prev = node;
+}
+
+void TimingWheel::unlink(WheelNode* node)
+{
+    node->wn_prev->wn_next = node->wn_next;
+    node->wn_next->wn_prev = node->wn_prev;
+    node->wn_prev = nullptr;
+    node->wn_next = nullptr;
+}
+
+//加入节点或刷新超时时间，O(1)
+//已经在时间轮中的节点，新的到期tick仍在同一个槽时只更新到期tick；否则移动到新的槽，
+//缩短超时时间时也能在新的到期tick被处理，不会等到原来的槽
+void TimingWheel::add(WheelNode* node, int timeout_ms)
+{
+    uint64_t ticks = (timeout_ms + tw_tick_ms - 1) / tw_tick_ms;
+    uint64_t expire = tw_current + (ticks > 0 ? ticks : 1);
+    if (node->is_linked()) {
+        uint64_t old_slot = node->wn_expire & tw_mask;
+        node->wn_expire = expire;
+        if ((expire & tw_mask) != old_slot) {
+            unlink(node);
+            link(&tw_slots[expire & tw_mask], node);
+        }
+        return;
+    }
+    node->wn_expire = expire;
+    link(&tw_slots[node->wn_expire & tw_mask], node);
+    if (tw_size++ == 0) {
+        set_ticking(true);
+    }
+}
+
+void TimingWheel::remove(WheelNode* node)
+{
+    if (!node->is_linked()) {
+        return;
+    }
+    unlink(node);
+    tw_size--;
+}
+
+//事件循环繁忙时错过的tick由周期定时器逐个补上
+void TimingWheel::advance()
+{
+    tw_current++;
+    WheelNode *head = &tw_slots[tw_current & tw_mask];
+    if (head->wn_next == head) {
+        return;
+    }
+
+    //先把整个槽的链表移到临时链表中，回调函数中可能会加入或移除节点
+    WheelNode pending;
+    pending.wn_next = head->wn_next;
+    pending.wn_prev = head->wn_prev;
+    pending.wn_next->wn_prev = &pending;
+    pending.wn_prev->wn_next = &pending;
+    head->wn_prev = head;
+    head->wn_next = head;
+
+    while (pending.wn_next != &pending) {
+        WheelNode *node = pending.wn_next;
+        unlink(node);
+        if (node->wn_expire > tw_current) {
+            //还没有到期（刷新过或者还需要转更多圈），放到到期tick对应的槽
+            link(&tw_slots[node->wn_expire & tw_mask], node);
+            continue;
+        }
+        tw_size--;
+        node->wn_callback();
+    }
+    if (tw_size == 0) {
+        set_ticking(false);
+    }
+}
+
+void TimingWheel::set_ticking(bool on)
+{
+    if (on == (tw_tick_timer != 0)) {
+        return;
+    }
+    if (on) {
+        tw_tick_timer = tw_loop->run_every(tw_tick_ms, [this](){ this->advance(); });
+    }
+    else {
+        tw_loop->cancel(tw_tick_timer);
+        tw_tick_timer = 0;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __TIMING_WHEEL_H__
+#define __TIMING_WHEEL_H__
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+#include "loop_timer.h"
+
+using namespace std;
+
+class EventLoop;
+
+// 时间轮中的侵入式节点，嵌入到需要超时处理的对象中（如TcpConnection），加入和刷新都不需要分配内存
+struct WheelNode
+{
+    WheelNode *wn_prev{ nullptr };  // 所在槽链表的前一个节点
+    WheelNode *wn_next{ nullptr };  // 所在槽链表的后一个节点
+    uint64_t wn_expire{ 0 };  // 到期的tick
+    function<void()> wn_callback;  // 到期回调函数，执行前节点已经从时间轮中移除
+
+    bool is_linked() const { return wn_next != nullptr; }  // 是否在时间轮中
+};
+
+// 每个事件循环一个的哈希时间轮，用于连接的空闲超时
+// * 由事件循环定时器队列中的周期定时器驱动，每个tick处理一个槽，只能在事件循环线程中使用，不需要加锁
+// * 刷新超时时间时，新的到期tick在同一个槽则只更新到期tick，否则把节点移动到新的槽，缩短超时时间也能按时到期；
+//   超时时间超过一圈的节点，处理到所在的槽时没有到期，再转一圈
+// * 时间轮为空时取消周期定时器，没有连接时不会产生定时唤醒
+class TimingWheel
+{
+public:
+    TimingWheel(EventLoop* loop, int tick_ms = 100, int slot_num = 1024);
+
+    ~TimingWheel();
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // 加入节点或刷新节点的超时时间，timeout_ms毫秒后执行节点的回调函数
+    void add(WheelNode* node, int timeout_ms);
+
+    // 从时间轮中移除节点，节点不在时间轮中时什么也不做
+    void remove(WheelNode* node);
+
+    size_t size() const { return tw_size; }  // 时间轮中的节点个数
+
+    int get_tick_ms() const { return tw_tick_ms; }  // 获取tick间隔(ms)
+
+private:
+    void link(WheelNode* head, WheelNode* node);  // 把节点插入到槽链表的尾部
+    void unlink(WheelNode* node);  // 把节点从所在链表中取下
+    void advance();  // 推进一个tick，处理当前槽中的节点，由周期定时器调用
+    void set_ticking(bool on);  // 启动或停止周期定时器
+
+    EventLoop *tw_loop;  // 所属的事件循环
+    int tw_tick_ms;  // tick间隔(ms)
+    uint64_t tw_mask;  // 槽个数减一，槽个数为2的幂
+    uint64_t tw_current{ 0 };  // 当前tick
+    size_t tw_size{ 0 };  // 节点个数
+    TimerId tw_tick_timer{ 0 };  // 驱动时间轮的周期定时器，0表示没有启动
+    vector<WheelNode> tw_slots;  // 各个槽的链表头，链表为带头节点的双向循环链表
+};
+
+#endif
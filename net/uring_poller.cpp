@@ -0,0 +1,535 @@
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "uring_poller.h"
+#include "epoll.h"
+#include "loop_timer.h"
+#include "../log/pr.h"
+#include "../log/log.h"
+
+using namespace std;
+
+const unsigned URING_ENTRIES = 1024;     // 提交队列大小
+const unsigned URING_CQ_ENTRIES = 8192;  // 完成队列大小，multishot请求会产生大量cqe
+
+// user_data的编码：高2位为请求类型，中间30位为代数，低32位为fd
+const uint64_t UD_POLL = 0;
+const uint64_t UD_ACCEPT = 1;
+const uint64_t UD_IGNORE = 2;   // 取消请求等不需要处理的cqe
+const uint64_t UD_RETRY = 3;    // accept失败后等待重试的定时器
+
+// accept失败（例如EMFILE）后重新提交accept之前等待的时间，避免立即重试又立即失败
+static const __kernel_timespec ACCEPT_RETRY_TS = { 0, 10 * 1000000LL };
+
+static inline uint64_t make_user_data(uint64_t type, uint32_t gen, int fd)
+{
+    return (type << 62) | ((static_cast<uint64_t>(gen) & 0x3fffffff) << 32) | static_cast<uint32_t>(fd);
+}
+
+static inline uint64_t ud_type(uint64_t ud) { return ud >> 62; }
+static inline uint32_t ud_gen(uint64_t ud) { return static_cast<uint32_t>((ud >> 32) & 0x3fffffff); }
+static inline int ud_fd(uint64_t ud) { return static_cast<int>(ud & 0xffffffff); }
+
+// 创建指定类型的poller，io_uring不可用时回退到epoll
+shared_ptr<Poller> Poller::create(PollerType type)
+{
+    if (type == PollerType::IoUring) {
+        auto uring = make_shared<UringPoller>();
+        if (uring->is_valid()) {
+            return uring;
+        }
+        PR_WARN("io_uring is not supported, fall back to epoll\n");
+    }
+    return make_shared<Epoll>();
+}
+
+UringPoller::UringPoller()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    int fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (fd < 0) {
+        PR_WARN("io_uring_setup failed, error no:%d, error str:%s\n", errno, strerror(errno));
+        return;
+    }
+
+    //需要共用一块映射内存、带超时的等待、multishot poll以及IOSQE_CQE_SKIP_SUCCESS(与IORING_FEAT_LINKED_FILE同在5.17加入)
+    //multishot accept需要5.19之后的内核，没有对应的特性位，在下面提交一次试探
+    unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_LINKED_FILE;
+    if ((params.features & required) != required) {
+        PR_WARN("io_uring features 0x%x are not enough\n", params.features);
+        close(fd);
+        return;
+    }
+
+    //提交队列和完成队列映射到同一块内存
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ur_ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ur_ring_ptr = mmap(nullptr, ur_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ur_ring_ptr == MAP_FAILED) {
+        PR_ERROR("mmap io_uring ring failed\n");
+        ur_ring_ptr = nullptr;
+        close(fd);
+        return;
+    }
+    ur_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, ur_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        PR_ERROR("mmap io_uring sqes failed\n");
+        munmap(ur_ring_ptr, ur_ring_size);
+        ur_ring_ptr = nullptr;
+        close(fd);
+        return;
+    }
+
+    char *ring = static_cast<char*>(ur_ring_ptr);
+    ur_sq_head = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    ur_sq_tail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    ur_sq_mask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    ur_sq_entries = params.sq_entries;
+    ur_sq_array = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    ur_sqes = static_cast<io_uring_sqe*>(sqes);
+    ur_sq_local_tail = *ur_sq_tail;
+
+    ur_cq_head = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    ur_cq_tail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    ur_cq_mask = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    ur_cqes = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+    //sq数组中的下标和sqe一一对应，只需要初始化一次
+    for (unsigned i = 0; i < ur_sq_entries; i++) {
+        ur_sq_array[i] = i;
+    }
+
+    ur_ready.reserve(URING_CQ_ENTRIES);
+    ur_ring_fd = fd;
+    ur_multishot_accept = probe_multishot_accept();
+    LOG_INFO("create io_uring poller, ring fd is %d, multishot accept %s\n", ur_ring_fd,
+             ur_multishot_accept ? "supported" : "not supported");
+}
+
+UringPoller::~UringPoller()
+{
+    if (ur_sqes) {
+        munmap(ur_sqes, ur_sqes_size);
+    }
+    if (ur_ring_ptr) {
+        munmap(ur_ring_ptr, ur_ring_size);
+    }
+    if (ur_ring_fd >= 0) {
+        close(ur_ring_fd);
+    }
+}
+
+//对一个临时的监听socket提交multishot accept：不支持的内核在提交时就以EINVAL完成，支持时请求挂起，取消后返回true
+bool UringPoller::probe_multishot_accept()
+{
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return false;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (::bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(sock, 1) != 0) {
+        close(sock);
+        return false;
+    }
+
+    uint64_t probe_ud = make_user_data(UD_IGNORE, 1, sock);
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = sock;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = probe_ud;
+    enter(0, false);
+
+    bool supported = true;
+    unsigned head = *ur_cq_head;
+    unsigned tail = __atomic_load_n(ur_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        if (ur_cqes[head & ur_cq_mask].user_data == probe_ud) {
+            supported = false;  //请求没有挂起，参数被拒绝
+        }
+    }
+    __atomic_store_n(ur_cq_head, head, __ATOMIC_RELEASE);
+
+    if (supported) {
+        //取消挂起的accept并等待它完成，之后再关闭socket；迟到的cqe类型为UD_IGNORE，poll时会被丢弃
+        sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = probe_ud;
+        sqe->user_data = make_user_data(UD_IGNORE, 0, sock);
+        enter(2, true, 100);
+        __atomic_store_n(ur_cq_head, __atomic_load_n(ur_cq_tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+    close(sock);
+    return supported;
+}
+
+//获取一个空闲的sqe，提交队列已满时先把已有的sqe提交给内核
+io_uring_sqe* UringPoller::get_sqe()
+{
+    unsigned head = __atomic_load_n(ur_sq_head, __ATOMIC_ACQUIRE);
+    if (ur_sq_local_tail - head >= ur_sq_entries) {
+        enter(0, false);
+        head = __atomic_load_n(ur_sq_head, __ATOMIC_ACQUIRE);
+        if (ur_sq_local_tail - head >= ur_sq_entries) {
+            PR_ERROR("io_uring submission queue is full\n");
+            return nullptr;
+        }
+    }
+    io_uring_sqe *sqe = &ur_sqes[ur_sq_local_tail & ur_sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ur_sq_local_tail++;
+    return sqe;
+}
+
+//提交所有未提交的sqe，wait为true时等待至少min_complete个cqe或超时timeout_ms毫秒
+int UringPoller::enter(unsigned min_complete, bool wait, int timeout_ms)
+{
+    __atomic_store_n(ur_sq_tail, ur_sq_local_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = ur_sq_local_tail - __atomic_load_n(ur_sq_head, __ATOMIC_ACQUIRE);
+
+    if (!wait) {
+        return syscall(__NR_io_uring_enter, ur_ring_fd, to_submit, 0, 0, nullptr, 0);
+    }
+
+    timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    return syscall(__NR_io_uring_enter, ur_ring_fd, to_submit, min_complete,
+                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+//提交poll（普通fd）或multishot accept（监听fd）
+//内核不支持multishot poll的水平触发（IORING_POLL_ADD_LEVEL与IORING_POLL_ADD_MULTI同时使用返回EINVAL），
+//没有EPOLLET的fd使用单次poll，每次完成后在execute_cbs中重新提交；单次poll提交时会先检查fd当前是否就绪，
+//数据没有读完时立即再次完成，效果与epoll的水平触发相同，重新提交的sqe和下一次等待一起提交，不增加系统调用
+void UringPoller::arm(int fd, uring_event& ev)
+{
+    io_uring_sqe *sqe = get_sqe();
+    if (sqe == nullptr) {
+        //提交队列满，留在重新提交列表中，下一次poll时再提交，否则该fd不会再被通知
+        if (!ev.rearm) {
+            ev.rearm = true;
+            ur_rearm.push_back(fd);
+        }
+        return;
+    }
+    ev.gen++;
+    ev.rearm = false;
+    sqe->fd = fd;
+    if (ev.accept_callback) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = make_user_data(UD_ACCEPT, ev.gen, fd);
+    }
+    else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->len = (ev.event & EPOLLET) ? IORING_POLL_ADD_MULTI : 0;
+        sqe->poll32_events = ev.event & (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP);
+        sqe->user_data = make_user_data(UD_POLL, ev.gen, fd);
+    }
+}
+
+//取消当前的poll或accept请求，之后该请求产生的cqe代数不匹配，会被丢弃
+void UringPoller::cancel(int fd, uring_event& ev)
+{
+    if (ev.rearm) {
+        ev.rearm = false;  //请求已经完成，没有需要取消的请求
+        ev.gen++;
+        return;
+    }
+    io_uring_sqe *sqe = get_sqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;  //取消成功时不产生cqe，避免无用的唤醒
+    sqe->fd = -1;
+    sqe->addr = make_user_data(ev.accept_callback ? UD_ACCEPT : UD_POLL, ev.gen, fd);
+    sqe->user_data = make_user_data(UD_IGNORE, 0, fd);
+    ev.gen++;
+}
+
+//原地修改正在进行的poll的事件，不需要取消后重新提交，触发方式（单次或multishot）保持不变
+//如果poll已经完成或被内核终止，修改会失败，完成时产生的cqe会触发按新事件重新提交
+void UringPoller::update(int fd, uring_event& ev)
+{
+    if (ev.rearm) {
+        return;  //请求已经完成，重新提交时使用修改后的事件
+    }
+    io_uring_sqe *sqe = get_sqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(UD_POLL, ev.gen, fd);
+    sqe->len = IORING_POLL_UPDATE_EVENTS | ((ev.event & EPOLLET) ? IORING_POLL_ADD_MULTI : 0);
+    sqe->poll32_events = ev.event & (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP);
+    sqe->user_data = make_user_data(UD_IGNORE, 0, fd);
+}
+
+//添加事件以及回调函数
+void UringPoller::add_event(int fd, int event, EventCallback&& cb)
+{
+    if (fd < 0) {
+        PR_ERROR("io_uring add invalid fd %d\n", fd);
+        return;
+    }
+    uring_event &ev = ur_event_table[fd];
+    bool registered = ev.event != 0;
+
+    //由传入事件类型确定其回调函数
+    if (event & EPOLLIN) {
+        ev.read_callback = move(cb);
+    }
+    else if (event & EPOLLOUT) {
+        ev.write_callback = move(cb);
+    }
+
+    int final_events = ev.event | event;
+    if (registered && final_events == ev.event) {
+        return;  //监听的事件没有变化，poll仍然有效，只需要更新回调函数
+    }
+    bool trigger_changed = registered && ((final_events ^ ev.event) & EPOLLET);
+    ev.event = final_events;
+    if (trigger_changed) {
+        //修改事件不能改变触发方式，取消后按新的触发方式重新提交
+        cancel(fd, ev);
+        arm(fd, ev);
+    }
+    else if (registered) {
+        update(fd, ev);
+    }
+    else {
+        arm(fd, ev);
+    }
+LOG_DEBUG("io_uring add, fd is %d, event is %d\n", fd, final_events);
+}
+
+//删除特定事件
+void UringPoller::del_event(int fd, int event)
+{
+    if (fd < 0) {
+        PR_ERROR("io_uring del invalid fd %d\n", fd);
+        return;
+    }
+    uring_event *ev = ur_event_table.find(fd);
+    if (ev == nullptr || ev->event == 0) {
+        return;
+    }
+
+    ev->event &= ~event;
+    if ((ev->event & ~EPOLLET) == 0) {
+        del_event(fd);
+        return;
+    }
+    //修改poll监听的事件
+    update(fd, *ev);
+}
+
+//删除特定文件描述符的所有事件
+void UringPoller::del_event(int fd)
+{
+    if (fd < 0) {
+        PR_ERROR("io_uring del invalid fd %d\n", fd);
+        return;
+    }
+    uring_event *ev = ur_event_table.find(fd);
+    if (ev == nullptr || ev->event == 0) {
+        return;
+    }
+    cancel(fd, *ev);
+    ev->event = 0;
+    ev->read_callback = nullptr;
+    ev->write_callback = nullptr;
+    ev->accept_callback = nullptr;
+}
+
+//使用multishot accept监听新连接，内核不支持时返回false，由调用者注册读事件
+bool UringPoller::add_acceptor(int listen_fd, AcceptCallback&& cb)
+{
+    if (listen_fd < 0) {
+        PR_ERROR("io_uring add invalid listen fd %d\n", listen_fd);
+        return false;
+    }
+    if (!ur_multishot_accept) {
+        return false;
+    }
+    uring_event &ev = ur_event_table[listen_fd];
+    if (ev.event != 0) {
+        cancel(listen_fd, ev);
+    }
+    ev.event = EPOLLIN;
+    ev.accept_callback = move(cb);
+    arm(listen_fd, ev);
+LOG_INFO("io_uring add multishot accept, listen fd is %d\n", listen_fd);
+    return true;
+}
+
+//accept失败后不立即重新提交，而是提交一个定时器，到期后再重新提交accept
+void UringPoller::retry_later(int fd, uring_event& ev)
+{
+    io_uring_sqe *sqe = get_sqe();
+    if (sqe == nullptr) {
+        if (!ev.rearm) {
+            ev.rearm = true;
+            ur_rearm.push_back(fd);
+        }
+        return;
+    }
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&ACCEPT_RETRY_TS);
+    sqe->len = 1;
+    sqe->user_data = make_user_data(UD_RETRY, ev.gen, fd);
+}
+
+//重新提交已经完成的请求；推迟到等待之前提交，期间回调和任务对事件的修改直接体现在新请求中，
+//不会先提交旧事件的请求再提交修改，导致已经删除的事件还被通知一次
+void UringPoller::rearm_all()
+{
+    //提交失败的fd会被arm重新加入ur_rearm，先换出当前列表
+    ur_rearm_work.swap(ur_rearm);
+    for (int fd : ur_rearm_work) {
+        uring_event *ev = ur_event_table.find(fd);
+        if (ev != nullptr && ev->rearm && ev->event != 0) {
+            ev->rearm = false;
+            arm(fd, *ev);
+        }
+    }
+    ur_rearm_work.clear();
+}
+
+//提交积累的sqe并等待事件，然后执行就绪事件的回调函数
+int UringPoller::poll(int timeout_ms)
+{
+    rearm_all();
+    while (true) {
+        int ret = enter(1, true, timeout_ms);
+        pl_wait_end_ns = monotonic_ns();
+        ur_poll_cnt.fetch_add(1, memory_order_relaxed);
+        if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            PR_ERROR("io_uring_enter return val <0! error no:%d, error str:%s\n", errno, strerror(errno));
+            continue;
+        }
+
+        //先把cqe全部取出再执行回调，回调中可能会继续提交sqe
+        ur_ready.clear();
+        unsigned head = *ur_cq_head;
+        unsigned tail = __atomic_load_n(ur_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            ur_ready.push_back(ur_cqes[head & ur_cq_mask]);
+        }
+        __atomic_store_n(ur_cq_head, head, __ATOMIC_RELEASE);
+
+        execute_cbs(ur_ready.size());
+        return static_cast<int>(ur_ready.size());
+    }
+}
+
+//执行回调函数，参数为取出的cqe个数
+void UringPoller::execute_cbs(size_t cqe_count)
+{
+    for (size_t i = 0; i < cqe_count; i++) {
+        const io_uring_cqe &cqe = ur_ready[i];
+        uint64_t type = ud_type(cqe.user_data);
+        if (type == UD_IGNORE) {
+            continue;
+        }
+
+        int fd = ud_fd(cqe.user_data);
+        uint32_t gen = ud_gen(cqe.user_data);
+        uring_event *ev = ur_event_table.find(fd);
+        //fd已经删除或者是已取消的旧请求产生的cqe
+        if (ev == nullptr || ev->event == 0 || (ev->gen & 0x3fffffff) != gen) {
+            continue;
+        }
+        //accept的重试定时器到期（fd删除或重新注册后代数不匹配，已经在上面丢弃）
+        if (type == UD_RETRY) {
+            if (!ev->rearm) {
+                ev->rearm = true;
+                ur_rearm.push_back(fd);
+            }
+            continue;
+        }
+        //accept失败并终止了multishot请求：交给回调处理错误（EMFILE时由Acceptor用空闲fd拒绝一个连接），
+        //等待一段时间后再重新提交，不在每次poll时立即重试
+        if (type == UD_ACCEPT && cqe.res < 0 && !(cqe.flags & IORING_CQE_F_MORE)) {
+            PR_WARN("io_uring accept fail, error no:%d, error str:%s\n", -cqe.res, strerror(-cqe.res));
+            ev->accept_callback(cqe.res);
+            if (ev->event != 0 && (ev->gen & 0x3fffffff) == gen) {
+                retry_later(fd, *ev);
+            }
+            continue;
+        }
+        //单次poll已经完成，或multishot请求被内核终止（例如完成队列溢出），需要重新提交
+        //在执行回调之前标记，回调中修改事件时不再对已经完成的请求提交修改，重新提交时直接使用修改后的事件
+        if (!(cqe.flags & IORING_CQE_F_MORE) && !ev->rearm) {
+            ev->rearm = true;
+            ur_rearm.push_back(fd);
+        }
+
+        if (type == UD_ACCEPT) {
+            if (cqe.res >= 0) {
+LOG_DEBUG("io_uring accepted one connection, sock fd is %d\n", cqe.res);
+            }
+            else {
+                PR_WARN("io_uring accept fail, error no:%d, error str:%s\n", -cqe.res, strerror(-cqe.res));
+            }
+            ev->accept_callback(cqe.res);
+        }
+        else {
+            uint32_t revents = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+            //请求完成后到这里之间事件可能已经被删除，只通知仍然监听的事件，与epoll一致
+            revents &= ev->event | EPOLLHUP | EPOLLERR;
+            if (revents & (EPOLLIN | EPOLLOUT)) {
+                if ((revents & EPOLLIN) && ev->read_callback) {
+LOG_DEBUG("execute read cb\n");
+                    ev->read_callback();
+                }
+                //读回调可能已经删除了该fd或者重新提交了poll
+                if ((revents & EPOLLOUT) && ev->event != 0 && (ev->gen & 0x3fffffff) == gen && ev->write_callback) {
+LOG_DEBUG("execute write cb\n");
+                    ev->write_callback();
+                }
+            }
+            else if (revents & (EPOLLHUP | EPOLLERR)) {
+                if (ev->read_callback) {
+                    ev->read_callback();
+                }
+                else if (ev->write_callback) {
+                    ev->write_callback();
+                }
+                else {
+                    LOG_INFO("get error, delete fd %d from io_uring\n", fd);
+                    del_event(fd);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef __URING_POLLER_H__
+#define __URING_POLLER_H__
+
+#include <linux/io_uring.h>
+#include <atomic>
+#include <vector>
+
+#include "fd_table.h"
+#include "poller.h"
+
+using namespace std;
+
+// 基于io_uring的就绪通知poller后端，直接使用io_uring系统调用，不依赖liburing
+// 只替代epoll提供就绪通知，不是性能优化：连接的读写仍由回调中的readv/writev/sendfile完成，每个请求的读写系统调用与epoll后端相同，
+// 没有使用provided buffer ring接收数据，也没有把输出缓冲区的发送合并成批量提交
+// * 触发方式与epoll一致：带EPOLLET的fd使用multishot poll，一次提交持续产生边沿通知；
+//   其他fd使用单次poll，每次完成后重新提交，提交时fd仍然就绪会立即再次通知，即水平触发
+// * 事件的增删改只是往提交队列里写入sqe，在下一次等待事件时和等待一起通过io_uring_enter提交
+// * 内核支持时（5.19之后，创建时提交一次试探）监听fd使用multishot accept，内核直接返回新连接的fd；
+//   accept失败时把错误码交给回调，等待10ms再重新提交，文件描述符耗尽时不会空转；
+//   不支持时add_acceptor返回false，监听fd与其他fd一样使用poll，由Acceptor调用accept
+// 只能在所属事件循环的线程中调用，提交队列不是线程安全的
+class UringPoller : public Poller {
+public:
+    UringPoller();
+
+    ~UringPoller();
+
+    // 内核是否支持所需的io_uring特性，不支持时不能使用该对象
+    bool is_valid() const { return ur_ring_fd >= 0; }
+
+    void add_event(int fd, int event, EventCallback&& cb) override;
+
+    void del_event(int fd, int event) override;
+
+    void del_event(int fd) override;
+
+    int poll(int timeout_ms) override;
+
+    uint64_t get_poll_cnt() const override { return ur_poll_cnt.load(memory_order_relaxed); }
+
+    const char* name() const override { return "io_uring"; }
+
+    bool add_acceptor(int listen_fd, AcceptCallback&& cb) override;
+
+private:
+    struct uring_event : public io_event
+    {
+        uint32_t gen{ 0 };  // 每次重新提交poll/accept时递增，用于丢弃已经取消的旧请求产生的cqe
+        bool rearm{ false };  // 请求已经完成，等待下一次poll开始时按当时的事件重新提交
+        AcceptCallback accept_callback;  // 不为空时表示该fd是使用multishot accept的监听fd
+    };
+
+    bool probe_multishot_accept();  // 试探内核是否支持multishot accept
+    io_uring_sqe* get_sqe();  // 获取一个空闲的sqe，提交队列满时先提交已有的sqe
+    int enter(unsigned min_complete, bool wait, int timeout_ms = 0);  // 提交sqe并等待cqe
+    void arm(int fd, uring_event& ev);  // 提交multishot poll或multishot accept
+    void cancel(int fd, uring_event& ev);  // 取消当前正在进行的poll或accept
+    void update(int fd, uring_event& ev);  // 原地修改正在进行的poll监听的事件
+    void retry_later(int fd, uring_event& ev);  // accept失败后延迟一段时间再重新提交
+    void rearm_all();  // 重新提交已经完成的poll和accept
+    void execute_cbs(size_t cqe_count);  // 执行回调函数
+
+    int ur_ring_fd{ -1 };  // io_uring文件描述符
+
+    // 提交队列
+    unsigned *ur_sq_head{ nullptr };
+    unsigned *ur_sq_tail{ nullptr };
+    unsigned *ur_sq_array{ nullptr };
+    unsigned ur_sq_mask{ 0 };
+    unsigned ur_sq_entries{ 0 };
+    unsigned ur_sq_local_tail{ 0 };  // 已写入但还没有提交给内核的sqe的尾部
+    io_uring_sqe *ur_sqes{ nullptr };
+
+    // 完成队列
+    unsigned *ur_cq_head{ nullptr };
+    unsigned *ur_cq_tail{ nullptr };
+    unsigned ur_cq_mask{ 0 };
+    io_uring_cqe *ur_cqes{ nullptr };
+
+    void *ur_ring_ptr{ nullptr };  // 提交队列和完成队列共用的映射内存
+    size_t ur_ring_size{ 0 };
+    size_t ur_sqes_size{ 0 };
+
+    bool ur_multishot_accept{ false };  // 内核是否支持multishot accept
+    atomic<uint64_t> ur_poll_cnt{ 0 };  // io_uring_enter等待事件的次数
+    FdTable<uring_event> ur_event_table;  // 以fd为下标的事件表
+    vector<io_uring_cqe> ur_ready;  // 从完成队列中取出的cqe
+    vector<int> ur_rearm;  // 等待重新提交的fd
+    vector<int> ur_rearm_work;  // rearm_all正在处理的fd，与ur_rearm交换使用，避免每次poll分配内存
+};
+
+#endif
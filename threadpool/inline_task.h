@@ -0,0 +1,203 @@
+#ifndef __INLINE_TASK_H__
+#define __INLINE_TASK_H__
+
+#include <stddef.h>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+#ifndef INLINE_TASK_CAPACITY
+#define INLINE_TASK_CAPACITY 56   //内联存储的字节数，默认使InlineTask对象正好占64字节（一个缓存行）
+#endif
+
+/*
+   只能移动的小缓冲区优化可调用对象，用于替代任务队列中的std::function：
+   可调用对象不超过Capacity字节、对齐要求不超过max_align_t并且移动构造不抛异常时，直接构造在对象内部的缓冲区中，
+   构造、移动和销毁都不分配内存；不满足条件时退化为在堆上保存（与std::function相同）。
+   不要求可调用对象可拷贝，因此可以捕获unique_ptr、packaged_task等只能移动的对象。
+   与std::function一样，空对象的operator bool为false，调用空对象是未定义行为。
+*/
+template <typename Signature, size_t Capacity = INLINE_TASK_CAPACITY>
+class InlineFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+public:
+    InlineFunction() noexcept {}
+
+    InlineFunction(nullptr_t) noexcept {}
+
+    template <typename F, typename = enable_if_t<!is_same_v<decay_t<F>, InlineFunction> &&
+                                                 !is_same_v<decay_t<F>, nullptr_t>>>
+    InlineFunction(F&& f)
+    {
+        assign(forward<F>(f));
+    }
+
+    InlineFunction(InlineFunction&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    ~InlineFunction()
+    {
+        reset();
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <typename F, typename = enable_if_t<!is_same_v<decay_t<F>, InlineFunction> &&
+                                                 !is_same_v<decay_t<F>, nullptr_t>>>
+    InlineFunction& operator=(F&& f)
+    {
+        reset();
+        assign(forward<F>(f));
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    R operator()(Args... args) const
+    {
+        return if_ops->invoke(if_storage, forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return if_ops != nullptr; }
+
+    // 可调用对象类型F是否直接保存在内部缓冲区中（不分配内存）
+    template <typename F>
+    static constexpr bool is_inline()
+    {
+        return fits_inline<decay_t<F>>;
+    }
+
+private:
+    // 每种可调用对象类型一张操作表，对象本身只多保存一个指针
+    struct Ops
+    {
+        R (*invoke)(void *storage, Args&&... args);
+        void (*move)(void *dst, void *src) noexcept;   //移动到dst并销毁src
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template <typename F>
+    static constexpr bool fits_inline = sizeof(F) <= Capacity && alignof(F) <= alignof(max_align_t) &&
+                                        is_nothrow_move_constructible_v<F>;
+
+    // 内联保存
+    template <typename F>
+    struct InlineOps
+    {
+        static R invoke(void *storage, Args&&... args)
+        {
+            return std::invoke(*static_cast<F*>(storage), forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) noexcept
+        {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void destroy(void *storage) noexcept
+        {
+            static_cast<F*>(storage)->~F();
+        }
+        static constexpr Ops ops = { invoke, move, destroy };
+    };
+
+    // 堆上保存，缓冲区中只存放指针，移动时只转移指针
+    template <typename F>
+    struct HeapOps
+    {
+        static F *&ptr(void *storage) { return *static_cast<F**>(storage); }
+        static R invoke(void *storage, Args&&... args)
+        {
+            return std::invoke(*ptr(storage), forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) noexcept
+        {
+            ::new (dst) F*(ptr(src));
+        }
+        static void destroy(void *storage) noexcept
+        {
+            delete ptr(storage);
+        }
+        static constexpr Ops ops = { invoke, move, destroy };
+    };
+
+    template <typename T>
+    struct is_std_function : false_type {};
+
+    template <typename T>
+    struct is_std_function<function<T>> : true_type {};
+
+    template <typename F>
+    void assign(F&& f)
+    {
+        using Fn = decay_t<F>;
+        // 空的函数指针和std::function转换为空对象，保持if (cb)判断的语义
+        if constexpr (is_pointer_v<Fn> || is_member_pointer_v<Fn> || is_std_function<Fn>::value)
+        {
+            if (!f)
+                return;
+        }
+        if constexpr (fits_inline<Fn>)
+        {
+            ::new (static_cast<void*>(if_storage)) Fn(forward<F>(f));
+            if_ops = &InlineOps<Fn>::ops;
+        }
+        else
+        {
+            ::new (static_cast<void*>(if_storage)) Fn*(new Fn(forward<F>(f)));
+            if_ops = &HeapOps<Fn>::ops;
+        }
+    }
+
+    void move_from(InlineFunction &other) noexcept
+    {
+        if (other.if_ops)
+        {
+            other.if_ops->move(if_storage, other.if_storage);
+            if_ops = other.if_ops;
+            other.if_ops = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (if_ops)
+        {
+            const Ops *ops = if_ops;
+            if_ops = nullptr;   //先置空再析构，析构过程中本对象已经是空状态
+            ops->destroy(if_storage);
+        }
+    }
+
+    static_assert(Capacity >= sizeof(void*), "InlineFunction capacity must hold a pointer");
+
+    alignas(max_align_t) mutable unsigned char if_storage[Capacity];   //可调用对象或指向堆上对象的指针
+    const Ops *if_ops = nullptr;   //为空表示没有可调用对象
+};
+
+typedef InlineFunction<void()> InlineTask;   //任务队列使用的任务类型
+
+#endif
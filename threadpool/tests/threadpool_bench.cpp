@@ -0,0 +1,94 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "threadpool.h"
+#include "pr.h"
+#include "log.h"
+
+using namespace std;
+
+// 线程池吞吐测试：
+//   外部提交：多个非工作线程提交大量小任务，对比post_task（带future）和execute（无返回值）
+//   内部提交：任务在工作线程中继续提交子任务（二叉树展开），任务进入本地队列并被空闲线程窃取
+const int g_pool_size = 4;
+const int g_task_num = 200000;
+
+atomic<long long> g_done{ 0 };
+
+static void wait_done(long long total)
+{
+    while (g_done.load() < total)
+    {
+        this_thread::yield();
+    }
+}
+
+static void bench_external(Threadpool &pool, int producer_num, bool use_execute)
+{
+    g_done = 0;
+    int per_producer = g_task_num / producer_num;
+    long long total = static_cast<long long>(per_producer) * producer_num;
+    auto start = chrono::steady_clock::now();
+    vector<thread> producers;
+    for (int i = 0; i < producer_num; i++)
+    {
+        producers.emplace_back([&pool, per_producer, use_execute]() {
+            for (int j = 0; j < per_producer; j++)
+            {
+                if (use_execute)
+                    pool.execute([]() { g_done++; });
+                else
+                    pool.post_task([]() { g_done++; });
+            }
+        });
+    }
+    for (auto &t : producers)
+    {
+        t.join();
+    }
+    wait_done(total);
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    printf("external %-9s producers=%d  tasks=%lld  %8.1f ms  %6.0f ns/task\n", use_execute ? "execute" : "post_task",
+           producer_num, total, ns / 1e6, ns / total);
+}
+
+// 在工作线程中递归提交子任务
+static void spawn(Threadpool *pool, int depth)
+{
+    g_done++;
+    if (depth == 0)
+        return;
+    pool->execute([pool, depth]() { spawn(pool, depth - 1); });
+    pool->execute([pool, depth]() { spawn(pool, depth - 1); });
+}
+
+static void bench_nested(Threadpool &pool, int depth)
+{
+    g_done = 0;
+    long long total = (1LL << (depth + 1)) - 1;
+    auto start = chrono::steady_clock::now();
+    pool.execute([&pool, depth]() { spawn(&pool, depth); });
+    wait_done(total);
+    auto end = chrono::steady_clock::now();
+    double ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    printf("nested   execute   depth=%d     tasks=%lld  %8.1f ms  %6.0f ns/task\n", depth, total, ns / 1e6, ns / total);
+}
+
+int main()
+{
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    Threadpool pool(g_pool_size);
+    int producer_nums[] = {1, 4, 16};
+    for (int producer_num : producer_nums)
+    {
+        bench_external(pool, producer_num, false);
+        bench_external(pool, producer_num, true);
+    }
+    bench_nested(pool, 17);
+    return 0;
+}
@@ -2,7 +2,7 @@
 #define __THREADPOOL_H__
 
 #include <vector>
-#include <queue>
+#include <memory>
 #include <atomic>
 #include <future>
 #include <condition_variable>
@@ -11,29 +11,97 @@
 #include <stdexcept>
 #include <assert.h>
 
+#include "inline_task.h"
+
 #define  THREADPOOL_MAX_NUM 64
+#define  THREADPOOL_INJECT_SHARDS 8   //外部提交任务的注入队列分片数
 //#define  THREADPOOL_AUTO_GROW
 
 using namespace std;
 
+/*
+   任务环形队列，两端都可以入队出队，容量为2的幂，满时翻倍扩容且不再缩小，
+   稳定状态下入队出队只移动任务对象，不分配内存（deque会按块分配和释放内存）
+*/
+template <typename T>
+class TaskRing
+{
+public:
+	explicit TaskRing(size_t capacity = 64) : tr_buf(capacity), tr_mask(capacity - 1)
+	{
+		assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+	}
+
+	bool empty() const { return tr_head == tr_tail; }
+
+	size_t size() const { return tr_tail - tr_head; }
+
+	void push_back(T &&item)
+	{
+		if (size() == tr_buf.size())
+			grow();
+		tr_buf[tr_tail++ & tr_mask] = move(item);
+	}
+
+	void pop_back(T &item)
+	{
+		item = move(tr_buf[--tr_tail & tr_mask]);
+	}
+
+	void pop_front(T &item)
+	{
+		item = move(tr_buf[tr_head++ & tr_mask]);
+	}
+
+private:
+	void grow()
+	{
+		vector<T> buf(tr_buf.size() * 2);
+		size_t n = size();
+		for (size_t i = 0; i < n; i++)
+			buf[i] = move(tr_buf[(tr_head + i) & tr_mask]);
+		tr_buf.swap(buf);
+		tr_mask = tr_buf.size() - 1;
+		tr_head = 0;
+		tr_tail = n;
+	}
+
+	vector<T> tr_buf;
+	size_t tr_mask;
+	size_t tr_head = 0;   //单调递增的读位置
+	size_t tr_tail = 0;   //单调递增的写位置
+};
+
+/*
+   工作窃取线程池：
+   每个工作线程有自己的本地双端队列，工作线程内部提交的任务放入自己队列的尾部，并从尾部取任务执行；
+   其他线程提交的任务按提交线程分散到若干个注入队列分片中，避免所有提交者竞争同一把锁；
+   工作线程本地队列为空时先从注入队列取任务，再从其他工作线程队列的头部窃取任务；
+   没有任务时工作线程在条件变量上休眠，只有存在休眠线程时提交任务才会加锁唤醒。
+   任务类型为InlineTask，小任务直接保存在队列元素中，提交任务不分配内存。
+*/
 class Threadpool
 {
 public:
-	typedef function<void()> Task;
-    
+	typedef InlineTask Task;
+
 	//构造函数，默认创建线程池的线程数为4
-	inline Threadpool(unsigned short size = 4) { 
+	inline Threadpool(unsigned short size = 4) {
         assert(size <= THREADPOOL_MAX_NUM);
-        add_thread(size); 
+        add_thread(size);
     }
 
 	inline ~Threadpool()
 	{
-		tp_run=false; //线程池关闭状态
+		{
+			lock_guard<mutex> lock{ tp_park_lock };
+			tp_run=false; //线程池关闭状态
+		}
 		tp_task_cv.notify_all();  //唤醒所有线程执行剩余任务
-		for (thread& thread : tp_pool) {
-			if(thread.joinable())
-				thread.join(); 
+		int num = tp_worker_num.load();
+		for (int i = 0; i < num; i++) {
+			if(tp_workers[i]->w_thread.joinable())
+				tp_workers[i]->w_thread.join();
 		}
 	}
 
@@ -45,39 +113,37 @@ public:
 			throw runtime_error("post_task on Threadpool has been stopped.");
 
 		using return_type = typename std::result_of_t<F(Args...)>; // 使用 std::result_of_t 来推断函数返回类型
-		
-		// 创建一个 shared_ptr 来持有 packaged_task类的可调用函数对象
-		auto task = make_shared<packaged_task<return_type()>>(
-			bind(forward<F>(f), forward<Args>(args)...)
-		);
+
+		// 创建 packaged_task 类的可调用函数对象，Task 只要求可移动，直接移动到任务中，不需要再用 shared_ptr 持有
+		packaged_task<return_type()> task(bind(forward<F>(f), forward<Args>(args)...));
 
         // 从 packaged_task 中获取 future 对象
-		future<return_type> res = task->get_future();
-        
+		future<return_type> res = task.get_future();
+
 		//将该任务加入任务队列
-		{
-			lock_guard<mutex> lock{ tp_lock };
-			tp_tasks.emplace([task](){
-				(*task)();  /* *task获取智能指针管理的对象，然后使用operator（）调用这个对象，触发了这个延迟任务
-				               实际上该步就是调用std::packaged_task所包装的被绑定的函数对象
-				            */
-			});
-		}
-		 // 如果开启了自动增长线程池的宏，且空闲线程数为零，则增加一个线程
-#ifdef THREADPOOL_AUTO_GROW
-		if (tp_idl_tnum < 1 && tp_pool.size() < THREADPOOL_MAX_NUM)
-			add_thread(1);
-#endif
-        // 通知一个等待中的线程来执行任务
-		tp_task_cv.notify_one(); 
+		push_task([task = move(task)]() mutable {
+			task();  // 调用std::packaged_task所包装的被绑定的函数对象，触发了这个延迟任务
+		});
 
 		return res;         // 返回一个 future 对象，用于获取任务执行的结果
 	}
 
+	//提交不需要返回结果的任务，不创建packaged_task和future，任务直接放入队列
+	template<class F>
+	void execute(F&& f)
+	{
+		if (!tp_run)
+			throw runtime_error("execute on Threadpool has been stopped.");
+
+		push_task(Task(forward<F>(f)));
+	}
+
+	int idl_thread_cnt() { return tp_idl_tnum; }
 
-	int idl_thread_cnt() { return tp_idl_tnum; } 
+	int thread_cnt() { return tp_worker_num; }
 
-	int thread_cnt() { return tp_pool.size(); }
+	//所有队列中等待执行的任务数，不加锁，可以在任意线程中调用
+	int pending_task_cnt() { return tp_pending.load(memory_order_relaxed); }
 
 #ifndef THREADPOOL_AUTO_GROW
 private:
@@ -85,47 +151,172 @@ private:
     //添加线程
 	void add_thread(unsigned short size)
 	{
-		for (; tp_pool.size() < THREADPOOL_MAX_NUM && size > 0; --size)
+		for (; tp_worker_num < THREADPOOL_MAX_NUM && size > 0; --size)
 		{
-			//添加新线程
-			tp_pool.emplace_back( [this]{
-				while (tp_run)
-				{
-					Task task; //task为包装器对象
-					{
-						unique_lock<mutex> lock{ tp_lock };
-						tp_task_cv.wait(lock, [this]{
-								return !tp_run || !tp_tasks.empty();
-						});//线程池关闭或者任务队列不为空时，唤醒
-						if (!tp_run && tp_tasks.empty())
-							return;
-						task = move(tp_tasks.front()); //取任务
-						tp_tasks.pop();
-					}
-					tp_idl_tnum--;
-					task();       //执行任务 
-					tp_idl_tnum++;
-				}
-			});
+			//工作线程对象的位置固定，窃取任务时只遍历已经创建的工作线程
+			int idx = tp_worker_num;
+			tp_workers[idx].reset(new Worker);
+			tp_workers[idx]->w_pool = this;
+			tp_worker_num.store(idx + 1);
 			tp_idl_tnum++;
+			tp_workers[idx]->w_thread = thread(&Threadpool::worker_loop, this, idx);
 		}
 	}
 
 private:
+	//工作线程，本地队列由自身和窃取者共享，使用独立的锁，竞争很少
+	struct alignas(64) Worker
+	{
+		Threadpool *w_pool = nullptr;   //所属线程池
+		mutex w_lock;
+		TaskRing<Task> w_tasks;         //本地任务队列，自身从尾部取，窃取者从头部取
+		atomic<int> w_size{ 0 };        //本地任务数量，用于无锁判断队列是否为空
+		thread w_thread;
+	};
+
+	//注入队列分片，接收非工作线程提交的任务
+	struct alignas(64) Shard
+	{
+		mutex s_lock;
+		TaskRing<Task> s_tasks;
+		atomic<int> s_size{ 0 };
+	};
+
+	//当前线程所属的工作线程，非工作线程为空
+	static Worker *&current_worker()
+	{
+		static thread_local Worker *worker = nullptr;
+		return worker;
+	}
+
+	//当前线程提交任务使用的注入队列分片，每个提交线程固定使用一个分片
+	static unsigned shard_index()
+	{
+		static atomic<unsigned> next_index{ 0 };
+		static thread_local unsigned index = next_index.fetch_add(1);
+		return index % THREADPOOL_INJECT_SHARDS;
+	}
+
+	void push_task(Task &&task)
+	{
+		tp_pending.fetch_add(1);   //先计数再入队，休眠线程据此判断是否有任务
+		Worker *worker = current_worker();
+		if (worker && worker->w_pool == this)
+		{
+			lock_guard<mutex> lock{ worker->w_lock };
+			worker->w_tasks.push_back(move(task));
+			worker->w_size++;
+		}
+		else
+		{
+			Shard &shard = tp_shards[shard_index()];
+			lock_guard<mutex> lock{ shard.s_lock };
+			shard.s_tasks.push_back(move(task));
+			shard.s_size++;
+		}
+		 // 如果开启了自动增长线程池的宏，且空闲线程数为零，则增加一个线程
+#ifdef THREADPOOL_AUTO_GROW
+		if (tp_idl_tnum < 1 && tp_worker_num < THREADPOOL_MAX_NUM)
+			add_thread(1);
+#endif
+		// 只有存在休眠线程时才加锁唤醒一个线程来执行任务
+		if (tp_sleeping.load() > 0)
+		{
+			lock_guard<mutex> lock{ tp_park_lock };
+			tp_task_cv.notify_one();
+		}
+	}
+
+	//按本地队列、注入队列、窃取其他工作线程的顺序获取任务
+	bool take_task(int idx, Task &task)
+	{
+		Worker *self = tp_workers[idx].get();
+		if (self->w_size.load() > 0)
+		{
+			lock_guard<mutex> lock{ self->w_lock };
+			if (!self->w_tasks.empty())
+			{
+				self->w_tasks.pop_back(task);
+				self->w_size--;
+				return true;
+			}
+		}
+
+		for (int i = 0; i < THREADPOOL_INJECT_SHARDS; i++)
+		{
+			Shard &shard = tp_shards[(idx + i) % THREADPOOL_INJECT_SHARDS];
+			if (shard.s_size.load() == 0)
+				continue;
+			lock_guard<mutex> lock{ shard.s_lock };
+			if (!shard.s_tasks.empty())
+			{
+				shard.s_tasks.pop_front(task);
+				shard.s_size--;
+				return true;
+			}
+		}
+
+		int num = tp_worker_num.load();
+		for (int i = 1; i < num; i++)
+		{
+			Worker *victim = tp_workers[(idx + i) % num].get();
+			if (victim->w_size.load() == 0)
+				continue;
+			lock_guard<mutex> lock{ victim->w_lock };
+			if (!victim->w_tasks.empty())
+			{
+				victim->w_tasks.pop_front(task);
+				victim->w_size--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void worker_loop(int idx)
+	{
+		current_worker() = tp_workers[idx].get();
+		Task task; //task为包装器对象
+		while (true)
+		{
+			if (take_task(idx, task))
+			{
+				tp_pending--;
+				tp_idl_tnum--;
+				task();       //执行任务
+				task = nullptr;   //及时释放任务捕获的资源
+				tp_idl_tnum++;
+				continue;
+			}
+
+			unique_lock<mutex> lock{ tp_park_lock };
+			if (!tp_run && tp_pending.load() == 0)   //线程池关闭并且剩余任务都已执行
+				return;
+			tp_sleeping++;
+			tp_task_cv.wait(lock, [this]{
+					return !tp_run || tp_pending.load() > 0;
+			});//线程池关闭或者有待执行的任务时，唤醒
+			tp_sleeping--;
+		}
+	}
+
     Threadpool(const Threadpool &) = delete;  //禁用拷贝构造函数
 
     Threadpool(Threadpool &&) = delete;   //禁用移动构造函数
 
     Threadpool & operator=(const Threadpool &) = delete; //禁用拷贝赋值操作符重载
- 
+
     Threadpool & operator=(Threadpool &&) = delete;  //禁用移动赋值操作符重载
 
-	vector<thread> tp_pool;  //存储线程的容器
-	queue<Task> tp_tasks;   //任务队列
-	mutex tp_lock;
+	unique_ptr<Worker> tp_workers[THREADPOOL_MAX_NUM];   //工作线程，创建后位置不变
+	atomic<int> tp_worker_num{ 0 };    //已创建的工作线程数
+	Shard tp_shards[THREADPOOL_INJECT_SHARDS];   //注入队列分片
+	atomic<int> tp_pending{ 0 };       //所有队列中待执行的任务数
+	atomic<int> tp_sleeping{ 0 };      //休眠的工作线程数
+	mutex tp_park_lock;                //只用于工作线程休眠和唤醒
 	condition_variable tp_task_cv;
 	atomic<bool> tp_run{ true };     //运行线程数
 	atomic<int>  tp_idl_tnum{ 0 };  //空闲线程
 };
 
-#endif
\ No newline at end of file
+#endif
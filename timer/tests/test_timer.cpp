@@ -7,15 +7,16 @@
 using namespace std;
 
 //重复执行任务回调函数
+atomic<int> g_repeated_left;
+
 void test_repeated_func(chrono::time_point<chrono::steady_clock> t1, int num)
 {
-    static int cnt = num;
     long long tid = tid_to_ll(this_thread::get_id());
 
     auto t2 = chrono::steady_clock::now();
     int tm_diff = static_cast<int>( chrono::duration<double, milli>(t2-t1).count() );
     LOG_INFO("[tid:%lld] hello, repeated_func! total repeated_cnt = %d, left cnt: %d, time diff is %d ms\n",
-                                                                     tid, num, --cnt, tm_diff);    
+                                                                     tid, num, --g_repeated_left, tm_diff);    
 }
 
 //在特定时间执行的任务的回调函数，输出该任务实际执行的时间点和设置的定时执行点之间的时间差
@@ -51,16 +52,18 @@ private:
 };
 
 //定时器测试
-void test_timer() {
+void test_timer(TimerEngine engine) {
 
     long long tid = tid_to_ll(this_thread::get_id()); //获取主线程id
 
-    Timer t;  
-    t.run();  //启动定时器时内部会自动创建一个tick线程用于处理到期任务节点，将其任务回调函数放入线程池
+    Timer t(engine);  
+    t.run();
+    LOG_INFO("[tid:%lld] test timer engine: %s\n", tid, t.engine_name());  //启动定时器时内部会自动创建一个tick线程用于处理到期任务节点，将其任务回调函数放入线程池
 
     /* test repeated */
     auto t1 = std::chrono::steady_clock::now();
     int repeated_cnt = 5; //重复池数
+    g_repeated_left = repeated_cnt;
     int repeated_timeout_ms = 800;  //间隔时间
     LOG_INFO("[tid:%lld] start to test repeated run, repeated cnt is %d, timeout is %d ms\n", tid, repeated_cnt, repeated_timeout_ms);
     //添加重复执行定时任务到定时器队列
@@ -107,6 +110,7 @@ void test_timer() {
 int main()
 {
     Logger::get_instance()->init(NULL);
-    test_timer();
+    test_timer(TimerEngine::Heap);
+    test_timer(TimerEngine::Wheel);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "timer.h"
+#include "log.h"
+#include "pr.h"
+
+using namespace std;
+
+// 对比最小堆和分层时间轮两种定时任务队列：
+// * 调度/刷新/取消吞吐：不启动tick线程，加入100万个60秒后到期的任务，再模拟空闲超时刷新（取消后重新加入），最后全部取消
+//   每一步统计平均耗时、队列中的节点数和进程常驻内存
+// * 到期精度：启动tick线程，加入随机1~1000ms后到期的任务，统计全部执行完的数量和实际执行时间的延迟
+// 每种实现在单独的子进程中运行，互不影响内存统计
+// 用法: ./timer_bench [timer_num] [accuracy_timer_num]
+
+static long rss_kb()
+{
+    long pages = 0;
+    long rss = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &rss) != 2) {
+            rss = 0;
+        }
+        fclose(fp);
+    }
+    return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static double ns_per_op(chrono::steady_clock::time_point start, int num)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / num;
+}
+
+void bench_throughput(TimerEngine engine, int timer_num)
+{
+    Timer timer(engine);   //不启动tick线程，只测试队列本身的开销
+    long base_rss = rss_kb();
+    vector<int> ids(timer_num);
+    long long fired = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < timer_num; i++) {
+        ids[i] = timer.run_after(60000 + i % 1000, false, [&fired]() { fired++; });
+    }
+    double add_ns = ns_per_op(start, timer_num);
+    printf("%-6s schedule  %8d timers  %7.1f ns/op  queue size: %-8d rss: +%ld KB (%.0f B/timer)\n", timer.engine_name(),
+           timer_num, add_ns, timer.size(), rss_kb() - base_rss, (rss_kb() - base_rss) * 1024.0 / timer_num);
+
+    //空闲超时刷新：取消原来的任务再加入新任务
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < timer_num; i++) {
+        timer.cancel(ids[i]);
+        ids[i] = timer.run_after(60000 + i % 1000, false, [&fired]() { fired++; });
+    }
+    double refresh_ns = ns_per_op(start, timer_num);
+    printf("%-6s refresh   %8d timers  %7.1f ns/op  queue size: %-8d rss: +%ld KB\n", timer.engine_name(),
+           timer_num, refresh_ns, timer.size(), rss_kb() - base_rss);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < timer_num; i++) {
+        timer.cancel(ids[i]);
+    }
+    double cancel_ns = ns_per_op(start, timer_num);
+    printf("%-6s cancel    %8d timers  %7.1f ns/op  queue size: %-8d rss: +%ld KB\n", timer.engine_name(),
+           timer_num, cancel_ns, timer.size(), rss_kb() - base_rss);
+}
+
+void bench_accuracy(TimerEngine engine, int timer_num)
+{
+    vector<long long> late_us(timer_num, -1);   //在timer之前定义，timer析构时线程池中剩余的任务还会访问
+    atomic<int> done{ 0 };
+    Timer timer(engine);
+    timer.run();
+    mt19937 mt(12345);
+    uniform_int_distribution<int> dist(1, 1000);
+
+    for (int i = 0; i < timer_num; i++) {
+        int ms = dist(mt);
+        auto expect = chrono::steady_clock::now() + chrono::milliseconds(ms);
+        timer.run_after(ms, false, [&late_us, &done, i, expect]() {
+            late_us[i] = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - expect).count();
+            done++;
+        });
+    }
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    while (done.load() < timer_num && chrono::steady_clock::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    int fired = done.load();
+    vector<long long> late;
+    for (long long us : late_us) {
+        if (us != -1) {
+            late.push_back(us);
+        }
+    }
+    sort(late.begin(), late.end());
+    if (late.empty()) {
+        PR_ERROR("%s: no timer fired\n", timer.engine_name());
+        return;
+    }
+    printf("%-6s accuracy  %8d timers  fired: %-8d lateness p50: %lld us  p99: %lld us  max: %lld us  min: %lld us\n",
+           timer.engine_name(), timer_num, fired, late[late.size() / 2], late[late.size() * 99 / 100], late.back(), late.front());
+}
+
+int main(int argc, char *argv[])
+{
+    int timer_num = argc > 1 ? atoi(argv[1]) : 1000000;
+    int accuracy_num = argc > 2 ? atoi(argv[2]) : 100000;
+
+    Logger::get_instance()->init(NULL);
+    Logger::set_log_level(Logger::LOG_LEVEL_ERROR);
+
+    TimerEngine engines[] = { TimerEngine::Heap, TimerEngine::Wheel };
+    for (TimerEngine engine : engines) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            bench_throughput(engine, timer_num);
+            bench_accuracy(engine, accuracy_num);
+            fflush(stdout);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef __TIMER_QUEUE_H__
+#define __TIMER_QUEUE_H__
+
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "../threadpool/threadpool.h"
+
+using namespace std;
+
+typedef chrono::high_resolution_clock TimerClock;
+typedef chrono::time_point<TimerClock> TimerPoint;
+
+// 定时器节点结构体，用于表示定时任务
+struct TimerNode {
+    TimerPoint tn_tm_point; // 定时任务执行时间点
+    Threadpool::Task tn_callback; // 只执行一次的定时任务回调函数，到期时移动到线程池中
+    shared_ptr<Threadpool::Task> tn_shared_callback; // 间隔任务和重复任务的回调函数，每次到期时提交一个持有它的任务
+    int repeated_id; // 重复任务 ID
+    int tn_id; // 任务 ID
+    int tn_repeated_num; // 重复任务的执行次数
+    bool tn_is_period{ false }; // 是否为间隔任务
+    bool tn_is_repeated{ false }; // 是否为重复任务
+    chrono::milliseconds tn_period; // 任务执行的间隔时间
+    bool operator<(const TimerNode& b) const { return tn_tm_point > b.tn_tm_point; }
+};
+
+// 定时任务队列的实现类型
+enum class TimerEngine {
+    Heap,   // 最小堆，取消只做标记，节点到期时才从堆中删除
+    Wheel,  // 分层时间轮，插入和取消都是O(1)，取消时立即删除节点
+};
+
+// 定时任务队列的抽象接口，由Timer在tm_mutex保护下调用，实现不需要自己加锁
+class TimerQueue {
+public:
+    virtual ~TimerQueue() {}
+
+    virtual void push(TimerNode&& node) = 0;  // 加入定时任务
+
+    virtual void cancel(int id) = 0;  // 取消定时任务
+
+    // 取出now时已经到期的任务追加到expired中，wait返回距离下一次需要检查的时间
+    // 队列中没有任务时返回false
+    virtual bool pop_expired(const TimerPoint& now, vector<TimerNode>& expired, TimerClock::duration& wait) = 0;
+
+    virtual size_t size() const = 0;  // 队列中的节点数，包括已经取消但还没有删除的节点
+
+    virtual const char* name() const = 0;  // 实现名称
+};
+
+// 最小堆实现，将任务节点按照执行时间由先到后排列
+// 堆不支持删除任意节点，取消时只从有效id集合中删除，节点到期出堆时再丢弃
+class TimerHeap : public TimerQueue {
+public:
+    void push(TimerNode&& node) override
+    {
+        th_ids.insert(node.tn_id);
+        th_queue.push(move(node));
+    }
+
+    void cancel(int id) override
+    {
+        th_ids.erase(id);
+    }
+
+    bool pop_expired(const TimerPoint& now, vector<TimerNode>& expired, TimerClock::duration& wait) override
+    {
+        while (!th_queue.empty()) {
+            auto diff = th_queue.top().tn_tm_point - now;  //时间间隔
+            if (chrono::duration_cast<chrono::milliseconds>(diff).count() > 0) { //最近的任务还没有到执行时间点
+                wait = diff;
+                return true;
+            }
+            //回调函数只能移动，出堆前把节点移出，pop只比较执行时间点，不受影响
+            TimerNode node = move(const_cast<TimerNode&>(th_queue.top()));
+            th_queue.pop();
+            if (th_ids.erase(node.tn_id)) {  //已经取消的任务直接丢弃
+                expired.push_back(move(node));
+            }
+        }
+        return false;
+    }
+
+    size_t size() const override { return th_queue.size(); }
+
+    const char* name() const override { return "heap"; }
+
+private:
+    priority_queue<TimerNode> th_queue; // 定时器队列，采用小根堆
+    unordered_set<int> th_ids; // 还没有到期也没有取消的任务id
+};
+
+#endif
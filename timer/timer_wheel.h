@@ -0,0 +1,240 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdint.h>
+#include <unordered_map>
+
+#include "timer_queue.h"
+
+using namespace std;
+
+#define TIMER_WHEEL_ROOT_BITS 8    //第0层的槽数为2^8
+#define TIMER_WHEEL_LEVEL_BITS 6   //其余各层的槽数为2^6
+#define TIMER_WHEEL_LEVELS 5       //共5层，覆盖2^32个tick，tick为1ms时约49天
+#define TIMER_WHEEL_CHUNK 1024     //节点池每次分配的节点数
+
+/*
+   分层时间轮：
+   第0层每个槽对应一个tick，第n层每个槽对应第n-1层转一圈的时间，任务按距离到期的tick数放入对应层的槽中；
+   第0层转到0号槽时，把上一层当前槽中的节点重新分配到下面的层（级联），每个节点最多级联TIMER_WHEEL_LEVELS-1次。
+   槽是侵入式双向链表，插入和取消都是O(1)；取消时节点立即从链表中删除，回调函数立即析构，节点回到节点池中复用。
+   超过最大范围的任务先放在最高层能表示的最远的槽，级联时再按实际到期时间重新分配。
+*/
+class TimerWheel : public TimerQueue {
+public:
+    explicit TimerWheel(int tick_ms = 1)
+        : tw_tick(chrono::milliseconds(tick_ms)), tw_base(TimerClock::now())
+    {
+        for (auto& slot : tw_root) {
+            slot.prev = slot.next = &slot;
+        }
+        for (auto& level : tw_levels) {
+            for (auto& slot : level) {
+                slot.prev = slot.next = &slot;
+            }
+        }
+    }
+
+    void push(TimerNode&& node) override
+    {
+        if (tw_size == 0) {
+            tw_current = now_tick(TimerClock::now());  //时间轮为空时当前tick可能已经落后，先对齐到当前时间
+        }
+        WheelNode* wn = alloc_node();
+        wn->expire = to_tick(node.tn_tm_point);
+        wn->timer = move(node);
+        tw_ids[wn->timer.tn_id] = wn;
+        add_node(wn);
+        tw_size++;
+    }
+
+    void cancel(int id) override
+    {
+        auto it = tw_ids.find(id);
+        if (it == tw_ids.end()) {
+            return;
+        }
+        WheelNode* wn = it->second;
+        tw_ids.erase(it);
+        unlink(wn);
+        free_node(wn);
+        tw_size--;
+    }
+
+    bool pop_expired(const TimerPoint& now, vector<TimerNode>& expired, TimerClock::duration& wait) override
+    {
+        uint64_t cur_tick = now_tick(now);
+        if (tw_size == 0) {
+            return false;
+        }
+        while (tw_current <= cur_tick) {
+            uint32_t idx = tw_current & ROOT_MASK;
+            //第0层转了一圈，从上层依次级联
+            if (idx == 0) {
+                for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                    uint32_t slot_idx = (tw_current >> (TIMER_WHEEL_ROOT_BITS + (level - 1) * TIMER_WHEEL_LEVEL_BITS)) & LEVEL_MASK;
+                    cascade(level, slot_idx);
+                    if (slot_idx != 0) {
+                        break;
+                    }
+                }
+            }
+            WheelLink* head = &tw_root[idx];
+            while (head->next != head) {
+                WheelNode* wn = static_cast<WheelNode*>(head->next);
+                unlink(wn);
+                tw_ids.erase(wn->timer.tn_id);
+                expired.push_back(move(wn->timer));
+                free_node(wn);
+                tw_size--;
+            }
+            tw_current++;
+        }
+        if (tw_size == 0) {
+            return false;
+        }
+        wait = tick_point(next_check_tick()) - now;
+        return true;
+    }
+
+    size_t size() const override { return tw_size; }
+
+    const char* name() const override { return "wheel"; }
+
+private:
+    static const uint32_t ROOT_SIZE = 1u << TIMER_WHEEL_ROOT_BITS;
+    static const uint32_t ROOT_MASK = ROOT_SIZE - 1;
+    static const uint32_t LEVEL_SIZE = 1u << TIMER_WHEEL_LEVEL_BITS;
+    static const uint32_t LEVEL_MASK = LEVEL_SIZE - 1;
+    static const uint64_t MAX_DELTA = (1ull << (TIMER_WHEEL_ROOT_BITS + (TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_LEVEL_BITS)) - 1;
+
+    // 槽链表的链接，槽本身是链表的哨兵
+    struct WheelLink {
+        WheelLink* prev = nullptr;
+        WheelLink* next = nullptr;  // 节点在节点池空闲链表中时指向下一个空闲节点
+    };
+
+    struct WheelNode : public WheelLink {
+        uint64_t expire = 0;  // 到期的tick
+        TimerNode timer;
+    };
+
+    // 时间点转换为tick，向上取整，保证任务不会提前执行
+    uint64_t to_tick(const TimerPoint& tp) const
+    {
+        if (tp <= tw_base) {
+            return 0;
+        }
+        return (tp - tw_base + tw_tick - TimerClock::duration(1)) / tw_tick;
+    }
+
+    // 时间点所在的tick，向下取整
+    uint64_t now_tick(const TimerPoint& now) const
+    {
+        return now < tw_base ? 0 : (now - tw_base) / tw_tick;
+    }
+
+    TimerPoint tick_point(uint64_t tick) const
+    {
+        return tw_base + static_cast<TimerClock::rep>(tick) * tw_tick;
+    }
+
+    // 按距离到期的tick数选择所在的层和槽
+    void add_node(WheelNode* wn)
+    {
+        uint64_t expire = wn->expire < tw_current ? tw_current : wn->expire;
+        uint64_t delta = expire - tw_current;
+        WheelLink* head;
+        if (delta < ROOT_SIZE) {
+            head = &tw_root[expire & ROOT_MASK];
+        }
+        else {
+            if (delta > MAX_DELTA) {
+                expire = tw_current + MAX_DELTA;  //超出范围，先放在最高层，级联时重新分配
+            }
+            int level = 1;
+            int shift = TIMER_WHEEL_ROOT_BITS;
+            while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (shift + TIMER_WHEEL_LEVEL_BITS))) {
+                level++;
+                shift += TIMER_WHEEL_LEVEL_BITS;
+            }
+            head = &tw_levels[level - 1][(expire >> shift) & LEVEL_MASK];
+        }
+        wn->prev = head->prev;
+        wn->next = head;
+        head->prev->next = wn;
+        head->prev = wn;
+    }
+
+    void unlink(WheelLink* wn)
+    {
+        wn->prev->next = wn->next;
+        wn->next->prev = wn->prev;
+        wn->prev = wn->next = nullptr;
+    }
+
+    // 把上层一个槽中的节点重新分配到下面的层
+    void cascade(int level, uint32_t slot_idx)
+    {
+        WheelLink* head = &tw_levels[level - 1][slot_idx];
+        WheelLink* wn = head->next;
+        head->prev = head->next = head;
+        while (wn != head) {
+            WheelLink* next = wn->next;
+            add_node(static_cast<WheelNode*>(wn));
+            wn = next;
+        }
+    }
+
+    // 下一次需要检查的tick：第0层中下一个非空的槽，或者下一次级联的时间（包括tw_current本身需要级联的情况）
+    uint64_t next_check_tick() const
+    {
+        for (uint32_t i = 0; i < ROOT_SIZE; i++) {
+            uint64_t tick = tw_current + i;
+            if ((tick & ROOT_MASK) == 0) {
+                return tick;
+            }
+            const WheelLink* head = &tw_root[tick & ROOT_MASK];
+            if (head->next != head) {
+                return tick;
+            }
+        }
+        return tw_current + ROOT_SIZE;
+    }
+
+    // 节点池，节点按块分配，释放的节点放回空闲链表
+    WheelNode* alloc_node()
+    {
+        if (!tw_free) {
+            tw_chunks.emplace_back(new WheelNode[TIMER_WHEEL_CHUNK]);
+            WheelNode* chunk = tw_chunks.back().get();
+            for (int i = 0; i < TIMER_WHEEL_CHUNK; i++) {
+                chunk[i].next = tw_free;
+                tw_free = &chunk[i];
+            }
+        }
+        WheelNode* wn = tw_free;
+        tw_free = static_cast<WheelNode*>(wn->next);
+        wn->next = nullptr;
+        return wn;
+    }
+
+    void free_node(WheelNode* wn)
+    {
+        wn->timer = TimerNode();  //立即释放回调函数持有的资源
+        wn->next = tw_free;
+        tw_free = wn;
+    }
+
+    const TimerClock::duration tw_tick;  // 每个tick的时长
+    const TimerPoint tw_base;  // tick 0对应的时间点
+    uint64_t tw_current = 0;  // 下一个要处理的tick
+    size_t tw_size = 0;  // 时间轮中的任务数
+    WheelLink tw_root[ROOT_SIZE];  // 第0层的槽
+    WheelLink tw_levels[TIMER_WHEEL_LEVELS - 1][LEVEL_SIZE];  // 第1层及以上的槽
+    unordered_map<int, WheelNode*> tw_ids;  // 任务id到节点的映射，用于取消
+    vector<unique_ptr<WheelNode[]>> tw_chunks;  // 节点池的内存块
+    WheelNode* tw_free = nullptr;  // 节点池的空闲链表
+};
+
+#endif